@@ -3,49 +3,65 @@
 #include "../src/ArchiveFormats/ArchiveFormat.h"
 #include "sdk.h"
 #include "util/rd_log.h"
+#include "../src/util/memory.h"
+#include <algorithm>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 class ArchiveBaseWrapper : public ArchiveBase {
 public:
     sdk_ctx *ctx;
 
-    ArchiveBaseWrapper(sdk_ctx *ctx, ArchiveBaseHandle *handle) : ctx(ctx), handle(handle) {}
+    ArchiveBaseWrapper(sdk_ctx *ctx, ArchiveBaseHandle *handle, u32 abi_version, u32 capabilities, std::unique_ptr<RD_ArchiveSource> source = {})
+        : ctx(ctx), handle(handle), abi_version(abi_version), capabilities(capabilities), source(std::move(source)) {}
 
     ~ArchiveBaseWrapper() = default;
 
     EntryMapPtr GetEntries() override {
-        EntryMapPtr entries;
-
         if (!handle || !handle->vtable) {
             rd_log(RD_LOG_LVL_ERROR, "function table is null! Something has gone very wrong.", 55);
             return {};
         }
 
-        size_t count = handle->vtable->GetEntryCount(handle->inst);
-
-        for (size_t i = 0; i < count; i++) {
-            Entry* e = new Entry();
-            e->name = handle->vtable->GetEntryName(handle->inst, i);
-            e->size = handle->vtable->GetEntrySize(handle->inst, i);
-            entries[e->name] = e;
+        // The entry list can't change once the archive is open, so it's only fetched from the plugin once.
+        if (!fetched) {
+            FetchEntries();
+            fetched = true;
         }
 
-        return entries;
+        return ArchiveBase::GetEntries();
     }
 
     u8* OpenStream(const Entry *entry, u8 *buffer) override {
-        if (!handle || !handle->vtable || !handle->vtable->OpenStream) return nullptr;
-
-        size_t count = handle->vtable->GetEntryCount(handle->inst);
-        for (size_t i = 0; i < count; i++) {
-            const char* name = handle->vtable->GetEntryName(handle->inst, i);
-            if (name && entry->name == name) {
-                usize out_size = 0;
-                u8* data = handle->vtable->OpenStream(handle->inst, i, &out_size);
-                return data;
+        if (!handle || !handle->vtable) return nullptr;
+        if (entry->index >= entry_count) return nullptr;
+
+        if (HasOpenStreamInto()) {
+            u8 *output = malloc<u8>(entry->size);
+            if (!output) return nullptr;
+            if (handle->vtable->OpenStreamInto(handle->inst, entry->index, output, entry->size) != entry->size) {
+                free(output);
+                return nullptr;
             }
+            return output;
         }
-        return nullptr;
+
+        if (!handle->vtable->OpenStream) return nullptr;
+        usize out_size = 0;
+        return handle->vtable->OpenStream(handle->inst, entry->index, &out_size);
+    }
+
+    // Plugins can only produce whole entries, so this is limited to reading an entry from the start.
+    usize ReadRange(const Entry *entry, u8 *buffer, u64 offset, u8 *dest, usize length) override {
+        if (!handle || !handle->vtable || !HasOpenStreamInto()) return 0;
+        if (entry->index >= entry_count || offset != 0 || length < entry->size) return 0;
+
+        return handle->vtable->OpenStreamInto(handle->inst, entry->index, dest, length);
+    }
+
+    bool ConcurrentStreams() const override {
+        return (capabilities & RD_CAP_REENTRANT_OPEN_STREAM) != 0;
     }
 
     virtual void ArchiveDestroy() override {
@@ -55,13 +71,59 @@ public:
 
 private:
     ArchiveBaseHandle* handle;
+    u32 abi_version;
+    u32 capabilities;
+    // Handed to the plugin by TryOpenSource, has to outlive its archive.
+    std::unique_ptr<RD_ArchiveSource> source;
+    usize entry_count = 0;
+    bool fetched = false;
+
+    // OpenStreamInto only exists in the vtables of v4 plugins.
+    bool HasOpenStreamInto() const {
+        return abi_version >= 4 && handle->vtable->OpenStreamInto;
+    }
+
+    void AddEntry(usize index, const char *name, u64 size, u64 offset, u32 flags) {
+        if (!name) return;
+
+        Entry entry = {};
+        entry.name = name;
+        entry.size = size;
+        entry.offset = offset;
+        entry.index = index;
+        entry.isPacked = (flags & RD_ENTRY_PACKED) != 0;
+        entry.isEncrypted = (flags & RD_ENTRY_ENCRYPTED) != 0;
+        entries.insert({entry.name, std::move(entry)});
+    }
+
+    void FetchEntries() {
+        entries.clear();
+        entry_count = handle->vtable->GetEntryCount(handle->inst);
+        entries.reserve(entry_count);
+
+        // GetEntries only exists in the vtables of v2 plugins, older ones end at ArchiveDestroy.
+        if (abi_version >= 2 && handle->vtable->GetEntries) {
+            std::vector<RD_EntryRecord> records(entry_count);
+            usize written = handle->vtable->GetEntries(handle->inst, records.data(), records.size());
+            entry_count = std::min(entry_count, written);
+
+            for (usize i = 0; i < entry_count; i++) {
+                AddEntry(i, records[i].name, records[i].size, records[i].offset, records[i].flags);
+            }
+            return;
+        }
+
+        for (usize i = 0; i < entry_count; i++) {
+            AddEntry(i, handle->vtable->GetEntryName(handle->inst, i), handle->vtable->GetEntrySize(handle->inst, i), 0, 0);
+        }
+    }
 };
 
 
 class ArchiveFormatWrapper : public ArchiveFormat {
 public:
-    ArchiveFormatWrapper(const ArchiveFormatVTable *vtbl, sdk_ctx *ctx, ArchiveHandle inst)
-      : vtbl(vtbl), ctx(ctx), inst(inst) {}
+    ArchiveFormatWrapper(const ArchiveFormatVTable *vtbl, sdk_ctx *ctx, ArchiveHandle inst, u32 abi_version = 1, u32 capabilities = 0)
+      : vtbl(vtbl), ctx(ctx), inst(inst), abi_version(abi_version), capabilities(capabilities) {}
 
     ~ArchiveFormatWrapper() = default;
 
@@ -71,11 +133,26 @@ public:
     }
 
     virtual ArchiveBase* TryOpen(u8* buffer, u64 size, std::string file_name) override {
-        if (!vtbl || !vtbl->TryOpen) return nullptr;
+        if (!vtbl) return nullptr;
+
+        // TryOpenSource only exists in the vtables of v3 plugins.
+        if (abi_version >= 3 && vtbl->TryOpenSource) {
+            auto source = std::make_unique<RD_ArchiveSource>();
+            source->size = size;
+            source->data = buffer;
+            source->read_at = ReadFromMemory;
+            source->host = nullptr;
+
+            ArchiveBaseHandle *h = vtbl->TryOpenSource(inst, source.get(), file_name.c_str());
+            if (!h || h->vtable == nullptr) return nullptr;
+            return new ArchiveBaseWrapper(ctx, h, abi_version, capabilities, std::move(source));
+        }
+
+        if (!vtbl->TryOpen) return nullptr;
         ArchiveBaseHandle *h = vtbl->TryOpen(inst, buffer, size, file_name.c_str());
-        if (h->vtable == nullptr) return nullptr;
+        if (!h || h->vtable == nullptr) return nullptr;
          // adapter that converts ArchiveBaseHandle -> ArchiveBase*
-        return new ArchiveBaseWrapper(ctx, h);
+        return new ArchiveBaseWrapper(ctx, h, abi_version, capabilities);
     }
 
     virtual const char* GetTag() const override {
@@ -90,10 +167,20 @@ public:
         return d ? d : "??";
     }
 private:
+    // The host keeps archives fully in memory for now, so reads are plain copies out of `data`.
+    static usize ReadFromMemory(const RD_ArchiveSource* source, u64 offset, usize length, u8* dst) {
+        if (!source || offset >= source->size) return 0;
+        usize count = (usize)std::min<u64>(length, source->size - offset);
+        memcpy(dst, source->data + offset, count);
+        return count;
+    }
+
     const ArchiveFormatVTable* vtbl;
     sdk_ctx* ctx;
     ArchiveHandle inst;
+    u32 abi_version;
+    u32 capabilities;
 };
 
 
-ArchiveFormatWrapper *AddArchiveFormat(struct sdk_ctx* ctx, const ArchiveFormatVTable* vtable);
+ArchiveFormatWrapper *AddArchiveFormat(struct sdk_ctx* ctx, const ArchiveFormatVTable* vtable, u32 abi_version, u32 capabilities);
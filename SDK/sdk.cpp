@@ -2,7 +2,7 @@
 #include "ArchiveFormatWrapper.h"
 #include <SDK/util/Logger.hpp>
 
-ArchiveFormatWrapper* AddArchiveFormat(struct sdk_ctx* ctx, const ArchiveFormatVTable* vtable) {
+ArchiveFormatWrapper* AddArchiveFormat(struct sdk_ctx* ctx, const ArchiveFormatVTable* vtable, u32 abi_version, u32 capabilities) {
     if (!ctx || !vtable) {
         Logger::error("No valid context or vtable provided!");
         return nullptr;
@@ -26,7 +26,7 @@ ArchiveFormatWrapper* AddArchiveFormat(struct sdk_ctx* ctx, const ArchiveFormatV
         }
     }
 
-    ArchiveFormatWrapper* wrapper = new ArchiveFormatWrapper(vtable, ctx, inst);
+    ArchiveFormatWrapper* wrapper = new ArchiveFormatWrapper(vtable, ctx, inst, abi_version, capabilities);
     ctx->archiveFormat = wrapper;
     return wrapper;
 }
@@ -36,7 +36,7 @@ extern "C" {
 void sdk_init(struct sdk_ctx* ctx) {
     if (!ctx) return;
 
-    ctx->version = 1;
+    ctx->version = RD_ABI_VERSION;
     ctx->logger = new Logger();
     ctx->archiveFormat = nullptr;
 
@@ -33,6 +33,48 @@ struct HostAPI {
     LogFn_t warn;
     LogFn_t error;
     RD_LogFmtv_t log_fmtv;
+
+    // ABI v4. Host allocator, backed by a pool of recycled buffers. Memory from `allocate` can be returned from
+    // OpenStream, or given back with `deallocate` and the same size it was allocated with. Safe to call from any thread.
+    // Older hosts' HostAPI ends before these, check that get_sdk_context()->version is at least 4 before reading them.
+    void* (*allocate)(usize size);
+    void (*deallocate)(void* ptr, usize size);
+};
+
+// Version of the plugin ABI described by this header. Plugins export it as RD_PluginABIVersion so the host knows which
+// optional parts of the vtables they fill in, plugins that don't export it are treated as version 1.
+#define RD_ABI_VERSION 4
+
+// Bits of RD_PluginCapabilities, an optional u32 plugins export next to RD_PluginABIVersion to say what the host may
+// do in parallel. Without it every call into the plugin is made from one thread at a time.
+// OpenStream/OpenStreamInto may run on several threads at once for the same archive.
+#define RD_CAP_REENTRANT_OPEN_STREAM     (1u << 0)
+// CanHandleFile only looks at its arguments. Reserved: detection currently always runs on one thread.
+#define RD_CAP_STATELESS_CAN_HANDLE_FILE (1u << 1)
+
+// RD_EntryRecord::flags
+#define RD_ENTRY_PACKED    (1u << 0)
+#define RD_ENTRY_ENCRYPTED (1u << 1)
+
+// Metadata for one entry, filled in by ArchiveBaseVTable::GetEntries. `name` must stay valid until ArchiveDestroy.
+typedef struct {
+    const char* name;
+    u64 size;
+    u64 offset;
+    u32 flags;
+} RD_EntryRecord;
+
+// The archive file being opened, passed to ArchiveFormatVTable::TryOpenSource. The struct, and `data` when it isn't NULL,
+// stay valid until the archive's ArchiveDestroy, so plugins can keep them around instead of copying the archive.
+typedef struct RD_ArchiveSource RD_ArchiveSource;
+struct RD_ArchiveSource {
+    u64 size;
+    // The whole archive, or NULL when the host can only serve it through read_at.
+    const u8* data;
+    // Copies up to `length` bytes starting at `offset` into `dst` and returns how many were copied, which is only
+    // less than `length` at the end of the archive. Safe to call from any thread.
+    usize (*read_at)(const RD_ArchiveSource* source, u64 offset, usize length, u8* dst);
+    void* host;
 };
 
 typedef void* ArchiveHandle;
@@ -51,6 +93,14 @@ struct ArchiveBaseVTable {
     u8* (*OpenStream)(ArchiveInstance inst, usize index, usize* out_size);
 
     void (*ArchiveDestroy)(ArchiveBaseHandle *handle);
+
+    // ABI v2. Fills up to `capacity` records, record `i` describing entry index `i`, and returns how many were written.
+    // The host calls this once per archive instead of GetEntryName/GetEntrySize per entry.
+    usize (*GetEntries)(ArchiveInstance inst, RD_EntryRecord* records, usize capacity);
+
+    // ABI v4. Decodes the entry straight into `dst`, which holds `capacity` bytes, and returns how many bytes were
+    // written, 0 on failure. Preferred over OpenStream when set, since the host picks where the data ends up.
+    usize (*OpenStreamInto)(ArchiveInstance inst, usize index, u8* dst, usize capacity);
 };
 
 
@@ -62,6 +112,9 @@ typedef struct {
 
     const char *(*GetTag)(ArchiveHandle inst);
     const char *(*GetDescription)(ArchiveHandle inst);
+
+    // ABI v3. Used instead of TryOpen when set, `source` may be kept until ArchiveDestroy.
+    ArchiveBaseHandle* (*TryOpenSource)(ArchiveHandle inst, const RD_ArchiveSource* source, const char* file_name);
 } ArchiveFormatVTable;
 
 void sdk_init(struct sdk_ctx* ctx);
@@ -71,7 +124,7 @@ void Logger_log(struct sdk_ctx* ctx, const char *fmt, ...);
 void Logger_warn(struct sdk_ctx* ctx, const char *fmt, ...);
 void Logger_error(struct sdk_ctx* ctx, const char *fmt, ...);
 
-class ArchiveFormatWrapper* AddArchiveFormat(struct sdk_ctx* ctx, const ArchiveFormatVTable* vtable);
+class ArchiveFormatWrapper* AddArchiveFormat(struct sdk_ctx* ctx, const ArchiveFormatVTable* vtable, u32 abi_version = 1, u32 capabilities = 0);
 
 #ifdef _WIN32
 #define RD_EXPORT extern "C" __declspec(dllexport)
@@ -0,0 +1,225 @@
+// Test plugin for the concurrent plugin paths, loaded by tests/test_plugin_concurrency.cpp. It declares
+// RD_CAP_REENTRANT_OPEN_STREAM and keeps no state between calls apart from a few atomic counters, so any data race
+// ThreadSanitizer finds while the host calls it from several threads is on the host's side.
+//
+// Archive layout ("RDCT"): magic, u32 entry count, then per entry a 16 byte name, u32 offset and u32 size. Entry data
+// is stored XORed with the low byte of the entry index.
+#include "../../SDK/sdk.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    RD_EXPORT const char* RD_PluginName;
+    RD_EXPORT const char* RD_PluginVersion;
+    RD_EXPORT const u32 RD_PluginABIVersion;
+    RD_EXPORT const u32 RD_PluginCapabilities;
+}
+
+const char* RD_PluginName = "Concurrency Test";
+const char* RD_PluginVersion = "1.0.0";
+const u32 RD_PluginABIVersion = RD_ABI_VERSION;
+// Every archive is read only once TryOpen returns, the counters below are atomics.
+const u32 RD_PluginCapabilities = RD_CAP_REENTRANT_OPEN_STREAM;
+
+static HostAPI* g_api = nullptr;
+
+// Streams being decoded right now, and the most there have been at once.
+static std::atomic<u32> g_in_flight = 0;
+static std::atomic<u32> g_max_in_flight = 0;
+
+struct TestEntry {
+    char name[17];
+    u32 offset;
+    u32 size;
+};
+
+struct TestArchive {
+    std::vector<TestEntry> entries;
+    // Exactly one of these is set, depending on whether the host opened it through TryOpen or TryOpenSource.
+    const u8* buffer;
+    const RD_ArchiveSource* source;
+};
+
+static constexpr usize HeaderSize = 8;
+static constexpr usize RecordSize = 24;
+static constexpr usize ChunkSize = 4096;
+
+static void EnterStream() {
+    u32 now = ++g_in_flight;
+    u32 seen = g_max_in_flight.load();
+    while (now > seen && !g_max_in_flight.compare_exchange_weak(seen, now)) {}
+}
+
+static usize Decode(const TestArchive* arc, usize idx, u8* dst, usize capacity) {
+    const TestEntry& entry = arc->entries[idx];
+    if (capacity < entry.size) return 0;
+
+    EnterStream();
+    usize done = 0;
+    while (done < entry.size) {
+        usize length = entry.size - done < ChunkSize ? entry.size - done : ChunkSize;
+        if (arc->source) {
+            if (arc->source->read_at(arc->source, entry.offset + done, length, dst + done) != length) break;
+        } else {
+            memcpy(dst + done, arc->buffer + entry.offset + done, length);
+        }
+        for (usize i = 0; i < length; i++) dst[done + i] ^= (u8)idx;
+        done += length;
+        // Gives the other callers a chance to overlap even on a single core.
+        std::this_thread::yield();
+    }
+    g_in_flight--;
+    return done == entry.size ? done : 0;
+}
+
+static usize GetEntryCount(ArchiveInstance inst) {
+    return ((TestArchive*)inst)->entries.size();
+}
+
+static const char* GetEntryName(ArchiveInstance inst, usize idx) {
+    auto* arc = (TestArchive*)inst;
+    return idx < arc->entries.size() ? arc->entries[idx].name : nullptr;
+}
+
+static usize GetEntrySize(ArchiveInstance inst, usize idx) {
+    auto* arc = (TestArchive*)inst;
+    return idx < arc->entries.size() ? arc->entries[idx].size : 0;
+}
+
+static u8* OpenStream(ArchiveInstance inst, usize idx, usize* out_size) {
+    auto* arc = (TestArchive*)inst;
+    if (idx >= arc->entries.size()) return nullptr;
+
+    usize size = arc->entries[idx].size;
+    u8* buf = (u8*)g_api->allocate(size ? size : 1);
+    if (!buf) return nullptr;
+    if (Decode(arc, idx, buf, size) != size) {
+        g_api->deallocate(buf, size ? size : 1);
+        return nullptr;
+    }
+    if (out_size) *out_size = size;
+    return buf;
+}
+
+static usize OpenStreamInto(ArchiveInstance inst, usize idx, u8* dst, usize capacity) {
+    auto* arc = (TestArchive*)inst;
+    if (idx >= arc->entries.size()) return 0;
+    return Decode(arc, idx, dst, capacity);
+}
+
+static usize GetEntries(ArchiveInstance inst, RD_EntryRecord* records, usize capacity) {
+    auto* arc = (TestArchive*)inst;
+    usize count = capacity < arc->entries.size() ? capacity : arc->entries.size();
+    for (usize i = 0; i < count; i++) {
+        records[i] = {
+            .name = arc->entries[i].name,
+            .size = arc->entries[i].size,
+            .offset = arc->entries[i].offset,
+            .flags = 0,
+        };
+    }
+    return count;
+}
+
+static void ArchiveDestroy(ArchiveBaseHandle* handle) {
+    delete (TestArchive*)handle->inst;
+    delete handle;
+}
+
+static ArchiveBaseVTable g_baseVTable = {
+    &GetEntryCount,
+    &GetEntryName,
+    &GetEntrySize,
+    &OpenStream,
+    &ArchiveDestroy,
+    &GetEntries,
+    &OpenStreamInto,
+};
+
+static int CanHandleFile(ArchiveHandle, u8* buffer, u64 size, const char*) {
+    return size >= HeaderSize && memcmp(buffer, "RDCT", 4) == 0;
+}
+
+// Reads the index through `read`, which copies `length` bytes at `offset` and returns false past the end.
+template<typename ReadFn>
+static bool ReadIndex(TestArchive* arc, u64 size, ReadFn read) {
+    u8 header[HeaderSize];
+    if (!read(0, header, HeaderSize) || memcmp(header, "RDCT", 4) != 0) return false;
+
+    u32 count = 0;
+    memcpy(&count, header + 4, 4);
+    if (count == 0 || count > (size - HeaderSize) / RecordSize) return false;
+
+    arc->entries.resize(count);
+    for (u32 i = 0; i < count; i++) {
+        u8 record[RecordSize];
+        if (!read(HeaderSize + (u64)i * RecordSize, record, RecordSize)) return false;
+
+        TestEntry& entry = arc->entries[i];
+        memcpy(entry.name, record, 16);
+        entry.name[16] = '\0';
+        memcpy(&entry.offset, record + 16, 4);
+        memcpy(&entry.size, record + 20, 4);
+        if ((u64)entry.offset + entry.size > size) return false;
+    }
+    return true;
+}
+
+template<typename ReadFn>
+static ArchiveBaseHandle* Open(TestArchive* arc, u64 size, ReadFn read) {
+    if (!ReadIndex(arc, size, read)) {
+        delete arc;
+        return nullptr;
+    }
+    return new ArchiveBaseHandle{arc, &g_baseVTable};
+}
+
+static ArchiveBaseHandle* TryOpen(ArchiveHandle, u8* buffer, u64 size, const char*) {
+    return Open(new TestArchive{{}, buffer, nullptr}, size, [&](u64 offset, u8* dst, usize length) {
+        if (offset + length > size) return false;
+        memcpy(dst, buffer + offset, length);
+        return true;
+    });
+}
+
+static ArchiveBaseHandle* TryOpenSource(ArchiveHandle, const RD_ArchiveSource* source, const char*) {
+    return Open(new TestArchive{{}, nullptr, source}, source->size, [&](u64 offset, u8* dst, usize length) {
+        return source->read_at(source, offset, length, dst) == length;
+    });
+}
+
+static const char* GetTag(ArchiveHandle) {
+    return "ConcurrencyTest";
+}
+
+static const char* GetDescription(ArchiveHandle) {
+    return "Archive format of the plugin concurrency test";
+}
+
+static ArchiveFormatVTable g_formatVTable = {
+    nullptr,
+    &CanHandleFile,
+    &TryOpen,
+    &GetTag,
+    &GetDescription,
+    &TryOpenSource,
+};
+
+RD_EXPORT bool RD_PluginInit(HostAPI* api) {
+    g_api = api;
+    sdk_ctx* ctx = api ? api->get_sdk_context() : nullptr;
+    return ctx && ctx->version >= 4 && api->allocate && api->deallocate;
+}
+
+RD_EXPORT void RD_PluginShutdown() {}
+
+RD_EXPORT const ArchiveFormatVTable* RD_GetArchiveFormat(sdk_ctx*) {
+    return &g_formatVTable;
+}
+
+// Not part of the plugin API, lets the test check that its threads really overlapped inside the plugin.
+RD_EXPORT u32 RD_TestMaxConcurrentStreams() {
+    return g_max_in_flight.load();
+}
@@ -2,13 +2,18 @@
 #include "../SDK/util/Logger.hpp"
 #include "../SDK/util/rd_log_helpers.h"
 #include "../SDK/util/rd_log.h"
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
 // Aligns with variables marked as RD_EXPORT in example_plugin.h
 const char* RD_PluginName = "Demo Plugin";
 const char* RD_PluginVersion = "1.0.0";
+const u32 RD_PluginABIVersion = RD_ABI_VERSION;
+// Archives are never modified after TryOpen and detection only checks the extension.
+const u32 RD_PluginCapabilities = RD_CAP_REENTRANT_OPEN_STREAM | RD_CAP_STATELESS_CAN_HANDLE_FILE;
 sdk_ctx* g_ctx = nullptr;
+static HostAPI* g_api = nullptr;
 
 // -------------------- Base vtable functions --------------------
 static usize GetEntryCount(ArchiveInstance inst) {
@@ -35,11 +40,39 @@ static u8* OpenStream(ArchiveInstance inst, usize idx, usize* out_size) {
     const auto& src = arc->entries[idx].content;
     if (out_size) *out_size = src.size();
 
-    u8* buf = (u8*)malloc(src.size());
+    // The host frees this, so it has to come from its allocator.
+    u8* buf = (u8*)g_api->allocate(src.size());
+    if (!buf) return nullptr;
     memcpy(buf, src.data(), src.size());
     return buf;
 }
 
+static usize OpenStreamInto(ArchiveInstance inst, usize idx, u8* dst, usize capacity) {
+    auto* arc = (DemoArchive*)inst;
+    if (!arc || idx >= arc->entries.size()) return 0;
+
+    const auto& src = arc->entries[idx].content;
+    if (src.size() > capacity) return 0;
+    memcpy(dst, src.data(), src.size());
+    return src.size();
+}
+
+static usize GetEntries(ArchiveInstance inst, RD_EntryRecord* records, usize capacity) {
+    auto* arc = (DemoArchive*)inst;
+    if (!arc) return 0;
+
+    usize count = std::min(capacity, arc->entries.size());
+    for (usize i = 0; i < count; i++) {
+        records[i] = {
+            .name = arc->entries[i].name.c_str(),
+            .size = arc->entries[i].content.size(),
+            .offset = 0,
+            .flags = 0,
+        };
+    }
+    return count;
+}
+
 static void ArchiveDestroy(ArchiveBaseHandle *handle) {
     rd_log(RD_LOG_LVL_INFO, "ArchiveDestroy called!");
     delete handle;
@@ -50,7 +83,9 @@ static ArchiveBaseVTable g_baseVTable = {
     &GetEntryName,
     &GetEntrySize,
     &OpenStream,
-    &ArchiveDestroy
+    &ArchiveDestroy,
+    &GetEntries,
+    &OpenStreamInto,
 };
 
 // -------------------- Archive Format Wrapper --------------------
@@ -101,8 +136,14 @@ extern "C" {
 bool RD_PluginInit(HostAPI *api) {
     if (!api) return false;
     sdk_ctx* ctx = api->get_sdk_context();
+    // OpenStream needs HostAPI::allocate, which older hosts don't have.
+    if (!ctx || ctx->version < 4) {
+        Logger::error("Example plugin needs plugin ABI v4");
+        return false;
+    }
     Logger::log("Example plugin initialized");
     g_ctx = ctx;
+    g_api = api;
 
     return true;
 }
@@ -5,6 +5,8 @@
 extern "C" {
     RD_EXPORT const char* RD_PluginName;
     RD_EXPORT const char* RD_PluginVersion;
+    RD_EXPORT const u32 RD_PluginABIVersion;
+    RD_EXPORT const u32 RD_PluginCapabilities;
 }
 
 struct Entry {
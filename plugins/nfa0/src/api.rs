@@ -4,9 +4,11 @@ use std::{
 };
 
 // API defs
-// Really don't care about the fields here
+// Only the leading version field is read, the rest is the host's business
 #[repr(C)]
-pub struct SdkCtx;
+pub struct SdkCtx {
+    version: i32,
+}
 
 pub type LogFn = extern "C" fn(ctx: *mut SdkCtx, fmt: *const i8);
 
@@ -124,15 +126,36 @@ pub struct HostApi {
     pub warn: LogFn,
     pub error: LogFn,
     pub log_fmtv: LogFmtvFn,
+    // ABI v4. Older hosts' HostAPI ends at log_fmtv, only read these once the SDK context says v4 or newer.
+    allocate: Option<extern "C" fn(size: usize) -> *mut core::ffi::c_void>,
+    deallocate: Option<extern "C" fn(ptr: *mut core::ffi::c_void, size: usize)>,
+}
+
+unsafe extern "C" {
+    fn malloc(size: usize) -> *mut core::ffi::c_void;
+    fn free(ptr: *mut core::ffi::c_void);
 }
 
 pub struct HostApiWrapper {
     api: OnceLock<&'static HostApi>,
+    host_version: OnceLock<i32>,
 }
 
 impl HostApiWrapper {
     pub fn init(&self, api: &'static HostApi) {
         let _ = self.api.set(api);
+        let ctx = (api.get_sdk_context)();
+        // SAFETY: the host sets up its SDK context before initializing plugins, version is its first field.
+        let version = if ctx.is_null() { 0 } else { unsafe { (*ctx).version } };
+        let _ = self.host_version.set(version);
+    }
+
+    /// The host API, if the host is new enough to have the allocator fields.
+    fn api_v4(&self) -> Option<&'static HostApi> {
+        self.api
+            .get()
+            .copied()
+            .filter(|_| self.host_version.get().is_some_and(|&v| v >= 4))
     }
 
     pub fn get_sdk_context(&self) -> *mut SdkCtx {
@@ -142,6 +165,23 @@ impl HostApiWrapper {
         core::ptr::null_mut()
     }
 
+    /// Memory the host is allowed to free, for buffers handed back from OpenStream.
+    pub fn allocate(&self, size: usize) -> *mut u8 {
+        match self.api_v4().and_then(|api| api.allocate) {
+            Some(allocate) => allocate(size) as *mut u8,
+            // Hosts without an allocator free OpenStream buffers with the C runtime's free.
+            None => unsafe { malloc(size) as *mut u8 },
+        }
+    }
+
+    #[allow(dead_code)]
+    pub fn deallocate(&self, ptr: *mut u8, size: usize) {
+        match self.api_v4().and_then(|api| api.deallocate) {
+            Some(deallocate) => deallocate(ptr as *mut _, size),
+            None => unsafe { free(ptr as *mut _) },
+        }
+    }
+
     fn log_base(&self, log_fn: LogFn, message: &str) {
         let ctx = self.get_sdk_context();
         let str = CString::new(message);
@@ -209,8 +249,105 @@ impl HostApiWrapper {
 
 pub static HOST_API: HostApiWrapper = HostApiWrapper {
     api: OnceLock::new(),
+    host_version: OnceLock::new(),
 };
 
+/// ABI version this crate implements, exported as `RD_PluginABIVersion`.
+pub const RD_ABI_VERSION: u32 = 4;
+
+pub const RD_CAP_REENTRANT_OPEN_STREAM: u32 = 1 << 0;
+pub const RD_CAP_STATELESS_CAN_HANDLE_FILE: u32 = 1 << 1;
+
+#[allow(dead_code)]
+pub const RD_ENTRY_PACKED: u32 = 1 << 0;
+#[allow(dead_code)]
+pub const RD_ENTRY_ENCRYPTED: u32 = 1 << 1;
+
+#[repr(C)]
+pub struct RdEntryRecord {
+    pub name: *const i8,
+    pub size: u64,
+    pub offset: u64,
+    pub flags: u32,
+}
+
+#[repr(C)]
+pub struct RdArchiveSource {
+    pub size: u64,
+    pub data: *const u8,
+    pub read_at: extern "C" fn(source: *const RdArchiveSource, offset: u64, length: usize, dst: *mut u8) -> usize,
+    pub host: *mut core::ffi::c_void,
+}
+
+/// The archive a format was opened from. Either the host's source, which stays valid until the archive is destroyed,
+/// or an owned copy for hosts that only hand out a temporary buffer (ABI v1/v2).
+pub enum ArchiveSource {
+    Host(*const RdArchiveSource),
+    Owned(Vec<u8>),
+}
+
+// The host documents read_at as callable from any thread and the source as immutable.
+unsafe impl Send for ArchiveSource {}
+unsafe impl Sync for ArchiveSource {}
+
+impl ArchiveSource {
+    pub fn size(&self) -> u64 {
+        match self {
+            ArchiveSource::Host(source) => unsafe { (**source).size },
+            ArchiveSource::Owned(data) => data.len() as u64,
+        }
+    }
+
+    /// The whole archive, when the host keeps it in memory.
+    pub fn data(&self) -> Option<&[u8]> {
+        match self {
+            ArchiveSource::Host(source) => {
+                let source = unsafe { &**source };
+                if source.data.is_null() {
+                    None
+                } else {
+                    Some(unsafe { std::slice::from_raw_parts(source.data, source.size as usize) })
+                }
+            }
+            ArchiveSource::Owned(data) => Some(data),
+        }
+    }
+
+    /// Fills `dst` from `offset`, returns how many bytes were read.
+    pub fn read_at(&self, offset: u64, dst: &mut [u8]) -> usize {
+        match self {
+            ArchiveSource::Host(source) => {
+                let read_at = unsafe { (**source).read_at };
+                read_at(*source, offset, dst.len(), dst.as_mut_ptr())
+            }
+            ArchiveSource::Owned(data) => {
+                let Ok(start) = usize::try_from(offset) else { return 0 };
+                if start >= data.len() {
+                    return 0;
+                }
+                let count = dst.len().min(data.len() - start);
+                dst[..count].copy_from_slice(&data[start..start + count]);
+                count
+            }
+        }
+    }
+
+    pub fn read_exact_at(&self, offset: u64, dst: &mut [u8]) -> Option<()> {
+        (self.read_at(offset, dst) == dst.len()).then_some(())
+    }
+
+    /// `len` bytes from `offset`, borrowed from the archive when possible and read into a new buffer otherwise.
+    pub fn slice_at(&self, offset: u64, len: usize) -> Option<std::borrow::Cow<'_, [u8]>> {
+        if let Some(data) = self.data() {
+            let start = usize::try_from(offset).ok()?;
+            return data.get(start..start.checked_add(len)?).map(std::borrow::Cow::Borrowed);
+        }
+        let mut buf = vec![0u8; len];
+        self.read_exact_at(offset, &mut buf)?;
+        Some(std::borrow::Cow::Owned(buf))
+    }
+}
+
 pub type ArchiveHandle = *mut core::ffi::c_void;
 pub type ArchiveInstance = *mut core::ffi::c_void;
 
@@ -221,6 +358,8 @@ pub struct ArchiveBaseVTable {
     pub get_entry_size: extern "C" fn(inst: ArchiveInstance, index: usize) -> usize,
     pub open_stream: extern "C" fn(inst: ArchiveInstance, index: usize, out_size: *mut usize) -> *const u8,
     pub destroy: extern "C" fn(inst: *mut ArchiveBaseHandle),
+    pub get_entries: extern "C" fn(inst: ArchiveInstance, records: *mut RdEntryRecord, capacity: usize) -> usize,
+    pub open_stream_into: extern "C" fn(inst: ArchiveInstance, index: usize, dst: *mut u8, capacity: usize) -> usize,
 }
 
 #[repr(C)]
@@ -251,6 +390,11 @@ pub struct ArchiveFormatVTable {
     ) -> *mut ArchiveBaseHandle,
     pub get_tag: extern "C" fn(inst: ArchiveHandle) -> *const i8,
     pub get_description: extern "C" fn(inst: ArchiveHandle) -> *const i8,
+    pub try_open_source: extern "C" fn(
+        inst: ArchiveHandle,
+        source: *const RdArchiveSource,
+        file_name: *const i8,
+    ) -> *mut ArchiveBaseHandle,
 }
 
 #[repr(transparent)]
@@ -305,25 +449,64 @@ extern "C" fn open_stream_wrapper<T: RdFormat<'static> + 'static>(
         return core::ptr::null();
     }
 
-    let archive = unsafe { &mut *(inst as *mut T) };
-    let ret = archive.open_stream(index);
+    let archive = unsafe { &*(inst as *const T) };
 
-    if let Some(data) = ret {
-        if !out_size.is_null() {
-            unsafe {
-                *out_size = data.len();
-            }
+    // The host frees the buffer, so the data is moved into memory from its allocator rather than leaking the Vec.
+    let buffer = archive.open_stream(index).and_then(|data| {
+        let buffer = HOST_API.allocate(data.len());
+        if buffer.is_null() {
+            return None;
         }
-        
-        data.leak() as *mut _ as *const _
-    } else {
-        if !out_size.is_null() {
-            unsafe {
-                *out_size = 0;
-            }
+        unsafe { core::ptr::copy_nonoverlapping(data.as_ptr(), buffer, data.len()) };
+        Some((buffer, data.len()))
+    });
+
+    if !out_size.is_null() {
+        unsafe {
+            *out_size = buffer.map_or(0, |(_, len)| len);
         }
-        core::ptr::null()
     }
+    buffer.map_or(core::ptr::null(), |(buffer, _)| buffer as *const u8)
+}
+
+extern "C" fn open_stream_into_wrapper<T: RdFormat<'static> + 'static>(
+    inst: ArchiveInstance,
+    index: usize,
+    dst: *mut u8,
+    capacity: usize,
+) -> usize {
+    if inst.is_null() || dst.is_null() {
+        return 0;
+    }
+
+    let archive = unsafe { &*(inst as *const T) };
+    let dst = unsafe { std::slice::from_raw_parts_mut(dst, capacity) };
+    archive.open_stream_into(index, dst).unwrap_or(0)
+}
+
+extern "C" fn get_entries_wrapper<T: RdFormat<'static> + 'static>(
+    inst: ArchiveInstance,
+    records: *mut RdEntryRecord,
+    capacity: usize,
+) -> usize {
+    if inst.is_null() || records.is_null() {
+        return 0;
+    }
+
+    let archive = unsafe { &*(inst as *const T) };
+    let count = archive.get_entry_count().min(capacity);
+    let records = unsafe { std::slice::from_raw_parts_mut(records, count) };
+    for (idx, record) in records.iter_mut().enumerate() {
+        *record = RdEntryRecord {
+            name: archive
+                .get_entry_name(idx)
+                .map_or(core::ptr::null(), |name| name.as_ptr()),
+            size: archive.get_entry_size(idx) as u64,
+            offset: archive.get_entry_offset(idx),
+            flags: archive.get_entry_flags(idx),
+        };
+    }
+    count
 }
 
 extern "C" fn destroy_wrapper<T: RdFormat<'static> + 'static>(handle: *mut ArchiveBaseHandle) {
@@ -332,17 +515,21 @@ extern "C" fn destroy_wrapper<T: RdFormat<'static> + 'static>(handle: *mut Archi
     }
 
     unsafe {
-        if !(*handle).inst.is_null() {
-            let inst = Box::from_raw((*handle).inst as *mut T);
-            drop(inst);
+        let handle = Box::from_raw(handle);
+        if !handle.inst.is_null() {
+            drop(Box::from_raw(handle.inst as *mut T));
         }
     }
 }
 
-pub trait RdFormat<'a: 'static>: Sized
+// Sync because the host may call into an archive from several threads when CAPABILITIES allows it.
+pub trait RdFormat<'a: 'static>: Sized + Sync
 where
     Self: 'static,
 {
+    /// RD_CAP_* flags exported as `RD_PluginCapabilities`.
+    const CAPABILITIES: u32 = 0;
+
     fn plugin_init() -> bool;
     fn plugin_shutdown();
 
@@ -350,12 +537,25 @@ where
     fn description() -> &'static CStr;
 
     fn can_handle_file(buffer: &[u8], ext: &CStr) -> bool;
-    fn try_open(buffer: &[u8], file_name: &CStr) -> Option<Self>;
+    fn try_open(source: ArchiveSource, file_name: &CStr) -> Option<Self>;
 
     fn get_entry_count(&'a self) -> usize;
     fn get_entry_name(&'a self, idx: usize) -> Option<&'a CStr>;
     fn get_entry_size(&'a self, idx: usize) -> usize;
-    fn open_stream(&'a mut self, idx: usize) -> Option<Vec<u8>>;
+    fn get_entry_offset(&'a self, _idx: usize) -> u64 {
+        0
+    }
+    fn get_entry_flags(&'a self, _idx: usize) -> u32 {
+        0
+    }
+    fn open_stream(&'a self, idx: usize) -> Option<Vec<u8>>;
+    /// Decodes the entry into `dst` and returns its size. Formats that can write their output in place should
+    /// override this, the default goes through open_stream and copies.
+    fn open_stream_into(&'a self, idx: usize, dst: &mut [u8]) -> Option<usize> {
+        let data = self.open_stream(idx)?;
+        dst.get_mut(..data.len())?.copy_from_slice(&data);
+        Some(data.len())
+    }
 
     const BASE_VTABLE: ArchiveBaseVTable = ArchiveBaseVTable {
         get_entry_count: get_entry_count_wrapper::<Self>,
@@ -363,6 +563,8 @@ where
         get_entry_size: get_entry_size_wrapper::<Self>,
         open_stream: open_stream_wrapper::<Self>,
         destroy: destroy_wrapper::<Self>,
+        get_entries: get_entries_wrapper::<Self>,
+        open_stream_into: open_stream_into_wrapper::<Self>,
     };
 
     const FORMAT_VTABLE: ArchiveFormatVTable = ArchiveFormatVTable {
@@ -371,6 +573,7 @@ where
         try_open: try_open_wrapper::<Self>,
         get_tag: get_tag_wrapper::<Self>,
         get_description: get_description_wrapper::<Self>,
+        try_open_source: try_open_source_wrapper::<Self>,
     };
 }
 
@@ -417,7 +620,25 @@ extern "C" fn try_open_wrapper<T: RdFormat<'static> + 'static>(
         return core::ptr::null_mut();
     };
 
-    let Some(arc) = T::try_open(buffer, file_name) else {
+    // Hosts calling this entry point make no promise about the buffer outliving the call, so keep a copy.
+    new_handle::<T>(T::try_open(ArchiveSource::Owned(Vec::from(buffer)), file_name))
+}
+
+extern "C" fn try_open_source_wrapper<T: RdFormat<'static> + 'static>(
+    _inst: ArchiveHandle,
+    source: *const RdArchiveSource,
+    file_name: *const i8,
+) -> *mut ArchiveBaseHandle {
+    if source.is_null() || file_name.is_null() {
+        return core::ptr::null_mut();
+    }
+    let file_name = unsafe { CStr::from_ptr(file_name) };
+
+    new_handle::<T>(T::try_open(ArchiveSource::Host(source), file_name))
+}
+
+fn new_handle<T: RdFormat<'static> + 'static>(arc: Option<T>) -> *mut ArchiveBaseHandle {
+    let Some(arc) = arc else {
         return core::ptr::null_mut();
     };
 
@@ -451,6 +672,14 @@ macro_rules! register_plugin {
         pub static RD_PluginVersion: crate::api::ShutUpAboutSync =
             crate::api::ShutUpAboutSync($version.as_ptr());
 
+        #[unsafe(no_mangle)]
+        #[allow(non_upper_case_globals)]
+        pub static RD_PluginABIVersion: u32 = crate::api::RD_ABI_VERSION;
+
+        #[unsafe(no_mangle)]
+        #[allow(non_upper_case_globals)]
+        pub static RD_PluginCapabilities: u32 = <$ty as crate::api::RdFormat>::CAPABILITIES;
+
         #[unsafe(no_mangle)]
         pub extern "C" fn RD_PluginInit(api: *mut crate::api::HostApi) -> bool {
             if api.is_null() {
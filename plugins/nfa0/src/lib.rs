@@ -1,27 +1,31 @@
-#![feature(str_from_utf16_endian)]
+use std::ffi::{CStr, CString};
 
-use byteorder::{LittleEndian, ReadBytesExt};
-use std::{
-    ffi::{CStr, CString},
-    io::{Cursor, Read, Seek},
-};
-
-use crate::api::RdFormat;
+use crate::api::{ArchiveSource, RdFormat, RD_CAP_REENTRANT_OPEN_STREAM, RD_CAP_STATELESS_CAN_HANDLE_FILE};
 
 mod api;
 mod logging;
 
+const HEADER_SIZE: usize = 16;
+const ENTRY_SIZE: usize = 148;
+
 struct NemeaEntry {
     pub name: CString,
     pub offset: u32,
     pub size: u32,
 }
 struct NemeaArchive {
-    pub cur: Cursor<Vec<u8>>,
+    pub source: ArchiveSource,
     pub entries: Vec<NemeaEntry>,
 }
 
+fn read_u32(bytes: &[u8], offset: usize) -> u32 {
+    u32::from_le_bytes(bytes[offset..offset + 4].try_into().unwrap())
+}
+
 impl<'a: 'static> RdFormat<'a> for NemeaArchive {
+    // Entries are decoded from the immutable source into the caller's buffer, nothing is shared between calls.
+    const CAPABILITIES: u32 = RD_CAP_REENTRANT_OPEN_STREAM | RD_CAP_STATELESS_CAN_HANDLE_FILE;
+
     fn plugin_init() -> bool {
         rd_log!("[NFA0] Plugin initialized!");
         
@@ -36,48 +40,40 @@ impl<'a: 'static> RdFormat<'a> for NemeaArchive {
         c"NFA0 format as seen in 不思議の幻想郷CHRONICLE -クロニクル-"
     }
 
-    fn try_open(buffer: &[u8], file_name: &CStr) -> Option<Self> {
-        let mut cur = Cursor::new(Vec::from(buffer));
-
-        let mut magic = [0u8; 4];
-        cur.read_exact(&mut magic).ok()?;
-        if &magic != b"NFA0" {
+    fn try_open(source: ArchiveSource, file_name: &CStr) -> Option<Self> {
+        let mut header = [0u8; HEADER_SIZE];
+        source.read_exact_at(0, &mut header)?;
+        if &header[0..4] != b"NFA0" || read_u32(&header, 4) != 1 || read_u32(&header, 12) != 1 {
             return None;
         }
-        if cur.read_u32::<LittleEndian>().ok()? != 1 {
-            return None;
-        }
-        let file_count = cur.read_u32::<LittleEndian>().ok()?;
-        if cur.read_u32::<LittleEndian>().ok()? != 1 {
+        let file_count = read_u32(&header, 8) as usize;
+
+        // Only the index is read up front, entry data stays in the host's buffer until it's opened.
+        let index_size = file_count.checked_mul(ENTRY_SIZE)?;
+        if (HEADER_SIZE + index_size) as u64 > source.size() {
             return None;
         }
-
-        let mut entries = Vec::with_capacity(file_count as usize);
-        for _ in 0..file_count {
-            cur.seek_relative(8).ok()?; // checksum
-            let size = cur.read_u32::<LittleEndian>().ok()? ^ 0x08080808;
-            let offset = cur.read_u32::<LittleEndian>().ok()? ^ 0x08080808;
-            cur.seek_relative(4).ok()?; // unknown
-
-            // Needs multiple passes. Gross...
-            let mut name_bytes = [0u8; 128];
-            cur.read_exact(&mut name_bytes).ok()?;
-            for i in 0..128 {
-                name_bytes[i] ^= 0x08;
+        let index = source.slice_at(HEADER_SIZE as u64, index_size)?;
+
+        let mut entries = Vec::with_capacity(file_count);
+        for record in index.chunks_exact(ENTRY_SIZE) {
+            // 8 bytes of checksum, then size and offset, 4 unknown bytes and the name.
+            let size = read_u32(record, 8) ^ 0x08080808;
+            let offset = read_u32(record, 12) ^ 0x08080808;
+            if offset as u64 + size as u64 > source.size() {
+                return None;
             }
 
-            let terminator_idx = {
-                let mut ret: usize = 0;
-                for i in (0..128).step_by(2) {
-                    if name_bytes[i] == 0 && name_bytes[i + 1] == 0 {
-                        break;
-                    }
-                    ret += 2;
-                }
-                ret
-            };
-
-            let name = String::from_utf16le_lossy(&name_bytes[..terminator_idx]).replace('\\', "/");
+            let units = record[20..].chunks_exact(2)
+                .map(|pair| u16::from_le_bytes([pair[0] ^ 0x08, pair[1] ^ 0x08]))
+                .take_while(|&unit| unit != 0);
+            let name: String = char::decode_utf16(units)
+                .map(|c| match c {
+                    Ok('\\') => '/',
+                    Ok(c) => c,
+                    Err(_) => char::REPLACEMENT_CHARACTER,
+                })
+                .collect();
             let name = CString::new(name).ok()?;
 
             entries.push(NemeaEntry {
@@ -86,15 +82,16 @@ impl<'a: 'static> RdFormat<'a> for NemeaArchive {
                 size,
             });
         }
+        drop(index);
 
         rd_log!(
             "[NFA0] Opened '{}' with {} entries ({} bytes total)",
             file_name.to_str().unwrap(),
             entries.len(),
-            buffer.len()
+            source.size()
         );
 
-        Some(NemeaArchive { cur, entries })
+        Some(NemeaArchive { source, entries })
     }
     fn can_handle_file(buffer: &[u8], ext: &CStr) -> bool {
         ext == c"bin" && buffer.len() >= 16 && &buffer[0..4] == b"NFA0"
@@ -117,22 +114,39 @@ impl<'a: 'static> RdFormat<'a> for NemeaArchive {
 
         self.entries[idx].size as usize
     }
-    fn open_stream(&'a mut self, idx: usize) -> Option<Vec<u8>> {
-        if idx >= self.entries.len() {
-            return None;
-        }
-        
-        let entry = &self.entries[idx];
-        self.cur.seek(std::io::SeekFrom::Start(entry.offset as u64))
-            .ok()?;
-        let mut content = vec![0u8; entry.size as usize];
-        self.cur.read_exact(&mut content).ok()?;
-        for i in 0..content.len() {
-            content[i] ^= 0x08;
-        }
+    fn get_entry_offset(&'a self, idx: usize) -> u64 {
+        self.entries.get(idx).map_or(0, |entry| entry.offset as u64)
+    }
+    fn open_stream(&'a self, idx: usize) -> Option<Vec<u8>> {
+        let size = self.entries.get(idx)?.size as usize;
+        let mut content = vec![0u8; size];
+        self.open_stream_into(idx, &mut content)?;
 
         Some(content)
     }
+    fn open_stream_into(&'a self, idx: usize, dst: &mut [u8]) -> Option<usize> {
+        let entry = self.entries.get(idx)?;
+        let dst = dst.get_mut(..entry.size as usize)?;
+
+        // Decode straight out of the host's buffer when it has one.
+        match self.source.data() {
+            Some(data) => {
+                let start = entry.offset as usize;
+                let src = data.get(start..start + dst.len())?;
+                for (out, byte) in dst.iter_mut().zip(src) {
+                    *out = byte ^ 0x08;
+                }
+            }
+            None => {
+                self.source.read_exact_at(entry.offset as u64, dst)?;
+                for byte in dst.iter_mut() {
+                    *byte ^= 0x08;
+                }
+            }
+        }
+
+        Some(dst.len())
+    }
 }
 
 register_plugin!(c"Nemea NFA0", c"1.0.0", NemeaArchive);
@@ -2,7 +2,10 @@
 
 #include "ExeFile.h"
 #include "Entry.h"
+#include <algorithm>
 #include <cstring>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <util/int.h>
 #include <SDK/util/Logger.hpp>
@@ -19,6 +22,28 @@ class ArchiveBase {
         ArchiveBase(const EntryMap &entries) : entries(entries) {};
 
         virtual u8* OpenStream(const Entry *entry, u8 *buffer) = 0;
+        // Reads `length` bytes starting `offset` bytes into the entry. Returns how many bytes were written to `dest`,
+        // formats that can't seek inside an entry return 0 and callers should fall back to OpenStream.
+        virtual usize ReadRange(const Entry *entry, u8 *buffer, u64 offset, u8 *dest, usize length) {
+            return 0;
+        }
+        // Whether OpenStream may be called from several threads at once, lets extraction spread entries over workers.
+        virtual bool ConcurrentStreams() const {
+            return false;
+        }
+        // Held around OpenStream/ReadRange by everything that reads entries off the UI thread (previews, thumbnails,
+        // extraction, audio), so archives that can't take concurrent calls only ever see one at a time.
+        std::unique_lock<std::mutex> LockStreams() {
+            if (ConcurrentStreams()) return {};
+            return std::unique_lock<std::mutex>(stream_mutex);
+        }
+        // How many threads, this one included, are calling OpenStream at the same time. Set by whatever spreads entries
+        // over workers, so formats that also split a single entry over threads only take their share of the cores.
+        static inline thread_local usize stream_workers = 1;
+        static usize ThreadsPerStream() {
+            usize cores = std::max(1u, std::thread::hardware_concurrency());
+            return std::max<usize>(1, cores / stream_workers);
+        }
         virtual EntryMapPtr GetEntries() {
             EntryMapPtr entries;
             for (auto& [name, entry] : this->entries)
@@ -30,6 +55,8 @@ class ArchiveBase {
         virtual void ArchiveDestroy() {
             // No-op, meant for plugin api.
         }
+    private:
+        std::mutex stream_mutex;
 };
 
 class ArchiveFormat {
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstring>
+#include <util/int.h>
+
+// Building blocks shared by the LZ and Huffman decoders of the archive formats.
+
+// MSB-first bit buffer. Bits are kept left aligned in a u64 and topped up a whole word at a time, so after a Refill
+// at least 56 bits can be read without checking anything. Past the end of the data the stream reads as zeroes,
+// Overrun() tells whether any of those were actually consumed.
+class MSBBitBuffer {
+    const u8 *data;
+    usize size;
+    usize position = 0;
+    u64 bits = 0;
+    u32 count = 0;
+    u64 consumed = 0;
+
+    static u64 ByteSwap64(u64 value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_bswap64(value);
+#else
+        value = ((value & 0x00FF00FF00FF00FFull) << 8) | ((value >> 8) & 0x00FF00FF00FF00FFull);
+        value = ((value & 0x0000FFFF0000FFFFull) << 16) | ((value >> 16) & 0x0000FFFF0000FFFFull);
+        return (value << 32) | (value >> 32);
+#endif
+    }
+
+public:
+    static constexpr u32 MaxRead = 56;
+
+    MSBBitBuffer(const u8 *data, usize size) : data(data), size(size) {}
+
+    void Refill() {
+        if (position + sizeof(u64) <= size) {
+            u64 word;
+            memcpy(&word, data + position, sizeof(u64));
+            bits |= ByteSwap64(word) >> count;
+            position += (63 - count) >> 3;
+            count |= 56;
+            return;
+        }
+        while (count <= 56) {
+            u64 byte = position < size ? data[position] : 0;
+            bits |= byte << (56 - count);
+            position++;
+            count += 8;
+        }
+    }
+
+    u32 Peek(u32 n) const {
+        return (u32)(bits >> (64 - n));
+    }
+
+    void Skip(u32 n) {
+        bits <<= n;
+        count -= n;
+        consumed += n;
+    }
+
+    u32 Read(u32 n) {
+        u32 value = Peek(n);
+        Skip(n);
+        return value;
+    }
+
+    bool Overrun() const {
+        return consumed > (u64)size * 8;
+    }
+};
+
+// Extra bytes LzCopyMatch may write past the end of a match.
+static constexpr usize LzCopyOverrun = sizeof(u64) - 1;
+
+// Copies a match that starts `distance` bytes back. Overlapping matches repeat the last `distance` bytes, so short
+// distances are first widened by doubling the pattern until an 8 byte store never reads bytes it hasn't written yet.
+// Writes in whole 8 byte stores, callers need LzCopyOverrun bytes of room after the match.
+static inline void LzCopyMatch(u8 *dst, usize distance, usize length) {
+    const u8 *src = dst - distance;
+    if (distance >= sizeof(u64)) {
+        for (usize i = 0; i < length; i += sizeof(u64)) {
+            u64 chunk;
+            memcpy(&chunk, src + i, sizeof(u64));
+            memcpy(dst + i, &chunk, sizeof(u64));
+        }
+        return;
+    }
+
+    usize i = 0;
+    while (distance < sizeof(u64) && i < length) {
+        memcpy(dst + i, dst + i - distance, distance);
+        i += distance;
+        distance *= 2;
+    }
+    for (; i < length; i += sizeof(u64)) {
+        u64 chunk;
+        memcpy(&chunk, dst + i - distance, sizeof(u64));
+        memcpy(dst + i, &chunk, sizeof(u64));
+    }
+}
+
+// Classic LZSS: a 0x1000 byte zeroed ring starting at 0xFEE, flag bytes read LSB first with 1 meaning a literal and
+// matches of 3 to 18 bytes as 12 bit ring position and 4 bit length. Ring slot `n` holds output byte n - 0xFEE
+// (mod 0x1000), so matches are copied from the output directly. Returns the number of bytes written, short of
+// `out_size` if the input ran out first.
+static inline usize LzssDecode(const u8 *packed, usize packed_size, u8 *out, usize out_size) {
+    constexpr usize RingSize = 0x1000;
+    constexpr usize RingMask = RingSize - 1;
+    constexpr usize RingStart = 0xFEE;
+    constexpr usize CopySlack = 0x12 + LzCopyOverrun;
+
+    const u8 *in = packed;
+    const u8 *in_end = packed + packed_size;
+    usize written = 0;
+    u32 flags = 0;
+
+    while (written < out_size) {
+        flags >>= 1;
+        if (!(flags & 0x100)) {
+            if (in >= in_end) break;
+            flags = *in++ | 0xFF00;
+        }
+
+        if (flags & 1) {
+            if (in >= in_end) break;
+            out[written++] = *in++;
+            continue;
+        }
+
+        if (in_end - in < 2) break;
+        usize offset = in[0] | ((in[1] & 0xF0) << 4);
+        usize length = (in[1] & 0x0F) + 3;
+        in += 2;
+
+        usize head = (RingStart + written) & RingMask;
+        usize distance = (head - offset) & RingMask;
+        if (distance == 0) distance = RingSize;
+
+        if (distance <= written && written + CopySlack <= out_size) {
+            LzCopyMatch(out + written, distance, length);
+            written += length;
+            continue;
+        }
+
+        for (usize i = 0; i < length && written < out_size; ++i) {
+            out[written] = written >= distance ? out[written - distance] : 0;
+            written++;
+        }
+    }
+
+    return written;
+}
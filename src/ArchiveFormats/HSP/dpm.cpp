@@ -0,0 +1,133 @@
+#include "dpm.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DPM_SCAN_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DPM_SCAN_NEON
+#endif
+
+static inline u8 Transform(u8 in, u8 s1, u8 s2) {
+    return s1 ^ (u8)(in - s2);
+}
+
+u8 DPM::Scan(const u8 *in, u8 *out, usize size, u8 s1, u8 s2, u8 val) {
+    usize i = 0;
+#if defined(DPM_SCAN_SSE2)
+    const __m128i vs1 = _mm_set1_epi8((char)s1);
+    const __m128i vs2 = _mm_set1_epi8((char)s2);
+    __m128i carry = _mm_set1_epi8((char)val);
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        x = _mm_xor_si128(_mm_sub_epi8(x, vs2), vs1);
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi8(x, carry);
+        _mm_storeu_si128((__m128i*)(out + i), x);
+
+        // Broadcast byte 15 for the next block (no pshufb in plain SSE2).
+        carry = _mm_unpackhi_epi8(x, x);
+        carry = _mm_shufflehi_epi16(carry, _MM_SHUFFLE(3, 3, 3, 3));
+        carry = _mm_shuffle_epi32(carry, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    val = (u8)_mm_cvtsi128_si32(carry);
+#elif defined(DPM_SCAN_NEON)
+    const uint8x16_t vs1 = vdupq_n_u8(s1);
+    const uint8x16_t vs2 = vdupq_n_u8(s2);
+    const uint8x16_t zero = vdupq_n_u8(0);
+    uint8x16_t carry = vdupq_n_u8(val);
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t x = veorq_u8(vsubq_u8(vld1q_u8(in + i), vs2), vs1);
+        x = vaddq_u8(x, vextq_u8(zero, x, 15));
+        x = vaddq_u8(x, vextq_u8(zero, x, 14));
+        x = vaddq_u8(x, vextq_u8(zero, x, 12));
+        x = vaddq_u8(x, vextq_u8(zero, x, 8));
+        x = vaddq_u8(x, carry);
+        vst1q_u8(out + i, x);
+        carry = vdupq_n_u8(vgetq_lane_u8(x, 15));
+    }
+    val = vgetq_lane_u8(carry, 0);
+#endif
+    for (; i < size; ++i) {
+        val += Transform(in[i], s1, s2);
+        out[i] = val;
+    }
+    return val;
+}
+
+u8 DPM::BlockSum(const u8 *in, usize size, u8 s1, u8 s2) {
+    usize i = 0;
+    u8 sum = 0;
+#if defined(DPM_SCAN_SSE2)
+    const __m128i vs1 = _mm_set1_epi8((char)s1);
+    const __m128i vs2 = _mm_set1_epi8((char)s2);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        x = _mm_xor_si128(_mm_sub_epi8(x, vs2), vs1);
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(x, zero));
+    }
+    sum = (u8)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc)));
+#elif defined(DPM_SCAN_NEON)
+    const uint8x16_t vs1 = vdupq_n_u8(s1);
+    const uint8x16_t vs2 = vdupq_n_u8(s2);
+    uint8x16_t acc = vdupq_n_u8(0);
+    for (; i + 16 <= size; i += 16) {
+        acc = vaddq_u8(acc, veorq_u8(vsubq_u8(vld1q_u8(in + i), vs2), vs1));
+    }
+    sum = (u8)vaddlvq_u8(acc);
+#endif
+    for (; i < size; ++i) {
+        sum += Transform(in[i], s1, s2);
+    }
+    return sum;
+}
+
+// Every thread sums its block, the sums are prefixed serially, then every thread scans its block starting from the
+// running value of everything before it.
+void DPM::ScanParallel(const u8 *in, u8 *out, usize size, u8 s1, u8 s2, usize thread_count) {
+    if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    usize block_count = std::min(thread_count, size / MinBlockSize);
+    if (block_count <= 1) {
+        Scan(in, out, size, s1, s2, 0);
+        return;
+    }
+
+    usize block_size = (size + block_count - 1) / block_count;
+    std::vector<u8> carries(block_count, 0);
+    std::vector<std::thread> workers;
+    workers.reserve(block_count);
+
+    // The first block doesn't need a carry, so it can be scanned while the others are summed.
+    workers.emplace_back([=]() {
+        Scan(in, out, std::min(block_size, size), s1, s2, 0);
+    });
+    for (usize b = 1; b < block_count; ++b) {
+        workers.emplace_back([&, b]() {
+            usize start = (b - 1) * block_size;
+            carries[b] = BlockSum(in + start, std::min(block_size, size - start), s1, s2);
+        });
+    }
+    for (auto &worker : workers) worker.join();
+    workers.clear();
+
+    for (usize b = 2; b < block_count; ++b) {
+        carries[b] += carries[b - 1];
+    }
+
+    for (usize b = 1; b < block_count; ++b) {
+        workers.emplace_back([&, b]() {
+            usize start = b * block_size;
+            if (start >= size) return;
+            Scan(in + start, out + start, std::min(block_size, size - start), s1, s2, carries[b]);
+        });
+    }
+    for (auto &worker : workers) worker.join();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <util/int.h>
+
+// DPM decryption is val += s1 ^ (in[i] - s2), i.e. a running u8 sum of a per-byte transform.
+// Addition mod 256 is associative, so it can be computed as a prefix sum, both inside a vector and across blocks.
+namespace DPM {
+    // Entries above this get split into blocks and scanned on several threads.
+    constexpr usize ParallelThreshold = 16 * 1024 * 1024;
+    constexpr usize MinBlockSize = 4 * 1024 * 1024;
+
+    // Writes the running sum of `in` to `out`, starting from `val`. Returns the final running value.
+    u8 Scan(const u8 *in, u8 *out, usize size, u8 s1, u8 s2, u8 val);
+    // Sum of the transformed bytes, i.e. what a block contributes to the running value of the blocks after it.
+    u8 BlockSum(const u8 *in, usize size, u8 s1, u8 s2);
+    // Same output as Scan from 0, split over up to `thread_count` threads (0 for one per hardware thread) in blocks of
+    // at least MinBlockSize.
+    void ScanParallel(const u8 *in, u8 *out, usize size, u8 s1, u8 s2, usize thread_count = 0);
+}
@@ -1,6 +1,8 @@
 #include "hsp.h"
+#include "dpm.h"
 #include <unordered_map>
 #include <algorithm>
+#include <vector>
 
 i32 FindString(u8 *section_base, size_t section_size, const std::vector<u8> &pattern, int step = 1) {
     if (step <= 0) return -1;
@@ -145,5 +147,26 @@ u8* DPMArchive::OpenStream(const Entry *entry, u8 *buffer)
         return DecryptEntry(data, entry->size, entry->key);
     }
 
-    return data;
+    // Callers own (and free) whatever OpenStream returns, so don't hand out a pointer into the archive.
+    u8 *copy = malloc<u8>(entry->size);
+    if (copy) memcpy(copy, data, entry->size);
+    return copy;
+}
+
+u8* DPMArchive::DecryptEntry(u8 *data, u32 data_size, u32 entry_key) {
+    // TODO: These values seem to swap between games? Maybe different versions of the engine..?
+    u8 *buffer = malloc<u8>(data_size);
+    if (!buffer) return nullptr;
+
+    u8 s1 = 0x55;
+    u8 s2 = 0xAA;
+    s1 = (seed_1 + ((entry_key >> 16) ^ (entry_key + s1)));
+    s2 = (seed_2 + ((entry_key >> 24) ^ ((entry_key >> 8) + s2)));
+
+    if (data_size >= DPM::ParallelThreshold) {
+        DPM::ScanParallel(data, buffer, data_size, s1, s2, ThreadsPerStream());
+    } else {
+        DPM::Scan(data, buffer, data_size, s1, s2, 0);
+    }
+    return buffer;
 }
@@ -43,22 +43,7 @@ class DPMArchive : public ArchiveBase {
             this->arc_key = arc_key;
             this->dpm_size = dpm_size;
         };
-        u8* DecryptEntry(u8 *data, u32 data_size, u32 entry_key) {
-            // TODO: These values seem to swap between games? Maybe different versions of the engine..?
-            u8 *buffer = malloc<u8>(data_size);
-            memcpy(buffer, data, data_size);
-
-            u8 s1 = 0x55;
-            u8 s2 = 0xAA;
-            s1 = (seed_1 + ((entry_key >> 16) ^ (entry_key + s1)));
-            s2 = (seed_2 + ((entry_key >> 24) ^ ((entry_key >> 8) + s2)));
-            u8 val = 0;
-            for (u32 i = 0; i < data_size; i++) {
-                val += (s1 ^ (buffer[i] - s2));
-                buffer[i] = val;
-            }
-            return buffer;
-        };
+        u8* DecryptEntry(u8 *data, u32 data_size, u32 entry_key);
         EntryMapPtr GetEntries() override {
             EntryMapPtr entriesMap;
             for (auto &entry : entries) {
@@ -67,4 +52,8 @@ class DPMArchive : public ArchiveBase {
             return entriesMap;
         }
         u8* OpenStream(const Entry *entry, u8 *buffer) override;
+        // Decryption only reads the seeds, each entry gets its own output buffer.
+        bool ConcurrentStreams() const override {
+            return true;
+        }
 };
@@ -1,13 +1,275 @@
 #include "pac.h"
+#include <Decompress.h>
+#include <util/Inflate.h>
+#include <zstd.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Index records are a fixed width name followed by offset, unpacked size and stored size.
+static constexpr usize PacRecordTail = 12;
+// Newer archives Huffman-compress the index and always use 0x40 byte names.
+static constexpr usize PacNewNameLength = 0x40;
+
+namespace {
+    // The Huffman tree is serialised in front of the data: a 1 bit is an internal node followed by its left and
+    // right subtrees, a 0 bit is a leaf followed by its 8 bit symbol. Internal nodes are numbered from 256.
+    class PacHuffmanTree {
+        static constexpr u32 NodeLimit = 512;
+
+    public:
+        u16 lhs[NodeLimit] = {};
+        u16 rhs[NodeLimit] = {};
+        u16 root = 0;
+        bool valid = true;
+
+        explicit PacHuffmanTree(MSBBitBuffer &reader) {
+            u16 token = 256;
+            root = ReadNode(reader, token, 0);
+        }
+
+    private:
+        u16 ReadNode(MSBBitBuffer &reader, u16 &token, u32 depth) {
+            reader.Refill();
+            if (reader.Overrun() || depth >= 256) {
+                valid = false;
+                return 0;
+            }
+            if (!reader.Read(1)) return (u16)reader.Read(8);
+
+            if (token >= NodeLimit) {
+                valid = false;
+                return 0;
+            }
+            u16 node = token++;
+            lhs[node] = ReadNode(reader, token, depth + 1);
+            rhs[node] = ReadNode(reader, token, depth + 1);
+            return node;
+        }
+    };
+
+    // Every TableBits wide prefix of the stream maps to the symbols it fully decodes (up to MaxSymbols) and the bits
+    // those take. Prefixes that end inside a longer code store the node they reached and finish bit by bit.
+    class PacHuffmanTable {
+    public:
+        static constexpr u32 TableBits = 11;
+        static constexpr u32 MaxSymbols = 4;
+
+        struct Slot {
+            u8 count;
+            u8 bits;
+            u16 node;
+            u8 symbols[MaxSymbols];
+        };
+
+        Slot slots[1 << TableBits];
+
+        explicit PacHuffmanTable(const PacHuffmanTree &tree) {
+            for (u32 prefix = 0; prefix < (1u << TableBits); ++prefix) {
+                Slot &slot = slots[prefix];
+                slot = {};
+
+                u16 node = tree.root;
+                for (u32 bit = 0; bit < TableBits; ++bit) {
+                    node = (prefix >> (TableBits - 1 - bit)) & 1 ? tree.rhs[node] : tree.lhs[node];
+                    if (node < 0x100) {
+                        slot.symbols[slot.count++] = (u8)node;
+                        slot.bits = bit + 1;
+                        node = tree.root;
+                        if (slot.count == MaxSymbols) break;
+                    }
+                }
+                if (slot.count == 0) {
+                    slot.bits = TableBits;
+                    slot.node = node;
+                }
+            }
+        }
+    };
+}
+
+usize Pac::UnHuffman(const u8 *packed, usize packed_size, u8 *out, usize out_size) {
+    MSBBitBuffer reader(packed, packed_size);
+
+    PacHuffmanTree tree(reader);
+    if (!tree.valid) return 0;
+
+    // A tree that is a single leaf spends no bits per symbol.
+    if (tree.root < 0x100) {
+        memset(out, tree.root, out_size);
+        return out_size;
+    }
+
+    auto table = std::make_unique<PacHuffmanTable>(tree);
+    usize written = 0;
+
+    while (written < out_size && !reader.Overrun()) {
+        reader.Refill();
+
+        // A refill guarantees 56 bits, enough for four table lookups.
+        for (int lookup = 0; lookup < 4 && written < out_size; ++lookup) {
+            const PacHuffmanTable::Slot &slot = table->slots[reader.Peek(PacHuffmanTable::TableBits)];
+            reader.Skip(slot.bits);
+
+            if (slot.count != 0) {
+                usize count = std::min<usize>(slot.count, out_size - written);
+                memcpy(out + written, slot.symbols, count);
+                written += count;
+                continue;
+            }
+
+            u16 node = slot.node;
+            while (node >= 0x100) {
+                reader.Refill();
+                if (reader.Overrun()) return written;
+                node = reader.Read(1) ? tree.rhs[node] : tree.lhs[node];
+            }
+            out[written++] = (u8)node;
+            break;
+        }
+    }
+
+    return written;
+}
+
+usize Pac::UnLZSS(const u8 *packed, usize packed_size, u8 *out, usize out_size) {
+    return LzssDecode(packed, packed_size, out, out_size);
+}
+
+usize Pac::UnZstd(const u8 *packed, usize packed_size, u8 *out, usize out_size) {
+    // Like InflateContext, one decompression context per thread instead of one per entry.
+    struct Context {
+        ZSTD_DCtx *ctx = ZSTD_createDCtx();
+        ~Context() {
+            ZSTD_freeDCtx(ctx);
+        }
+    };
+    thread_local Context context;
+    if (!context.ctx) return 0;
+
+    usize result = ZSTD_decompressDCtx(context.ctx, out, out_size, packed, packed_size);
+    if (ZSTD_isError(result)) return 0;
+    return result;
+}
+
+bool PacFormat::ReadIndex(const u8 *index, usize index_size, u32 count, usize name_length, u64 size, Compression pack_type, EntryMap &entries) {
+    usize record_size = name_length + PacRecordTail;
+    if ((u64)count * record_size > index_size) return false;
+
+    entries.clear();
+    entries.reserve(count);
+    for (u32 i = 0; i < count; ++i) {
+        const u8 *record = index + i * record_size;
+
+        const char *name = (const char*)record;
+        usize length = std::find(name, name + name_length, '\0') - name;
+        if (length == 0 || std::all_of(name, name + length, [](char c) { return c == ' '; })) return false;
+
+        Entry entry = {};
+        entry.name = std::string(name, length);
+        entry.offset = Read<u32>((u8*)record, name_length);
+        entry.size = Read<u32>((u8*)record, name_length + 4);
+        entry.packedSize = Read<u32>((u8*)record, name_length + 8);
+        if (entry.offset + entry.packedSize > size) return false;
+
+        bool maybe_stored = pack_type == DeflateOrNone || pack_type == ZstdOrNone;
+        entry.isPacked = pack_type != None && pack_type != None2 && (!maybe_stored || entry.size != entry.packedSize);
+        entry.index = i;
+
+        std::string key = entry.name;
+        entries.insert({key, std::move(entry)});
+    }
+    return true;
+}
 
 ArchiveBase *PacFormat::TryOpen(u8 *buffer, u64 size, std::string file_name) {
-    if (!CanHandleFile(buffer, size, file_name)) {
+    if (!CanHandleFile(buffer, size, "")) {
+        return nullptr;
+    }
+
+    u32 count = Read<u32>(buffer, 0x4);
+    u32 pack_type = Read<u32>(buffer, 0x8);
+    if (!IsSaneFileCount(count)) {
+        Logger::error("PAC: Invalid file count {}", count);
+        return nullptr;
+    }
+    if (pack_type > ZstdOrNone) {
+        Logger::error("PAC: Unknown compression type {}", pack_type);
+        return nullptr;
+    }
+
+    EntryMap entries;
+
+    // Older archives keep a plain index right after the header, with either 0x20 or 0x40 byte names.
+    for (usize name_length : {0x20, 0x40}) {
+        if (ReadIndex(buffer + 0xC, size - 0xC, count, name_length, size, (Compression)pack_type, entries)) {
+            return new PacArchive(entries, (Compression)pack_type);
+        }
+    }
+
+    // Newer ones append a bit-inverted, Huffman-compressed index followed by its size.
+    u32 index_size = Read<u32>(buffer, size - 4);
+    usize unpacked_size = (usize)count * (PacNewNameLength + PacRecordTail);
+    if (index_size == 0 || index_size > size - 0x10 || index_size > unpacked_size * 2) {
+        Logger::error("PAC: Couldn't find a valid index!");
+        return nullptr;
+    }
+
+    std::vector<u8> packed(buffer + size - 4 - index_size, buffer + size - 4);
+    for (u8 &b : packed) b = ~b;
+
+    std::vector<u8> index(unpacked_size);
+    if (Pac::UnHuffman(packed.data(), packed.size(), index.data(), index.size()) != unpacked_size ||
+        !ReadIndex(index.data(), index.size(), count, PacNewNameLength, size, (Compression)pack_type, entries)) {
+        Logger::error("PAC: Failed to read the compressed index!");
         return nullptr;
     }
 
-    return new PacArchive({});
+    return new PacArchive(entries, (Compression)pack_type);
 }
 
 bool PacFormat::CanHandleFile(u8 *buffer, u64 size, const std::string &ext) const {
-    return ext == "pac";
+    if (size < 0x10) return false;
+    // "PACK" is an unrelated format.
+    return (ReadMagic<u32>(buffer) & 0x00FFFFFF) == (sig & 0x00FFFFFF) && buffer[3] != 'K';
+}
+
+u8* PacArchive::OpenStream(const Entry *entry, u8 *buffer) {
+    u8 *output = malloc<u8>(entry->size);
+    if (!output) return nullptr;
+
+    const u8 *packed = buffer + entry->offset;
+    if (!entry->isPacked) {
+        usize stored = std::min(entry->size, entry->packedSize);
+        memcpy(output, packed, stored);
+        memset(output + stored, 0, entry->size - stored);
+        return output;
+    }
+
+    usize written = 0;
+    switch (pack_type) {
+        case Lzss:
+            written = Pac::UnLZSS(packed, entry->packedSize, output, entry->size);
+            break;
+        case Huffman:
+            written = Pac::UnHuffman(packed, entry->packedSize, output, entry->size);
+            break;
+        case Deflate:
+        case DeflateOrNone:
+            written = InflateContext::ForThread().Inflate(packed, entry->packedSize, output, entry->size);
+            break;
+        case Zstd:
+        case ZstdOrNone:
+            written = Pac::UnZstd(packed, entry->packedSize, output, entry->size);
+            break;
+        default:
+            break;
+    }
+
+    if (written != entry->size) {
+        Logger::error("PAC: Failed to decompress {} ({} of {} bytes)", entry->name, written, entry->size);
+        free(output);
+        return nullptr;
+    }
+    return output;
 }
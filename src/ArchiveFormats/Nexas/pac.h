@@ -16,23 +16,38 @@ enum Compression {
     ZstdOrNone,
 };
 
+namespace Pac {
+    // Each returns the number of bytes written to `out`, short of `out_size` if the input was truncated or corrupt.
+    usize UnHuffman(const u8 *packed, usize packed_size, u8 *out, usize out_size);
+    usize UnLZSS(const u8 *packed, usize packed_size, u8 *out, usize out_size);
+    usize UnZstd(const u8 *packed, usize packed_size, u8 *out, usize out_size);
+}
+
 class PacFormat : public ArchiveFormat {
+    bool ReadIndex(const u8 *index, usize index_size, u32 count, usize name_length, u64 size, Compression pack_type, EntryMap &entries);
+
 public:
     PacFormat() {
         this->tag = "PAC";
         this->description = "NeXas PAC Archive.";
     };
 
+    u32 sig = PackUInt32('P', 'A', 'C', 0);
+
     ArchiveBase* TryOpen(u8 *buffer, u64 size, std::string file_name) override;
     bool CanHandleFile(u8 *buffer, u64 size, const std::string &ext) const override;
 };
 
 class PacArchive : public ArchiveBase {
+    Compression pack_type;
+
 public:
-    PacArchive(const EntryMap &entries) : ArchiveBase(entries) {};
+    PacArchive(const EntryMap &entries, Compression pack_type) : ArchiveBase(entries), pack_type(pack_type) {};
     ~PacArchive() = default;
 
-    u8* OpenStream(const Entry *entry, u8 *buffer) override {
-        return nullptr;
-    };
+    u8* OpenStream(const Entry *entry, u8 *buffer) override;
+    // All decoders keep their state on the stack or per thread.
+    bool ConcurrentStreams() const override {
+        return true;
+    }
 };
@@ -1,5 +1,6 @@
 #include "mpk.h"
 #include <util/memory.h>
+#include <util/Inflate.h>
 #include <unordered_map>
 
 static int constexpr MPKMaxPath = 224;
@@ -34,20 +35,36 @@ ArchiveBase *MPKFormat::TryOpen(u8 *buffer, u64 size, std::string file_name)
 
         if (compression != 0 && compression != 1) {
             Logger::warn("Unknown compression type! {}", compression);
-            Seek(0x100 - 8);
+            Advance(0x100 - 8);
             continue;
         }
 
+        // Stored size comes first, then the size once inflated. They're equal for uncompressed entries.
+        u64 offset = Read<u64>(buffer);
+        u64 stored_size = Read<u64>(buffer);
+        u64 unpacked_size = Read<u64>(buffer);
+
         Entry entry {
             .name = "",
-            .offset = Read<u64>(buffer),
-            .size = Read<u64>(buffer),
-            .packedSize = Read<u64>(buffer),
+            .offset = offset,
+            .size = unpacked_size,
+            .packedSize = stored_size,
             .isPacked = compression == 1,
         };
 
         Read(name, buffer, MPKMaxPath);
         name[MPKMaxPath - 1] = '\0';
+
+        if (offset > size || stored_size > size - offset) {
+            Logger::error("MPK: {} extends past the end of the archive!", name);
+            return nullptr;
+        }
+        // OpenStream copies uncompressed entries by their unpacked size.
+        if (compression == 0 && unpacked_size != stored_size) {
+            Logger::error("MPK: {} is stored uncompressed but its sizes differ ({} vs {})", name, stored_size, unpacked_size);
+            return nullptr;
+        }
+
         entry.name = name;
         entries[name] = entry;
     }
@@ -69,6 +86,18 @@ u8* MPKArchive::OpenStream(const Entry *entry, u8 *buffer)
     unsigned char *entry_offset = buffer + entry->offset;
 
     u8* data = malloc<u8>(entry->size);
-    memcpy(data, entry_offset, entry->size);
+    if (!data) return nullptr;
+
+    if (!entry->isPacked) {
+        memcpy(data, entry_offset, entry->size);
+        return data;
+    }
+
+    usize written = InflateContext::ForThread().Inflate(entry_offset, entry->packedSize, data, entry->size);
+    if (written != entry->size) {
+        Logger::error("MPK: Failed to inflate {} ({} of {} bytes)", entry->name, written, entry->size);
+        free(data);
+        return nullptr;
+    }
     return data;
 }
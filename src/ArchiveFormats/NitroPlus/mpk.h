@@ -20,4 +20,8 @@ class MPKArchive : public ArchiveBase {
         MPKArchive(const EntryMap &entries) : ArchiveBase(entries) {};
 
         u8* OpenStream(const Entry *entry, u8 *buffer) override;
+        // Each thread inflates with its own pooled context.
+        bool ConcurrentStreams() const override {
+            return true;
+        }
 };
@@ -1,9 +1,204 @@
 #include "npk.h"
+#include <util/Inflate.h>
+#include <util/memory.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// NPK2 keys are per game.
+struct NPKKey {
+    const char *title;
+    u8 key[AES256Decryptor::KeySize];
+};
+
+static const NPKKey NPKKnownKeys[] = {
+    { "Tokyo Necro", {
+        0x96, 0x2C, 0x5F, 0x3A, 0x78, 0x9C, 0x84, 0x37, 0xB7, 0x12, 0x12, 0xA1, 0x15, 0xD6, 0xCA, 0x9F,
+        0x9A, 0xE3, 0xFD, 0x21, 0x0F, 0xF6, 0xAF, 0x70, 0xA8, 0xA8, 0xF8, 0xBB, 0xFE, 0x5E, 0x8A, 0xF5,
+    } },
+};
+
+// Entries at least this large are split over worker threads inside OpenStream.
+static constexpr u64 NPKParallelThreshold = 4 << 20;
+// Stored segments are decrypted in chunks of this size so a single huge segment still spreads over threads.
+static constexpr u64 NPKChunkSize = 4 << 20;
+
+static bool ReadIndex(const std::vector<u8> &index, u32 count, u64 archive_size, EntryMap &entries) {
+    usize pos = 0;
+    auto has = [&](usize n) { return pos + n <= index.size(); };
+    auto read_u16 = [&]() { u16 v; memcpy(&v, index.data() + pos, 2); pos += 2; return v; };
+    auto read_u32 = [&]() { u32 v; memcpy(&v, index.data() + pos, 4); pos += 4; return v; };
+    auto read_u64 = [&]() { u64 v; memcpy(&v, index.data() + pos, 8); pos += 8; return v; };
+
+    entries.reserve(count);
+    for (u32 i = 0; i < count; ++i) {
+        if (!has(3)) return false;
+        pos++; // flags
+        u16 name_length = read_u16();
+        if (name_length == 0 || !has(name_length + 4 + 0x20 + 4)) return false;
+
+        Entry entry = {};
+        entry.name = std::string((const char*)index.data() + pos, name_length);
+        pos += name_length;
+        u32 unpacked_size = read_u32();
+        pos += 0x20; // SHA-256 of the entry
+        u32 segment_count = read_u32();
+        // Empty files have no segments at all.
+        if (!has((usize)segment_count * 20)) return false;
+
+        u64 total = 0;
+        entry.segments.reserve(segment_count);
+        for (u32 j = 0; j < segment_count; ++j) {
+            u64 offset = read_u64();
+            u32 aligned_size = read_u32();
+            u32 stored_size = read_u32();
+            u32 segment_size = read_u32();
+
+            if (aligned_size % AES256Decryptor::BlockSize != 0 || stored_size > aligned_size || offset + aligned_size > archive_size) {
+                return false;
+            }
+            // Stored segments are the plain bytes, anything smaller than its unpacked size is raw deflate.
+            bool compressed = stored_size < segment_size;
+            if (!compressed && segment_size != stored_size) return false;
+
+            entry.segments.push_back({
+                .IsCompressed = compressed,
+                .Offset = offset,
+                .Size = (i64)segment_size,
+                .PackedSize = aligned_size,
+            });
+            entry.packedSize += aligned_size;
+            entry.isPacked = entry.isPacked || compressed;
+            total += segment_size;
+        }
+        if (total != unpacked_size) return false;
+
+        entry.offset = entry.segments.empty() ? 0 : entry.segments[0].Offset;
+        entry.size = unpacked_size;
+        entry.index = i;
+        std::string name = entry.name;
+        entries.insert({name, std::move(entry)});
+    }
+    return true;
+}
 
 ArchiveBase *NPKFormat::TryOpen(u8 *buffer, u64 size, std::string file_name) {
+    if (!CanHandleFile(buffer, size, "")) return nullptr;
+
     u32 count = Read<u32>(buffer, 0x18);
     if (!IsSaneFileCount(count)) return nullptr;
-    Logger::log("{}", count);
 
+    u32 index_size = Read<u32>(buffer, 0x1C);
+    if (index_size % AES256Decryptor::BlockSize != 0 || 0x20 + (u64)index_size > size) {
+        Logger::error("NPK2: Invalid index size {}", index_size);
+        return nullptr;
+    }
+    const u8 *iv = buffer + 0x8;
+
+    // The key can only be told apart by whether the index decrypts to something sensible.
+    std::vector<u8> index(index_size);
+    for (const NPKKey &known : NPKKnownKeys) {
+        AES256Decryptor aes(known.key);
+        aes.DecryptCBC(buffer + 0x20, index.data(), index_size, iv);
+
+        EntryMap entries;
+        if (ReadIndex(index, count, size, entries)) {
+            Logger::log("NPK2: Using key for {}", known.title);
+            return new NPKArchive(entries, known.key, iv);
+        }
+    }
+
+    Logger::error("NPK2: None of the known keys decrypt this archive!");
     return nullptr;
 };
+
+NPKArchive::NPKArchive(const EntryMap &entries, const u8 *key, const u8 *iv) : ArchiveBase(entries), aes(key) {
+    memcpy(this->iv, iv, sizeof(this->iv));
+}
+
+// Decrypts bytes [begin, end) of a segment into `output`, which points at the segment's place in the entry. Stored
+// segments can be done in pieces, the IV for a piece is just the ciphertext block before it. Compressed segments are
+// always done whole, decrypted into a per-thread scratch buffer and inflated from there.
+bool NPKArchive::DecryptSegment(const Segment &segment, u8 *buffer, u8 *output, u64 begin, u64 end) const {
+    const u8 *src = buffer + segment.Offset;
+    const u8 *chunk_iv = begin == 0 ? iv : src + begin - AES256Decryptor::BlockSize;
+
+    if (segment.IsCompressed) {
+        thread_local std::vector<u8> scratch;
+        if (scratch.size() < segment.PackedSize) scratch.resize(segment.PackedSize);
+
+        aes.DecryptCBC(src, scratch.data(), segment.PackedSize, iv);
+        usize written = InflateContext::ForThread().Inflate(scratch.data(), segment.PackedSize, output, segment.Size, -MAX_WBITS);
+        return written == (usize)segment.Size;
+    }
+
+    // Whole blocks go straight to the output, the padded last block is decrypted on the side.
+    u64 whole_end = std::min<u64>(end, segment.Size - segment.Size % AES256Decryptor::BlockSize);
+    if (whole_end > begin) {
+        aes.DecryptCBC(src + begin, output + begin, whole_end - begin, chunk_iv);
+    }
+    if (end > whole_end) {
+        u8 block[AES256Decryptor::BlockSize];
+        const u8 *tail_iv = whole_end == 0 ? iv : src + whole_end - AES256Decryptor::BlockSize;
+        aes.DecryptCBC(src + whole_end, block, AES256Decryptor::BlockSize, tail_iv);
+        memcpy(output + whole_end, block, end - whole_end);
+    }
+    return true;
+}
+
+u8* NPKArchive::OpenStream(const Entry *entry, u8 *buffer) {
+    // Not null for empty entries, where malloc(0) may be.
+    u8 *output = malloc<u8>(std::max<usize>(entry->size, 1));
+    if (!output) return nullptr;
+
+    struct Task {
+        const Segment *segment;
+        u8 *output;
+        u64 begin;
+        u64 end;
+    };
+
+    std::vector<Task> tasks;
+    u64 position = 0;
+    for (const Segment &segment : entry->segments) {
+        u64 size = segment.Size;
+        u64 step = segment.IsCompressed ? size : NPKChunkSize;
+        for (u64 begin = 0; begin < size || begin == 0; begin += step) {
+            tasks.push_back({ &segment, output + position, begin, std::min(size, begin + step) });
+            if (step == 0) break;
+        }
+        position += size;
+    }
+
+    std::atomic<usize> next = 0;
+    std::atomic<bool> failed = false;
+    auto worker = [&]() {
+        for (usize i = next++; i < tasks.size(); i = next++) {
+            const Task &task = tasks[i];
+            if (!DecryptSegment(*task.segment, buffer, task.output, task.begin, task.end)) {
+                failed = true;
+            }
+        }
+    };
+
+    usize thread_count = 1;
+    if (entry->size >= NPKParallelThreshold) {
+        thread_count = std::min<usize>(ArchiveBase::ThreadsPerStream(), tasks.size());
+    }
+
+    std::vector<std::thread> workers;
+    for (usize i = 1; i < thread_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    if (failed) {
+        Logger::error("NPK2: Failed to inflate {}", entry->name);
+        free(output);
+        return nullptr;
+    }
+    return output;
+}
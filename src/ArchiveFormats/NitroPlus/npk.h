@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ArchiveFormat.h>
+#include <aes.h>
 
 class NPKFormat : public ArchiveFormat {
 public:
@@ -12,9 +13,26 @@ public:
     u32 sig = 0x324B504E; // NPK2;
 
     bool CanHandleFile(u8 *buffer, u64 size, const std::string &ext) const override {
+        if (size < 0x20) return false;
         if (ReadMagic<u32>(buffer) == sig) return true;
 
         return false;
     };
     ArchiveBase* TryOpen(u8 *buffer, u64 size, std::string file_name) override;
 };
+
+class NPKArchive : public ArchiveBase {
+    AES256Decryptor aes;
+    u8 iv[AES256Decryptor::BlockSize];
+
+    bool DecryptSegment(const Segment &segment, u8 *buffer, u8 *output, u64 begin, u64 end) const;
+
+    public:
+        NPKArchive(const EntryMap &entries, const u8 *key, const u8 *iv);
+
+        u8* OpenStream(const Entry *entry, u8 *buffer) override;
+        // Every segment is encrypted from the archive IV, nothing is shared between calls.
+        bool ConcurrentStreams() const override {
+            return true;
+        }
+};
@@ -66,8 +66,10 @@ ArchiveBase *PFSFormat::OpenPF(u8 *buffer, u64 size, u8 version) {
         entries.insert({name, entry});
     }
 
-    if (version != 8 && version != 9 && version != 4 && version != 5)
+    if (version != 8 && version != 9 && version != 4 && version != 5) {
+        free(index_buf);
         return new PFSArchive(entries);
+    }
 
     SHA1_CTX sha_ctx;
     u8 key_arr[20];
@@ -77,9 +79,7 @@ ArchiveBase *PFSFormat::OpenPF(u8 *buffer, u64 size, u8 version) {
 
     free(index_buf);
 
-    std::vector<u8> key(key_arr, key_arr + 20);
-
-    return new PFSArchive(this, entries, key);
+    return new PFSArchive(this, entries, key_arr, sizeof(key_arr));
 }
 
 bool PFSFormat::CanHandleFile(u8 *buffer, u64 size, const std::string &ext) const {
@@ -93,15 +93,20 @@ bool PFSFormat::CanHandleFile(u8 *buffer, u64 size, const std::string &ext) cons
 
 
 u8* PFSArchive::OpenStream(const Entry *entry, u8 *buffer) {
-    u8* output = (u8*)malloc(entry->size);
-    memcpy(output, buffer + entry->offset, entry->size);
+    u8* output = malloc<u8>(entry->size);
+    if (!output) return nullptr;
 
-    if (key.empty()) return output;
-
-    for (u32 i = 0; i < entry->size; ++i)
-    {
-        output[i] ^= key[i % key.size()];
-    }
+    // Decrypt while copying out of the archive buffer, no need for a second pass over the entry.
+    key.Apply(output, buffer + entry->offset, entry->size);
 
     return output;
 }
+
+usize PFSArchive::ReadRange(const Entry *entry, u8 *buffer, u64 offset, u8 *dest, usize length) {
+    if (offset >= entry->size) return 0;
+
+    usize count = std::min<u64>(length, entry->size - offset);
+    key.Apply(dest, buffer + entry->offset + offset, count, offset);
+
+    return count;
+}
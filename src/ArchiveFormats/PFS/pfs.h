@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ArchiveFormat.h>
+#include <util/KeyStream.h>
 
 class PFSFormat : public ArchiveFormat {
 public:
@@ -19,12 +20,17 @@ public:
 
 class PFSArchive : public ArchiveBase {
     PFSFormat *pfs_fmt;
-    std::vector<u8> key;
+    XorKeyStream key;
     public:
         PFSArchive(const EntryMap &entries) : ArchiveBase(entries) {};
-        PFSArchive(PFSFormat *arc_fmt, const EntryMap &entries, std::vector<u8> key) : ArchiveBase(entries) {
+        PFSArchive(PFSFormat *arc_fmt, const EntryMap &entries, const u8 *key, usize key_size) : ArchiveBase(entries) {
             this->pfs_fmt = arc_fmt;
-            this->key = key;
+            this->key.SetKey(key, key_size);
         }
         u8* OpenStream(const Entry *entry, u8 *buffer) override;
+        usize ReadRange(const Entry *entry, u8 *buffer, u64 offset, u8 *dest, usize length) override;
+        // The key stream is only read, entries decrypt independently by their offset.
+        bool ConcurrentStreams() const override {
+            return true;
+        }
 };
@@ -1,37 +1,57 @@
 #include "pak.h"
-#include <unordered_map>
+#include <algorithm>
 
 ArchiveBase *SAPakFormat::TryOpen(u8 *buffer, u64 size, std::string file_name) {
     u32 file_count = Read<u32>(buffer, 0x39);
-    EntryMap entries;
-    std::vector<std::string> names;
+    if (!IsSaneFileCount(file_count)) {
+        Logger::error("SonicAdv PAK: Invalid file count {}", file_count);
+        return nullptr;
+    }
+
+    std::vector<Entry> list;
+    list.reserve(file_count);
 
     Seek(0x3D);
 
     for (u32 i = 0; i < file_count; i++) {
-        Entry entry;
+        Entry entry = {};
         u32 name_len = Read<u32>(buffer);
         ReadStringAndAdvance(buffer, GetBufferHead(), name_len);
         name_len = Read<u32>(buffer);
         entry.name = ReadStringAndAdvance(buffer, GetBufferHead(), name_len);
         entry.size = Read<u32>(buffer);
-        entries.insert({entry.name, entry});
-        names.push_back(entry.name);
+        list.push_back(std::move(entry));
         Advance(0x4);
     }
 
-    for (u32 i = 0; i < file_count; i++) {
-        std::vector<u8> entry_data;
-        entry_data.resize(entries.find(names[i])->second.size);
-        Read(entry_data.data(), buffer, entries[names[i]].size);
-        entries[names[i]].data = entry_data;
+    // Entry data follows the index back to back, in index order.
+    u64 offset = GetBufferHead();
+    EntryMap entries;
+    entries.reserve(file_count);
+    for (auto &entry : list) {
+        if (offset + entry.size > size) {
+            Logger::error("SonicAdv PAK: {} extends past the end of the archive!", entry.name);
+            return nullptr;
+        }
+        entry.offset = offset;
+        offset += entry.size;
+        std::string name = entry.name;
+        entries.insert({name, std::move(entry)});
     }
 
     return new SAPakArchive(entries);
 };
 
 u8* SAPakArchive::OpenStream(const Entry *entry, u8 *buffer) {
-    u8 *copy = (u8*)malloc(entry->data.size());
-    memcpy(copy, entry->data.data(), entry->data.size());
+    u8 *copy = (u8*)malloc(entry->size);
+    if (!copy) return nullptr;
+    memcpy(copy, buffer + entry->offset, entry->size);
     return copy;
 }
+
+usize SAPakArchive::ReadRange(const Entry *entry, u8 *buffer, u64 offset, u8 *dest, usize length) {
+    if (offset >= entry->size) return 0;
+    length = std::min<u64>(length, entry->size - offset);
+    memcpy(dest, buffer + entry->offset + offset, length);
+    return length;
+}
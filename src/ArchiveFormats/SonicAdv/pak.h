@@ -22,6 +22,11 @@ class SAPakArchive : public ArchiveBase {
         SAPakArchive(const EntryMap &entries) : ArchiveBase(entries) {}
 
         u8* OpenStream(const Entry *entry, u8 *buffer) override;
+        usize ReadRange(const Entry *entry, u8 *buffer, u64 offset, u8 *dest, usize length) override;
+        // Entries are plain copies out of the shared archive buffer.
+        bool ConcurrentStreams() const override {
+            return true;
+        }
         ~SAPakArchive() {
             this->entries.clear();
         }
@@ -1,32 +1,191 @@
 #include "pbg.h"
-#include <stdlib.h>
+#include <Decompress.h>
+#include <util/memory.h>
+#include <algorithm>
 
+static constexpr u32 LZSSDictSize = 0x2000;
+static constexpr u32 LZSSDictMask = LZSSDictSize - 1;
+static constexpr u32 LZSSOffsetBits = 13;
+static constexpr u32 LZSSLengthBits = 4;
+static constexpr u32 LZSSMinMatch = 3;
 
-ArchiveBase *PBGFormat::TryOpenTH06(u8 *buffer, u64 size, std::string file_name) {
-    ThArchive archive = {};
-    std::unordered_map<std::string, ThEntry> entries;
+// Longest match the format can encode, plus room for the wide stores of LzCopyMatch to spill over.
+static constexpr usize LZSSMaxMatch = (1 << LZSSLengthBits) - 1 + LZSSMinMatch;
+static constexpr usize LZSSCopySlack = LZSSMaxMatch + LzCopyOverrun;
 
-    // Create a temporary file based on buffer
-    FILE *temp_file = fopen("pbg_temp_file.dat", "wb");
-    if (!temp_file) {
-        Logger::log("Failed to create temporary file");
+usize PBG::UnLZSS(const u8 *packed, usize packed_size, u8 *out, usize out_size) {
+    // The dictionary is a 0x2000 byte ring that starts zeroed with its head at 1, so dictionary slot `n` always holds
+    // the most recent output byte at position n - 1 (mod 0x2000). Matches are resolved against the output directly.
+    usize written = 0;
+
+    MSBBitBuffer reader(packed, packed_size);
+    while (written < out_size && !reader.Overrun()) {
+        reader.Refill();
+        if (reader.Read(1)) {
+            out[written++] = (u8)reader.Read(8);
+            continue;
+        }
+
+        u32 match_offset = reader.Read(LZSSOffsetBits);
+        usize match_length = reader.Read(LZSSLengthBits) + LZSSMinMatch;
+        if (match_offset == 0) break;
+
+        usize head = (written + 1) & LZSSDictMask;
+        usize distance = (head - match_offset) & LZSSDictMask;
+        if (distance == 0) distance = LZSSDictSize;
+
+        if (distance <= written && written + LZSSCopySlack <= out_size) {
+            LzCopyMatch(out + written, distance, match_length);
+            written += match_length;
+            continue;
+        }
+
+        // Near the end of the output, or reaching back before the first byte where the ring is still zeroed.
+        for (usize i = 0; i < match_length && written < out_size; ++i) {
+            out[written] = written >= distance ? out[written - distance] : 0;
+            written++;
+        }
+    }
+
+    return written;
+}
+
+// Entries are stored back to back, so the packed size of each one is the distance to the next (or to the index).
+static bool ResolvePackedSizes(std::vector<Entry> &list, u64 data_end) {
+    std::sort(list.begin(), list.end(), [](const Entry &a, const Entry &b) {
+        return a.offset < b.offset;
+    });
+
+    for (usize i = 0; i < list.size(); ++i) {
+        u64 next = i + 1 < list.size() ? list[i + 1].offset : data_end;
+        if (list[i].offset > next) return false;
+        list[i].packedSize = next - list[i].offset;
+        list[i].isPacked = true;
+        list[i].index = i;
+    }
+    return true;
+}
+
+static EntryMap ToEntryMap(std::vector<Entry> &list) {
+    EntryMap entries;
+    entries.reserve(list.size());
+    for (auto &entry : list) {
+        std::string name = entry.name;
+        entries.insert({name, std::move(entry)});
+    }
+    return entries;
+}
+
+ArchiveBase *PBGFormat::TryOpenPBG3(u8 *buffer, u64 size) {
+    PBGBitReader header(buffer + 4, size - 4);
+    u32 file_count = header.ReadUInt();
+    u32 index_offset = header.ReadUInt();
+
+    if (!IsSaneFileCount(file_count)) {
+        Logger::error("PBG3: Invalid file count {}", file_count);
         return nullptr;
     }
-    fwrite(buffer, 1, size, temp_file);
-    fclose(temp_file);
+    if (index_offset >= size) {
+        Logger::error("PBG3: Index offset is past the end of the file!");
+        return nullptr;
+    }
+
+    PBGBitReader index(buffer + index_offset, size - index_offset);
+    std::vector<Entry> list;
+    list.reserve(file_count);
+
+    for (u32 i = 0; i < file_count; ++i) {
+        index.ReadUInt(); // unknown
+        index.ReadUInt(); // unknown
+        index.ReadUInt(); // checksum
 
-    thOpenArchive(&archive, "pbg_temp_file.dat");
+        Entry entry = {};
+        entry.offset = index.ReadUInt();
+        entry.size = index.ReadUInt();
+        entry.name = index.ReadString(255);
 
-    for (unsigned idx = 0; idx < archive.entries_count; ++idx) {
-        entries[archive.entries[idx].name] = archive.entries[idx];
+        if (index.Overrun() || entry.offset >= index_offset) {
+            Logger::error("PBG3: Index overrun when reading entry {}", i);
+            return nullptr;
+        }
+        list.push_back(std::move(entry));
     }
 
-    // Free the temporary file
-    remove("pbg_temp_file.dat");
+    if (!ResolvePackedSizes(list, index_offset)) return nullptr;
 
-    return new PBGArchive(archive, entries);
+    return new PBGArchive(ToEntryMap(list));
+}
+
+ArchiveBase *PBGFormat::TryOpenPBG4(u8 *buffer, u64 size) {
+    u32 file_count = Read<u32>(buffer, 0x4);
+    u32 index_offset = Read<u32>(buffer, 0x8);
+    u32 index_size = Read<u32>(buffer, 0xC);
+
+    if (!IsSaneFileCount(file_count)) {
+        Logger::error("PBG4: Invalid file count {}", file_count);
+        return nullptr;
+    }
+    if (index_offset >= size) {
+        Logger::error("PBG4: Index offset is past the end of the file!");
+        return nullptr;
+    }
+
+    std::vector<u8> index(index_size);
+    if (PBG::UnLZSS(buffer + index_offset, size - index_offset, index.data(), index_size) != index_size) {
+        Logger::error("PBG4: Failed to decompress index!");
+        return nullptr;
+    }
+
+    std::vector<Entry> list;
+    list.reserve(file_count);
+
+    usize pos = 0;
+    for (u32 i = 0; i < file_count; ++i) {
+        auto name_end = std::find(index.begin() + pos, index.end(), '\0');
+        usize name_length = name_end - (index.begin() + pos);
+        if (pos + name_length + 1 + 12 > index_size) {
+            Logger::error("PBG4: Index overrun when reading entry {}", i);
+            return nullptr;
+        }
+
+        Entry entry = {};
+        entry.name = ReadStringWithLength(index.data() + pos, name_length);
+        pos += name_length + 1;
+        entry.offset = Read<u32>(index.data(), pos);
+        entry.size = Read<u32>(index.data(), pos + 4);
+        pos += 12;
+
+        if (entry.offset >= index_offset) {
+            Logger::error("PBG4: Entry {} starts past the index!", entry.name);
+            return nullptr;
+        }
+        list.push_back(std::move(entry));
+    }
+
+    if (!ResolvePackedSizes(list, index_offset)) return nullptr;
+
+    return new PBGArchive(ToEntryMap(list));
 }
 
 ArchiveBase *PBGFormat::TryOpen(u8 *buffer, u64 size, std::string file_name) {
-    return TryOpenTH06(buffer, size, file_name);
+    if (size < 0x10) return nullptr;
+
+    u32 magic = ReadMagic<u32>(buffer);
+    if (magic == pbg3_sig) return TryOpenPBG3(buffer, size);
+    if (magic == pbg4_sig) return TryOpenPBG4(buffer, size);
+
+    return nullptr;
+}
+
+u8* PBGArchive::OpenStream(const Entry *entry, u8 *buffer) {
+    u8 *output = malloc<u8>(entry->size);
+    if (!output) return nullptr;
+
+    usize written = PBG::UnLZSS(buffer + entry->offset, entry->packedSize, output, entry->size);
+    if (written != entry->size) {
+        Logger::warn("PBG: {} decompressed to {} bytes, expected {}", entry->name, written, entry->size);
+        memset(output + written, 0, entry->size - written);
+    }
+
+    return output;
 }
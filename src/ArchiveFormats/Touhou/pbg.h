@@ -1,12 +1,65 @@
+#pragma once
+
 #include <ArchiveFormat.h>
-#include "../../vendored/thlib/include/thlib.h"
 
-static int findPbg3Entry(ThArchive *dat, const char *entry) {
-    for (unsigned idx = 0; idx < dat->entries_count; ++idx) {
-        if (strcmp(entry, dat->entries[idx].name) == 0)
-            return idx;
+// MSB-first bit reader over the archive buffer, PBG3 indices and all PBG LZSS data are stored this way.
+class PBGBitReader {
+    const u8 *data;
+    usize size;
+    usize position = 0;
+    u8 mask = 0x80;
+    bool overrun = false;
+
+public:
+    PBGBitReader(const u8 *data, usize size) : data(data), size(size) {}
+
+    // True once a read has gone past the end of the data.
+    bool Overrun() const {
+        return overrun;
+    }
+
+    u32 ReadBit() {
+        if (position >= size) {
+            overrun = true;
+            return 0;
+        }
+        u32 bit = (data[position] & mask) != 0;
+        mask >>= 1;
+        if (mask == 0) {
+            mask = 0x80;
+            position++;
+        }
+        return bit;
     }
-    return -1;
+
+    u32 ReadBits(u32 count) {
+        u32 value = 0;
+        while (count--) {
+            value = (value << 1) | ReadBit();
+        }
+        return value;
+    }
+
+    // Variable width integer, 2 bits of byte count followed by that many bytes.
+    u32 ReadUInt() {
+        u32 byte_count = ReadBits(2) + 1;
+        return ReadBits(byte_count * 8);
+    }
+
+    std::string ReadString(usize max_length) {
+        std::string str;
+        while (str.size() < max_length) {
+            char c = (char)ReadBits(8);
+            if (c == '\0') break;
+            str.push_back(c);
+        }
+        return str;
+    }
+};
+
+namespace PBG {
+    // Decompresses `packed_size` bytes of PBG LZSS data into `out`, returns the number of bytes written.
+    usize UnLZSS(const u8 *packed, usize packed_size, u8 *out, usize out_size);
 }
 
 class PBGFormat : public ArchiveFormat {
@@ -21,9 +74,11 @@ public:
     std::vector<std::string> extensions = {".dat", ".DAT"};
 
     ArchiveBase *TryOpen(u8 *buffer, u64 size, std::string file_name) override;
-    ArchiveBase *TryOpenTH06(u8 *buffer, u64 size, std::string file_name);
+    ArchiveBase *TryOpenPBG3(u8 *buffer, u64 size);
+    ArchiveBase *TryOpenPBG4(u8 *buffer, u64 size);
 
     bool CanHandleFile(u8 *buffer, u64 size, const std::string &ext) const override {
+        if (size < 0x10) return false;
         if (ext == "dat" || ext == "DAT")
             return Read<u32>(buffer, 0) == pbg3_sig || Read<u32>(buffer, 0) == pbg4_sig;
 
@@ -33,40 +88,11 @@ public:
 
 class PBGArchive : public ArchiveBase {
     public:
-    ThArchive dat;
-    std::unordered_map<std::string, ThEntry> entries;
-
-    PBGArchive(const ThArchive &dat, std::unordered_map<std::string, ThEntry> entries) {
-        this->dat = dat;
-        this->entries = entries;
-    }
-
-    EntryMapPtr GetEntries() override {
-        EntryMapPtr entry_map;
-
-        for (auto& [name, datEntry] : entries) {
-            int index = findPbg3Entry(&dat, name.c_str());
-            if (index == -1) continue;
+        PBGArchive(const EntryMap &entries) : ArchiveBase(entries) {}
 
-            void* raw = thGetEntry(&dat, index);
-            if (!raw) continue;
-
-            Entry* rdEntry = new Entry{
-                .name = name,
-                .size = datEntry.uncompressed_size,
-                .packedSize = datEntry.compressed_size
-            };
-            entry_map[name] = rdEntry;
+        u8* OpenStream(const Entry *entry, u8 *buffer) override;
+        // Entries decompress independently from the shared, read-only archive buffer.
+        bool ConcurrentStreams() const override {
+            return true;
         }
-
-        return entry_map;
-    }
-
-    u8* OpenStream(const Entry* entry, u8* buffer) override {
-        auto idx = findPbg3Entry(&dat, entry->name.c_str());
-
-        auto data = thGetEntry(&dat, idx);
-
-        return (u8*)data;
-    }
 };
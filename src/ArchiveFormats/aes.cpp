@@ -0,0 +1,246 @@
+#include "aes.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RD_AES_NI
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RD_AES_NI_TARGET
+#else
+#define RD_AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+namespace {
+    u8 GFMul(u8 a, u8 b) {
+        u8 result = 0;
+        while (b) {
+            if (b & 1) result ^= a;
+            a = (a << 1) ^ ((a & 0x80) ? 0x1B : 0);
+            b >>= 1;
+        }
+        return result;
+    }
+
+    u32 RotateRight(u32 value, u32 count) {
+        return (value >> count) | (value << ((32 - count) & 31));
+    }
+
+    u32 LoadBE32(const u8 *p) {
+        return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+    }
+
+    void StoreBE32(u8 *p, u32 value) {
+        p[0] = value >> 24;
+        p[1] = value >> 16;
+        p[2] = value >> 8;
+        p[3] = value;
+    }
+
+    // S-boxes and inverse round tables, built once from the field arithmetic instead of pasted in.
+    struct AESTables {
+        u8 sbox[256];
+        u8 inv_sbox[256];
+        u32 td[4][256];
+
+        AESTables() {
+            // Walk the multiplicative group with generator 3 to get inverses, then apply the affine transform.
+            u8 exp[256], log[256] = {};
+            u8 x = 1;
+            for (int i = 0; i < 255; ++i) {
+                exp[i] = x;
+                log[x] = i;
+                x = GFMul(x, 3);
+            }
+
+            for (int i = 0; i < 256; ++i) {
+                u8 inverse = i == 0 ? 0 : exp[(255 - log[i]) % 255];
+                u8 s = inverse;
+                for (int shift = 1; shift <= 4; ++shift) {
+                    s ^= (u8)((inverse << shift) | (inverse >> (8 - shift)));
+                }
+                sbox[i] = s ^ 0x63;
+            }
+            for (int i = 0; i < 256; ++i) {
+                inv_sbox[sbox[i]] = i;
+            }
+
+            for (int i = 0; i < 256; ++i) {
+                u8 s = inv_sbox[i];
+                u32 word = ((u32)GFMul(s, 0x0E) << 24) | ((u32)GFMul(s, 0x09) << 16) | ((u32)GFMul(s, 0x0D) << 8) | GFMul(s, 0x0B);
+                for (int t = 0; t < 4; ++t) {
+                    td[t][i] = RotateRight(word, 8 * t);
+                }
+            }
+        }
+    };
+
+    const AESTables &Tables() {
+        static const AESTables tables;
+        return tables;
+    }
+
+    void InvMixColumns(u8 *block) {
+        for (int c = 0; c < 4; ++c) {
+            u8 *col = block + c * 4;
+            u8 a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+            col[0] = GFMul(a0, 0x0E) ^ GFMul(a1, 0x0B) ^ GFMul(a2, 0x0D) ^ GFMul(a3, 0x09);
+            col[1] = GFMul(a0, 0x09) ^ GFMul(a1, 0x0E) ^ GFMul(a2, 0x0B) ^ GFMul(a3, 0x0D);
+            col[2] = GFMul(a0, 0x0D) ^ GFMul(a1, 0x09) ^ GFMul(a2, 0x0E) ^ GFMul(a3, 0x0B);
+            col[3] = GFMul(a0, 0x0B) ^ GFMul(a1, 0x0D) ^ GFMul(a2, 0x09) ^ GFMul(a3, 0x0E);
+        }
+    }
+
+    void DecryptBlockPortable(const u32 *rk, const u8 *in, u8 *out) {
+        const AESTables &t = Tables();
+
+        u32 s0 = LoadBE32(in) ^ rk[0];
+        u32 s1 = LoadBE32(in + 4) ^ rk[1];
+        u32 s2 = LoadBE32(in + 8) ^ rk[2];
+        u32 s3 = LoadBE32(in + 12) ^ rk[3];
+
+        for (int round = 1; round < AES256Decryptor::Rounds; ++round) {
+            rk += 4;
+            u32 t0 = t.td[0][s0 >> 24] ^ t.td[1][(s3 >> 16) & 0xFF] ^ t.td[2][(s2 >> 8) & 0xFF] ^ t.td[3][s1 & 0xFF] ^ rk[0];
+            u32 t1 = t.td[0][s1 >> 24] ^ t.td[1][(s0 >> 16) & 0xFF] ^ t.td[2][(s3 >> 8) & 0xFF] ^ t.td[3][s2 & 0xFF] ^ rk[1];
+            u32 t2 = t.td[0][s2 >> 24] ^ t.td[1][(s1 >> 16) & 0xFF] ^ t.td[2][(s0 >> 8) & 0xFF] ^ t.td[3][s3 & 0xFF] ^ rk[2];
+            u32 t3 = t.td[0][s3 >> 24] ^ t.td[1][(s2 >> 16) & 0xFF] ^ t.td[2][(s1 >> 8) & 0xFF] ^ t.td[3][s0 & 0xFF] ^ rk[3];
+            s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+        }
+
+        rk += 4;
+        const u8 *is = t.inv_sbox;
+        StoreBE32(out,      ((u32)is[s0 >> 24] << 24) ^ ((u32)is[(s3 >> 16) & 0xFF] << 16) ^ ((u32)is[(s2 >> 8) & 0xFF] << 8) ^ is[s1 & 0xFF] ^ rk[0]);
+        StoreBE32(out + 4,  ((u32)is[s1 >> 24] << 24) ^ ((u32)is[(s0 >> 16) & 0xFF] << 16) ^ ((u32)is[(s3 >> 8) & 0xFF] << 8) ^ is[s2 & 0xFF] ^ rk[1]);
+        StoreBE32(out + 8,  ((u32)is[s2 >> 24] << 24) ^ ((u32)is[(s1 >> 16) & 0xFF] << 16) ^ ((u32)is[(s0 >> 8) & 0xFF] << 8) ^ is[s3 & 0xFF] ^ rk[2]);
+        StoreBE32(out + 12, ((u32)is[s3 >> 24] << 24) ^ ((u32)is[(s2 >> 16) & 0xFF] << 16) ^ ((u32)is[(s1 >> 8) & 0xFF] << 8) ^ is[s0 & 0xFF] ^ rk[3]);
+    }
+
+#ifdef RD_AES_NI
+    // CBC decryption has no dependency between blocks beyond the ciphertext, so four blocks go through the
+    // pipelined aesdec units at once.
+    RD_AES_NI_TARGET
+    void DecryptCBCHardware(const u8 (*keys)[AES256Decryptor::BlockSize], const u8 *src, u8 *dst, usize size, const u8 *iv) {
+        __m128i rk[AES256Decryptor::Rounds + 1];
+        for (int i = 0; i <= AES256Decryptor::Rounds; ++i) {
+            rk[i] = _mm_load_si128((const __m128i*)keys[i]);
+        }
+
+        __m128i prev = _mm_loadu_si128((const __m128i*)iv);
+        usize i = 0;
+        for (; i + 4 * AES256Decryptor::BlockSize <= size; i += 4 * AES256Decryptor::BlockSize) {
+            __m128i c0 = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i c1 = _mm_loadu_si128((const __m128i*)(src + i + 16));
+            __m128i c2 = _mm_loadu_si128((const __m128i*)(src + i + 32));
+            __m128i c3 = _mm_loadu_si128((const __m128i*)(src + i + 48));
+
+            __m128i b0 = _mm_xor_si128(c0, rk[0]);
+            __m128i b1 = _mm_xor_si128(c1, rk[0]);
+            __m128i b2 = _mm_xor_si128(c2, rk[0]);
+            __m128i b3 = _mm_xor_si128(c3, rk[0]);
+            for (int round = 1; round < AES256Decryptor::Rounds; ++round) {
+                b0 = _mm_aesdec_si128(b0, rk[round]);
+                b1 = _mm_aesdec_si128(b1, rk[round]);
+                b2 = _mm_aesdec_si128(b2, rk[round]);
+                b3 = _mm_aesdec_si128(b3, rk[round]);
+            }
+            b0 = _mm_aesdeclast_si128(b0, rk[AES256Decryptor::Rounds]);
+            b1 = _mm_aesdeclast_si128(b1, rk[AES256Decryptor::Rounds]);
+            b2 = _mm_aesdeclast_si128(b2, rk[AES256Decryptor::Rounds]);
+            b3 = _mm_aesdeclast_si128(b3, rk[AES256Decryptor::Rounds]);
+
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(b0, prev));
+            _mm_storeu_si128((__m128i*)(dst + i + 16), _mm_xor_si128(b1, c0));
+            _mm_storeu_si128((__m128i*)(dst + i + 32), _mm_xor_si128(b2, c1));
+            _mm_storeu_si128((__m128i*)(dst + i + 48), _mm_xor_si128(b3, c2));
+            prev = c3;
+        }
+
+        for (; i < size; i += AES256Decryptor::BlockSize) {
+            __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i b = _mm_xor_si128(c, rk[0]);
+            for (int round = 1; round < AES256Decryptor::Rounds; ++round) {
+                b = _mm_aesdec_si128(b, rk[round]);
+            }
+            b = _mm_aesdeclast_si128(b, rk[AES256Decryptor::Rounds]);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(b, prev));
+            prev = c;
+        }
+    }
+#endif
+}
+
+bool AES256Decryptor::HasHardwareSupport() {
+#if defined(RD_AES_NI) && defined(_MSC_VER)
+    static const bool supported = [] {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 25)) != 0;
+    }();
+    return supported;
+#elif defined(RD_AES_NI)
+    static const bool supported = __builtin_cpu_supports("aes");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void AES256Decryptor::SetKey(const u8 *key) {
+    const AESTables &t = Tables();
+
+    // Standard AES-256 key expansion into 60 words.
+    constexpr int WordCount = (Rounds + 1) * 4;
+    u8 words[WordCount][4];
+    memcpy(words, key, KeySize);
+
+    u8 rcon = 1;
+    for (int i = 8; i < WordCount; ++i) {
+        u8 temp[4];
+        memcpy(temp, words[i - 1], 4);
+        if (i % 8 == 0) {
+            u8 first = temp[0];
+            temp[0] = t.sbox[temp[1]] ^ rcon;
+            temp[1] = t.sbox[temp[2]];
+            temp[2] = t.sbox[temp[3]];
+            temp[3] = t.sbox[first];
+            rcon = GFMul(rcon, 2);
+        } else if (i % 8 == 4) {
+            for (u8 &b : temp) b = t.sbox[b];
+        }
+        for (int j = 0; j < 4; ++j) {
+            words[i][j] = words[i - 8][j] ^ temp[j];
+        }
+    }
+
+    // Equivalent inverse cipher: reverse the round order and push InvMixColumns into the middle round keys.
+    for (int round = 0; round <= Rounds; ++round) {
+        memcpy(dec_keys[round], words[(Rounds - round) * 4], BlockSize);
+        if (round != 0 && round != Rounds) InvMixColumns(dec_keys[round]);
+        for (int j = 0; j < 4; ++j) {
+            dec_words[round * 4 + j] = LoadBE32(dec_keys[round] + j * 4);
+        }
+    }
+}
+
+void AES256Decryptor::DecryptCBC(const u8 *src, u8 *dst, usize size, const u8 *iv) const {
+    size -= size % BlockSize;
+
+#ifdef RD_AES_NI
+    if (HasHardwareSupport()) {
+        DecryptCBCHardware(dec_keys, src, dst, size, iv);
+        return;
+    }
+#endif
+
+    const u8 *prev = iv;
+    for (usize i = 0; i < size; i += BlockSize) {
+        DecryptBlockPortable(dec_words, src + i, dst + i);
+        for (usize j = 0; j < BlockSize; ++j) {
+            dst[i + j] ^= prev[j];
+        }
+        prev = src + i;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <util/int.h>
+
+// AES-256 decryption in CBC mode. Uses AES-NI when the CPU has it and a table driven implementation otherwise.
+class AES256Decryptor {
+public:
+    static constexpr usize BlockSize = 16;
+    static constexpr usize KeySize = 32;
+    static constexpr int Rounds = 14;
+
+    AES256Decryptor() = default;
+    AES256Decryptor(const u8 *key) {
+        SetKey(key);
+    }
+
+    void SetKey(const u8 *key);
+
+    // Decrypts `size` bytes (a multiple of BlockSize) from `src` into `dst`. `iv` is the IV for the first block, or
+    // the ciphertext block preceding `src` when decrypting from the middle of a stream, which is what lets separate
+    // threads take separate chunks. `dst` must not overlap `src`.
+    void DecryptCBC(const u8 *src, u8 *dst, usize size, const u8 *iv) const;
+
+    static bool HasHardwareSupport();
+
+private:
+    // Round keys in the order the inverse cipher uses them, with InvMixColumns already applied to the middle rounds.
+    u32 dec_words[(Rounds + 1) * 4] = {};
+    alignas(16) u8 dec_keys[Rounds + 1][BlockSize] = {};
+};
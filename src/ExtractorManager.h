@@ -30,6 +30,7 @@ public:
       return m_formats;
   }
 
+  // Detection stays on the calling thread: nearly every check is a magic compare, cheaper than starting a thread.
   FormatList GetExtractorCandidates(u8 *buffer, u64 size, const std::string &ext) {
     auto format_list = FormatList();
     for (const auto &[name, format] : m_formats) {
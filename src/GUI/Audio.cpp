@@ -2,13 +2,14 @@
 #include <Utils.h>
 #include <DirectoryNode.h>
 #include <SDL3_mixer/SDL_mixer.h>
+#include <ArchiveFormats/ArchiveFormat.h>
 #include <algorithm>
 
 #include "state.h"
 
 void Audio::MusicFinishedCallback(void* userdata, MIX_Track *track) {
     const PreviewWinState &state = GetPreviewState(preview_index);
-    if (state.audio.music && state.audio.shouldLoop) {
+    if (state.audio.loaded && state.audio.shouldLoop) {
         MIX_PlayTrack(state.audio.track, 0);
     }
 }
@@ -32,7 +33,6 @@ void Audio::InitAudioSystem() {
     MIX_GetMixerFormat(state.audio.mixer, &spec);
     if (spec.freq == 0 || spec.format == 0 || spec.channels == 0) {
         Logger::error("Failed to query audio spec: {}", SDL_GetError());
-        MIX_DestroyAudio(state.audio.music);
         return;
     }
 
@@ -54,3 +54,96 @@ const std::string audio_exts[] = {
 bool Audio::IsAudio(const std::string &ext) {
     return std::find(std::begin(audio_exts), std::end(audio_exts), Utils::ToLower(ext)) != std::end(audio_exts);
 };
+
+struct EntryStream {
+    ArchiveBase *archive;
+    const Entry *entry;
+    u8 *buffer;
+    u64 position;
+};
+
+static Sint64 EntryStreamSize(void *userdata) {
+    return ((EntryStream*)userdata)->entry->size;
+}
+
+static Sint64 EntryStreamSeek(void *userdata, Sint64 offset, SDL_IOWhence whence) {
+    EntryStream *stream = (EntryStream*)userdata;
+    Sint64 base = 0;
+    if (whence == SDL_IO_SEEK_CUR) {
+        base = stream->position;
+    } else if (whence == SDL_IO_SEEK_END) {
+        base = stream->entry->size;
+    }
+    if (base + offset < 0) {
+        SDL_SetError("Seek before the start of the entry");
+        return -1;
+    }
+    stream->position = base + offset;
+    return stream->position;
+}
+
+static size_t EntryStreamRead(void *userdata, void *ptr, size_t size, SDL_IOStatus *status) {
+    EntryStream *stream = (EntryStream*)userdata;
+    if (stream->position >= stream->entry->size) {
+        *status = SDL_IO_STATUS_EOF;
+        return 0;
+    }
+    usize read;
+    {
+        // The mixer reads from its own thread, alongside thumbnail workers and extraction.
+        auto stream_lock = stream->archive->LockStreams();
+        read = stream->archive->ReadRange(stream->entry, stream->buffer, stream->position, (u8*)ptr, size);
+    }
+    if (read == 0) {
+        SDL_SetError("Failed to read archive entry");
+        *status = SDL_IO_STATUS_ERROR;
+        return 0;
+    }
+    stream->position += read;
+    return read;
+}
+
+static bool EntryStreamClose(void *userdata) {
+    delete (EntryStream*)userdata;
+    return true;
+}
+
+bool Audio::CanStreamEntry(ArchiveBase *archive, const Entry *entry, u8 *buffer) {
+    u8 probe;
+    auto stream_lock = archive->LockStreams();
+    return entry->size > 0 && archive->ReadRange(entry, buffer, 0, &probe, 1) == 1;
+}
+
+SDL_IOStream *Audio::OpenEntryStream(ArchiveBase *archive, const Entry *entry, u8 *buffer) {
+    SDL_IOStreamInterface iface;
+    SDL_INIT_INTERFACE(&iface);
+    iface.size = EntryStreamSize;
+    iface.seek = EntryStreamSeek;
+    iface.read = EntryStreamRead;
+    iface.close = EntryStreamClose;
+
+    EntryStream *stream = new EntryStream{archive, entry, buffer, 0};
+    SDL_IOStream *io = SDL_OpenIO(&iface, stream);
+    if (!io) {
+        delete stream;
+    }
+    return io;
+}
+
+bool Audio::ReadInfo(SDL_IOStream *io, SDL_AudioSpec *spec, Sint64 *frames, SDL_PropertiesID *metadata) {
+    // Creating a decoder only parses the headers, nothing is decoded until asked for.
+    MIX_AudioDecoder *decoder = MIX_CreateAudioDecoder_IO(io, true, 0);
+    if (!decoder) return false;
+
+    if (!MIX_GetAudioDecoderFormat(decoder, spec)) {
+        MIX_DestroyAudioDecoder(decoder);
+        return false;
+    }
+    SDL_PropertiesID props = MIX_GetAudioDecoderProperties(decoder);
+    *frames = SDL_GetNumberProperty(props, MIX_PROP_METADATA_DURATION_FRAMES_NUMBER, -1);
+    *metadata = SDL_CreateProperties();
+    SDL_CopyProperties(props, *metadata);
+
+    MIX_DestroyAudioDecoder(decoder);
+    return true;
+}
@@ -2,10 +2,22 @@
 
 #include <string>
 #include <SDL3_mixer/SDL_mixer.h>
+#include <util/int.h>
+
+class ArchiveBase;
+struct Entry;
 
 namespace Audio {
     void InitAudioSystem();
     bool IsAudio(const std::string &ext);
 
+    // Whether the archive can read parts of `entry` through ReadRange, which OpenEntryStream needs.
+    bool CanStreamEntry(ArchiveBase *archive, const Entry *entry, u8 *buffer);
+    // A seekable stream over an archive entry that reads through ReadRange, the archive and its buffer have to outlive it.
+    SDL_IOStream *OpenEntryStream(ArchiveBase *archive, const Entry *entry, u8 *buffer);
+    // Reads the format, length in frames and tags of `io` without decoding it. `metadata` is the caller's to destroy.
+    // Takes ownership of `io`.
+    bool ReadInfo(SDL_IOStream *io, SDL_AudioSpec *spec, Sint64 *frames, SDL_PropertiesID *metadata);
+
     void MusicFinishedCallback(void* userdata, MIX_Track *track);
 };
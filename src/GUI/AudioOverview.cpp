@@ -0,0 +1,442 @@
+#include <AudioOverview.h>
+#include <SDK/util/Logger.hpp>
+#include <SDL3_mixer/SDL_mixer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RD_OVERVIEW_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RD_OVERVIEW_NEON
+#endif
+
+// Frames decoded at a time, the overview is updated after each chunk.
+constexpr int ChunkFrames = 16384;
+// Levels past this are coarser than a pixel for anything shorter than a few hours.
+constexpr usize MaxLevels = 8;
+// Voice lines are short, this many of them is a good while of going back and forth.
+constexpr usize CachedOverviews = 16;
+// Spectrogram range, quieter than this is black.
+constexpr float FloorDB = -100.0f;
+
+struct CachedOverview {
+    u64 key;
+    std::shared_ptr<AudioOverview> overview;
+};
+
+// Most recently requested first.
+static std::list<CachedOverview> cache;
+
+// FNV-1a, only has to tell tracks apart.
+static u64 HashBytes(const void *data, usize size, u64 hash = 0xCBF29CE484222325ull) {
+    for (usize i = 0; i < size; ++i) {
+        hash ^= ((const u8*)data)[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+std::shared_ptr<AudioOverview> AudioOverview::Request(const std::string &path, u64 size, u64 stamp, Sint64 frames,
+                                                      const std::function<SDL_IOStream*()> &open, bool reads_archive) {
+    u64 key = HashBytes(path.data(), path.size());
+    key = HashBytes(&size, sizeof(size), key);
+    key = HashBytes(&stamp, sizeof(stamp), key);
+
+    auto it = std::find_if(cache.begin(), cache.end(), [key](const CachedOverview &cached) { return cached.key == key; });
+    if (it != cache.end()) {
+        cache.splice(cache.begin(), cache, it);
+        return it->overview;
+    }
+
+    // Nobody is waiting for these anymore, don't let a quick skim through a folder pile up workers.
+    std::erase_if(cache, [](const CachedOverview &cached) {
+        return !cached.overview->Done() && cached.overview.use_count() == 1;
+    });
+
+    SDL_IOStream *io = open();
+    if (!io) {
+        Logger::error("Failed to open {} for its overview: {}", path, SDL_GetError());
+        return nullptr;
+    }
+
+    auto overview = std::make_shared<AudioOverview>(io, frames, reads_archive);
+    cache.push_front({ key, overview });
+    if (cache.size() > CachedOverviews) {
+        cache.pop_back();
+    }
+    return overview;
+}
+
+void AudioOverview::CloseArchive() {
+    std::erase_if(cache, [](const CachedOverview &cached) {
+        AudioOverview &overview = *cached.overview;
+        if (!overview.reads_archive || overview.Done()) return false;
+        // It may still be shown, so stop it here rather than waiting for the last reference to go.
+        overview.cancel = true;
+        if (overview.worker.joinable()) {
+            overview.worker.join();
+        }
+        return true;
+    });
+}
+
+AudioOverview::AudioOverview(SDL_IOStream *io, Sint64 frames, bool reads_archive)
+    : total_frames(frames), reads_archive(reads_archive) {
+    if (total_frames > 0) {
+        hop = std::max<u64>(FFTSize / 2, ((u64)total_frames + SpectrogramColumns - 1) / SpectrogramColumns);
+        columns = ((u64)total_frames + hop - 1) / hop;
+        spectrogram.resize(columns * (FFTSize / 2) * 4);
+    }
+    worker = std::thread(&AudioOverview::Decode, this, io);
+}
+
+AudioOverview::~AudioOverview() {
+    cancel = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (texture) {
+        glDeleteTextures(1, &texture);
+    }
+}
+
+static void MinMax(const float *samples, usize count, float *min, float *max) {
+    float lo = samples[0], hi = samples[0];
+    usize i = 0;
+#if defined(RD_OVERVIEW_SSE2)
+    if (count >= 4) {
+        __m128 vlo = _mm_loadu_ps(samples), vhi = vlo;
+        for (i = 4; i + 4 <= count; i += 4) {
+            const __m128 v = _mm_loadu_ps(samples + i);
+            vlo = _mm_min_ps(vlo, v);
+            vhi = _mm_max_ps(vhi, v);
+        }
+        vlo = _mm_min_ps(vlo, _mm_shuffle_ps(vlo, vlo, _MM_SHUFFLE(1, 0, 3, 2)));
+        vlo = _mm_min_ps(vlo, _mm_shuffle_ps(vlo, vlo, _MM_SHUFFLE(2, 3, 0, 1)));
+        vhi = _mm_max_ps(vhi, _mm_shuffle_ps(vhi, vhi, _MM_SHUFFLE(1, 0, 3, 2)));
+        vhi = _mm_max_ps(vhi, _mm_shuffle_ps(vhi, vhi, _MM_SHUFFLE(2, 3, 0, 1)));
+        lo = _mm_cvtss_f32(vlo);
+        hi = _mm_cvtss_f32(vhi);
+    }
+#elif defined(RD_OVERVIEW_NEON)
+    if (count >= 4) {
+        float32x4_t vlo = vld1q_f32(samples), vhi = vlo;
+        for (i = 4; i + 4 <= count; i += 4) {
+            const float32x4_t v = vld1q_f32(samples + i);
+            vlo = vminq_f32(vlo, v);
+            vhi = vmaxq_f32(vhi, v);
+        }
+        float32x2_t plo = vpmin_f32(vget_low_f32(vlo), vget_high_f32(vlo));
+        float32x2_t phi = vpmax_f32(vget_low_f32(vhi), vget_high_f32(vhi));
+        lo = vget_lane_f32(vpmin_f32(plo, plo), 0);
+        hi = vget_lane_f32(vpmax_f32(phi, phi), 0);
+    }
+#endif
+    for (; i < count; ++i) {
+        lo = std::min(lo, samples[i]);
+        hi = std::max(hi, samples[i]);
+    }
+    *min = lo;
+    *max = hi;
+}
+
+void AudioOverview::AddPeak(usize level, Peak peak) {
+    if (level == levels.size()) {
+        levels.emplace_back();
+    }
+    std::vector<Peak> &peaks = levels[level];
+    peaks.push_back(peak);
+    if (level + 1 < MaxLevels && peaks.size() % 4 == 0) {
+        const Peak *last = &peaks[peaks.size() - 4];
+        AddPeak(level + 1, {
+            std::min(std::min(last[0].min, last[1].min), std::min(last[2].min, last[3].min)),
+            std::max(std::max(last[0].max, last[1].max), std::max(last[2].max, last[3].max)),
+        });
+    }
+}
+
+// The end of the track rarely fills up the last peak of every level, those get the frames that are left.
+void AudioOverview::FinishPeaks() {
+    for (usize level = 0; level < levels.size() && level + 1 < MaxLevels; ++level) {
+        const std::vector<Peak> &peaks = levels[level];
+        const usize left = peaks.size() % 4;
+        // A single peak on top is as coarse as it gets.
+        if (left == 0 || (level + 1 == levels.size() && peaks.size() == 1)) continue;
+
+        Peak peak = peaks[peaks.size() - left];
+        for (usize i = peaks.size() - left + 1; i < peaks.size(); ++i) {
+            peak.min = std::min(peak.min, peaks[i].min);
+            peak.max = std::max(peak.max, peaks[i].max);
+        }
+        AddPeak(level + 1, peak);
+    }
+}
+
+struct FFTTables {
+    float window[AudioOverview::FFTSize];
+    float cos[AudioOverview::FFTSize / 2];
+    float sin[AudioOverview::FFTSize / 2];
+
+    FFTTables() {
+        for (int i = 0; i < AudioOverview::FFTSize; ++i) {
+            window[i] = 0.5f - 0.5f * std::cos(2.0 * std::numbers::pi * i / AudioOverview::FFTSize);
+        }
+        for (int i = 0; i < AudioOverview::FFTSize / 2; ++i) {
+            cos[i] = std::cos(2.0 * std::numbers::pi * i / AudioOverview::FFTSize);
+            sin[i] = -std::sin(2.0 * std::numbers::pi * i / AudioOverview::FFTSize);
+        }
+    }
+};
+
+static const FFTTables &GetFFTTables() {
+    static const FFTTables tables;
+    return tables;
+}
+
+// In place radix 2 FFT of FFTSize points.
+static void FFT(float *re, float *im) {
+    constexpr int n = AudioOverview::FFTSize;
+    const FFTTables &tables = GetFFTTables();
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    for (int length = 2; length <= n; length <<= 1) {
+        const int step = n / length;
+        for (int i = 0; i < n; i += length) {
+            for (int k = 0; k < length / 2; ++k) {
+                const float wr = tables.cos[k * step], wi = tables.sin[k * step];
+                float *ar = &re[i + k], *ai = &im[i + k];
+                float *br = &re[i + k + length / 2], *bi = &im[i + k + length / 2];
+                const float tr = *br * wr - *bi * wi;
+                const float ti = *br * wi + *bi * wr;
+                *br = *ar - tr;
+                *bi = *ai - ti;
+                *ar += tr;
+                *ai += ti;
+            }
+        }
+    }
+}
+
+// Black through purple and red to a pale yellow as it gets louder.
+static void HeatColor(float t, u8 *rgba) {
+    static constexpr u8 stops[][3] = {
+        {0, 0, 0}, {70, 0, 110}, {210, 30, 50}, {255, 160, 0}, {255, 255, 190},
+    };
+    constexpr int last = sizeof(stops) / sizeof(stops[0]) - 1;
+    const float at = std::clamp(t, 0.0f, 1.0f) * last;
+    const int i = std::min((int)at, last - 1);
+    const float f = at - i;
+    for (int c = 0; c < 3; ++c) {
+        rgba[c] = (u8)(stops[i][c] + (stops[i + 1][c] - stops[i][c]) * f + 0.5f);
+    }
+    rgba[3] = 255;
+}
+
+// Works out every column whose window has been decoded, or all that are left once the track ended.
+void AudioOverview::AnalyzeColumns(bool flush) {
+    const FFTTables &tables = GetFFTTables();
+    // A full scale sine peaks at this after the Hann window.
+    constexpr float full_scale = FFTSize / 4.0f;
+
+    usize column = columns_ready.load(std::memory_order_relaxed);
+    while (column < columns && !cancel) {
+        const u64 start = column * hop;
+        if (!flush && start + FFTSize > samples_start + samples.size()) break;
+
+        float re[FFTSize], im[FFTSize] = {};
+        for (int i = 0; i < FFTSize; ++i) {
+            const u64 at = start + i - samples_start;
+            re[i] = at < samples.size() ? samples[at] * tables.window[i] : 0.0f;
+        }
+        FFT(re, im);
+
+        u8 *out = &spectrogram[column * (FFTSize / 2) * 4];
+        for (int bin = 0; bin < FFTSize / 2; ++bin) {
+            const float magnitude = std::sqrt(re[bin] * re[bin] + im[bin] * im[bin]) / full_scale;
+            const float db = 20.0f * std::log10(magnitude + 1e-9f);
+            HeatColor((db - FloorDB) / -FloorDB, out + bin * 4);
+        }
+        columns_ready.store(++column, std::memory_order_release);
+    }
+
+    const u64 needed_from = std::min<u64>(column * hop, samples_start + samples.size());
+    if (needed_from > samples_start) {
+        samples.erase(samples.begin(), samples.begin() + (needed_from - samples_start));
+        samples_start = needed_from;
+    }
+}
+
+void AudioOverview::Decode(SDL_IOStream *io) {
+    MIX_AudioDecoder *decoder = MIX_CreateAudioDecoder_IO(io, true, 0);
+    SDL_AudioSpec spec;
+    if (!decoder || !MIX_GetAudioDecoderFormat(decoder, &spec)) {
+        Logger::error("Failed to decode audio for its overview: {}", SDL_GetError());
+        if (decoder) {
+            MIX_DestroyAudioDecoder(decoder);
+        }
+        done.store(true, std::memory_order_release);
+        return;
+    }
+    // Mixed down to a single channel, at the track's own rate so frames line up with playback positions.
+    spec.format = SDL_AUDIO_F32;
+    spec.channels = 1;
+
+    std::vector<float> chunk(ChunkFrames);
+    std::vector<Peak> peaks;
+    Peak pending = {};
+    usize pending_frames = 0;
+    while (!cancel) {
+        const int bytes = MIX_DecodeAudio(decoder, chunk.data(), ChunkFrames * sizeof(float), &spec);
+        if (bytes <= 0) break;
+        const usize count = bytes / sizeof(float);
+
+        peaks.clear();
+        for (usize i = 0; i < count;) {
+            const usize length = std::min<usize>(PeakFrames - pending_frames, count - i);
+            Peak peak;
+            MinMax(&chunk[i], length, &peak.min, &peak.max);
+            if (pending_frames == 0) {
+                pending = peak;
+            } else {
+                pending.min = std::min(pending.min, peak.min);
+                pending.max = std::max(pending.max, peak.max);
+            }
+            pending_frames += length;
+            i += length;
+            if (pending_frames == PeakFrames) {
+                peaks.push_back(pending);
+                pending_frames = 0;
+            }
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            for (const Peak &peak : peaks) {
+                AddPeak(0, peak);
+            }
+            decoded_frames += count;
+        }
+
+        if (columns > 0) {
+            samples.insert(samples.end(), chunk.begin(), chunk.begin() + count);
+            AnalyzeColumns(false);
+        }
+    }
+    MIX_DestroyAudioDecoder(decoder);
+
+    if (!cancel) {
+        std::lock_guard lock(mutex);
+        if (pending_frames > 0) {
+            AddPeak(0, pending);
+        }
+        FinishPeaks();
+    }
+    if (columns > 0 && !cancel) {
+        AnalyzeColumns(true);
+    }
+    samples = {};
+    done.store(true, std::memory_order_release);
+}
+
+void AudioOverview::DrawWaveform(ImDrawList *draw_list, ImVec2 pos, ImVec2 size, float progress) {
+    std::lock_guard lock(mutex);
+    const u64 frames = total_frames > 0 ? (u64)total_frames : decoded_frames;
+    if (levels.empty() || frames == 0) return;
+
+    const double frames_per_pixel = (double)frames / size.x;
+    // The coarsest level that still has a peak for every pixel.
+    usize level = 0;
+    while (level + 1 < levels.size() && (double)((u64)PeakFrames << (2 * (level + 1))) <= frames_per_pixel) {
+        level++;
+    }
+    const std::vector<Peak> &peaks = levels[level];
+    const double peaks_per_pixel = frames_per_pixel / ((u64)PeakFrames << (2 * level));
+
+    const float middle = pos.y + size.y * 0.5f;
+    const float half = size.y * 0.5f;
+    const float played = pos.x + size.x * progress;
+    const ImU32 played_color = ImGui::GetColorU32(ImGuiCol_SliderGrabActive);
+    const ImU32 color = ImGui::GetColorU32(ImGuiCol_PlotLines);
+    for (int x = 0; x < (int)size.x; ++x) {
+        const usize first = (usize)(x * peaks_per_pixel);
+        if (first >= peaks.size()) break;
+        const usize last = std::min(peaks.size(), std::max(first + 1, (usize)((x + 1) * peaks_per_pixel)));
+
+        Peak peak = peaks[first];
+        for (usize i = first + 1; i < last; ++i) {
+            peak.min = std::min(peak.min, peaks[i].min);
+            peak.max = std::max(peak.max, peaks[i].max);
+        }
+        const float top = middle - std::clamp(peak.max, -1.0f, 1.0f) * half;
+        const float bottom = std::max(top + 1.0f, middle - std::clamp(peak.min, -1.0f, 1.0f) * half);
+        const float left = pos.x + x;
+        draw_list->AddRectFilled({left, top}, {left + 1.0f, bottom}, left < played ? played_color : color);
+    }
+}
+
+void AudioOverview::DrawSpectrogram(ImDrawList *draw_list, ImVec2 pos, ImVec2 size) {
+    const usize ready = columns_ready.load(std::memory_order_acquire);
+    if (ready > columns_uploaded) {
+        if (!texture) {
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, FFTSize / 2, columns, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        // Every column is a row of the texture, so what's new is one contiguous block.
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, columns_uploaded, FFTSize / 2, ready - columns_uploaded, GL_RGBA,
+                        GL_UNSIGNED_BYTE, &spectrogram[columns_uploaded * (FFTSize / 2) * 4]);
+        columns_uploaded = ready;
+    }
+    if (columns_uploaded == 0) return;
+
+    // Time runs down the texture and frequency across it, turn it so time goes right and low frequencies are at the
+    // bottom.
+    const float filled = (float)columns_uploaded / columns;
+    const float right = pos.x + size.x * filled;
+    const float bottom = pos.y + size.y;
+    draw_list->AddImageQuad(texture, pos, {right, pos.y}, {right, bottom}, {pos.x, bottom},
+                            {1.0f, 0.0f}, {1.0f, filled}, {0.0f, filled}, {0.0f, 0.0f});
+}
+
+bool AudioOverview::Draw(const char *id, ImVec2 size, float progress, bool show_spectrogram, float *seek) {
+    const ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton(id, size);
+    const bool active = ImGui::IsItemActive();
+    if (active) {
+        *seek = std::clamp((ImGui::GetIO().MousePos.x - pos.x) / size.x, 0.0f, 1.0f);
+    }
+
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    const ImVec2 end = {pos.x + size.x, pos.y + size.y};
+    draw_list->AddRectFilled(pos, end, ImGui::GetColorU32(ImGuiCol_FrameBg));
+    draw_list->PushClipRect(pos, end, true);
+    if (show_spectrogram && columns > 0) {
+        DrawSpectrogram(draw_list, pos, size);
+    } else {
+        DrawWaveform(draw_list, pos, size, progress);
+    }
+
+    const float playhead = std::floor(pos.x + size.x * std::clamp(progress, 0.0f, 1.0f));
+    draw_list->AddLine({playhead, pos.y}, {playhead, end.y}, ImGui::GetColorU32(ImGuiCol_Text));
+    draw_list->PopClipRect();
+    return active;
+}
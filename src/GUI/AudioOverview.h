@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL3/SDL.h>
+#include <gl3.h>
+#include <imgui.h>
+#include <util/int.h>
+
+// Waveform and spectrogram of a whole track for the audio preview. A worker decodes the track a second time, separately
+// from playback, and keeps min/max peaks at a few resolutions plus one spectrum per column of the spectrogram, so the
+// overview fills in while it's being computed. Finished overviews are kept for the last few tracks, going back to a
+// voice line doesn't decode it again.
+class AudioOverview {
+public:
+    // Frames summed up in each peak of the finest level, every level after it has a quarter as many peaks.
+    static constexpr int PeakFrames = 256;
+    static constexpr int FFTSize = 512;
+    static constexpr int SpectrogramColumns = 1024;
+
+    // The overview of the track identified by `path`, `size` and `stamp`, computed from the stream `open` returns if
+    // it isn't cached. `open` is only called right away, on the calling thread. Overviews that `reads_archive` have to
+    // be stopped with CloseArchive before the loaded archive goes away. `frames` is the track's length if known,
+    // without it there's no spectrogram.
+    static std::shared_ptr<AudioOverview> Request(const std::string &path, u64 size, u64 stamp, Sint64 frames,
+                                                  const std::function<SDL_IOStream*()> &open, bool reads_archive);
+    // Stops the overviews still reading from the loaded archive, and forgets them since they won't be complete.
+    static void CloseArchive();
+
+    AudioOverview(SDL_IOStream *io, Sint64 frames, bool reads_archive);
+    ~AudioOverview();
+    AudioOverview(const AudioOverview&) = delete;
+    AudioOverview &operator=(const AudioOverview&) = delete;
+
+    bool Done() const { return done.load(std::memory_order_acquire); }
+
+    // Draws the part computed so far with a playhead at `progress` (0..1), as a spectrogram if asked for and the track
+    // has one. Returns true while it's clicked or dragged, with where to seek to in `seek`.
+    bool Draw(const char *id, ImVec2 size, float progress, bool show_spectrogram, float *seek);
+
+private:
+    struct Peak {
+        float min;
+        float max;
+    };
+
+    void Decode(SDL_IOStream *io);
+    void AddPeak(usize level, Peak peak);
+    void FinishPeaks();
+    void AnalyzeColumns(bool flush);
+    void DrawWaveform(ImDrawList *draw_list, ImVec2 pos, ImVec2 size, float progress);
+    void DrawSpectrogram(ImDrawList *draw_list, ImVec2 pos, ImVec2 size);
+
+    Sint64 total_frames;
+    bool reads_archive;
+    std::atomic<bool> cancel = false;
+    std::atomic<bool> done = false;
+    std::thread worker;
+
+    // Guards `levels` and `decoded_frames`, the worker adds to them after every chunk it decodes.
+    std::mutex mutex;
+    // Level 0 has a peak per PeakFrames frames, every level after it merges four peaks of the one before.
+    std::vector<std::vector<Peak>> levels;
+    u64 decoded_frames = 0;
+
+    // Worker only: decoded samples from `samples_start` on, kept until the columns that need them are done.
+    std::vector<float> samples;
+    u64 samples_start = 0;
+    u64 hop = 0;
+
+    // RGBA, FFTSize / 2 pixels per column from the lowest frequency up. Allocated up front, `columns_ready` says how
+    // many of them the worker has filled in.
+    std::vector<u8> spectrogram;
+    usize columns = 0;
+    std::atomic<usize> columns_ready = 0;
+    GLuint texture = 0;
+    usize columns_uploaded = 0;
+};
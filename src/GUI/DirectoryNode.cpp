@@ -1,7 +1,12 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <Audio.h>
+#include <AudioOverview.h>
 #include <DirectoryNode.h>
 #include <Image.h>
+#include <ImVec2Util.h>
+#include <Thumbnails.h>
+#include <TextView.h>
+#include <TiledImage.h>
 #include <algorithm>
 #include <cmath>
 #include <filesystem>
@@ -14,6 +19,7 @@
 #include <util/Text.h>
 #include <util/int.h>
 #include <util/memory.h>
+#include <util/BufferPool.h>
 #include <Utils.h>
 
 #include "SDL3_mixer/SDL_mixer.h"
@@ -77,6 +83,10 @@ struct FileLoadingResult {
     Entry* selected_entry = nullptr;
     ContentType typeOverride = ContentType::UNKNOWN;
     usize tab_index = 0;
+    // Decoded on the loading thread when the file is going to be shown as an image.
+    SDL_Surface* image = nullptr;
+    // Audio that's read as it plays, entry_buffer stays empty.
+    bool streamed = false;
 };
 
 static std::atomic<bool> file_loading_in_progress = false;
@@ -205,12 +215,35 @@ bool VirtualArc::ExtractEntry(const fs::path &basePath, Entry *entry, fs::path o
         return false;
     }
 
-    u8 *extracted = loaded_arc_base->OpenStream(entry, current_buffer);
+    // Formats that can decode into a buffer we provide get a recycled one, so extracting a whole archive doesn't
+    // allocate and free a fresh buffer per entry.
+    BufferPool &pool = BufferPool::Shared();
+    u8 *extracted = (u8*)pool.Allocate(entry->size);
+    bool pooled;
+    {
+        // Thumbnail workers and audio streaming may be reading the archive at the same time.
+        auto stream_lock = loaded_arc_base->LockStreams();
+        pooled = extracted && loaded_arc_base->ReadRange(entry, current_buffer, 0, extracted, entry->size) == entry->size;
+        if (!pooled) {
+            pool.Deallocate(extracted, entry->size);
+            extracted = loaded_arc_base->OpenStream(entry, current_buffer);
+        }
+    }
+    if (!extracted) return false;
+
+    auto release = [&]() {
+        if (pooled) pool.Deallocate(extracted, entry->size);
+        else free(extracted);
+    };
 
     FILE *file = fopen(fullOutputPath.string().c_str(), "wb");
-    if (!file) return false;
+    if (!file) {
+        release();
+        return false;
+    }
     fwrite(extracted, sizeof(u8), entry->size, file);
     fclose(file);
+    release();
 
     return true;
 }
@@ -224,10 +257,35 @@ void VirtualArc::ExtractAll() {
     std::string basePath = "extracted/" + fileName;
     fs::create_directories(basePath);
 
+    std::vector<Entry*> queue;
+    queue.reserve(entries.size());
     for (auto &[_, entry] : entries) {
-        if (!VirtualArc::ExtractEntry(basePath, entry)) {
-            Logger::error("Failed to extract: {}", entry->name.data());
+        queue.push_back(entry);
+    }
+
+    usize thread_count = 1;
+    if (loaded_arc_base->ConcurrentStreams()) {
+        thread_count = std::min<usize>(std::max(1u, std::thread::hardware_concurrency()), queue.size());
+    }
+
+    std::atomic<usize> next = 0;
+    auto worker = [&]() {
+        ArchiveBase::stream_workers = thread_count;
+        for (usize i = next++; i < queue.size(); i = next++) {
+            if (!VirtualArc::ExtractEntry(basePath, queue[i])) {
+                Logger::error("Failed to extract: {}", queue[i]->name.data());
+            }
         }
+        ArchiveBase::stream_workers = 1;
+    };
+
+    std::vector<std::thread> workers;
+    for (usize i = 1; i < thread_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
     }
 }
 
@@ -235,6 +293,43 @@ void VirtualArc::ExtractEntry(std::string path) {
     VirtualArc::ExtractEntry(path, selected_entry);
 }
 
+static void UnloadAudio(PreviewWinState &state) {
+    state.audio.playing = false;
+    if (state.audio.loaded) {
+        MIX_StopAllTracks(state.audio.mixer, 0);
+        // The track keeps reading its stream until it lets go of it, which also closes the stream.
+        MIX_SetTrackAudio(state.audio.track, nullptr);
+        state.audio.loaded = false;
+    }
+    if (state.audio.metadata) {
+        SDL_DestroyProperties(state.audio.metadata);
+        state.audio.metadata = 0;
+    }
+    if (state.audio.buffer) {
+        free(state.audio.buffer);
+        state.audio.buffer = nullptr;
+    };
+    state.audio.streams_archive = false;
+    state.audio.overview.reset();
+    state.audio.time = {};
+    state.audio.scrubberDragging = false;
+    if (state.audio.update_timer) {
+        SDL_RemoveTimer(state.audio.update_timer);
+        state.audio.update_timer = 0;
+    }
+}
+
+// Audio streamed from an archive entry reads the archive while it plays, so it has to stop before the archive closes,
+// and so do overviews still being worked out from one.
+static void StopArchiveAudio() {
+    for (PreviewWinState &state : preview_windows) {
+        if (state.audio.streams_archive) {
+            UnloadAudio(state);
+        }
+    }
+    AudioOverview::CloseArchive();
+}
+
 void DirectoryNode::UnloadSelectedFile() {
     text_editor__unsaved_changes = false;
 
@@ -253,6 +348,8 @@ void DirectoryNode::UnloadSelectedFile() {
 
     Image::UnloadTexture(state.texture.id);
     Image::UnloadAnimation(&state.texture.anim);
+    delete state.texture.tiled;
+    delete state.contents.textView;
 
     state.texture = {};
     image_preview.zoom = 1.0f;
@@ -260,23 +357,7 @@ void DirectoryNode::UnloadSelectedFile() {
     state.contents = {};
     state.contents.type = ContentType::UNKNOWN;
 
-    state.audio.playing = false;
-    if (state.audio.music) {
-        MIX_StopAllTracks(state.audio.mixer, 0);
-        MIX_DestroyAudio(state.audio.music);
-        state.audio.music = nullptr;
-    }
-    if (state.audio.buffer) {
-        free(state.audio.buffer);
-        state.audio.buffer = nullptr;
-    };
-    state.audio.time = {};
-    state.audio.scrubberDragging = false;
-    if (state.audio.update_timer) {
-        SDL_RemoveTimer(state.audio.update_timer);
-        state.audio.update_timer = 0;
-    }
-    state.audio.music = nullptr;
+    UnloadAudio(state);
 }
 
 void DirectoryNode::Unload(Node *node) {
@@ -380,6 +461,8 @@ bool DirectoryNode::AddNodes(Node *node, const fs::path &parentPath) {
 
 void UnloadArchive() {
     if (loaded_arc_base) {
+        StopArchiveAudio();
+        Thumbnails::CloseArchive();
         loaded_arc_base->ArchiveDestroy();
         delete loaded_arc_base;
         loaded_arc_base = nullptr;
@@ -445,7 +528,7 @@ void DirectoryNode::ReloadRootNode(Node *node) {
 
 Uint32 TimerUpdateCB(void* userdata, Uint32 interval, Uint32 param) {
     PreviewWinState &state = GetPreviewState(preview_index);
-    if (state.audio.music) {
+    if (state.audio.loaded) {
         double current_time = MIX_GetTrackPlaybackPosition(state.audio.track);
         double current_time_sec = MIX_FramesToMS(state.audio.spec.freq, current_time) / 1000.0f;
         if (!state.audio.scrubberDragging) {
@@ -456,7 +539,95 @@ Uint32 TimerUpdateCB(void* userdata, Uint32 interval, Uint32 param) {
     return interval;
 }
 
-void InitializePreviewData(DirectoryNode::Node *node, u8 *entry_buffer, u64 size, const std::string &ext, bool isVirtualRoot, ContentType typeOverride = ContentType::UNKNOWN) {
+// Takes ownership of the decoded image.
+static void UploadPreviewImage(PreviewWinState &state, SDL_Surface *image) {
+    if (!image) {
+        return;
+    }
+    if (TiledImage::NeedsTiling(image->w, image->h)) {
+        *state.texture.size.x = image->w;
+        *state.texture.size.y = image->h;
+        state.texture.tiled = new TiledImage(image);
+        return;
+    }
+
+    // Small images are mostly icons and pixel art, keep them sharp when zoomed in.
+    const bool smooth = image->w >= 256;
+    state.texture.id = Image::UploadImage(image, state.texture.size, smooth ? GL_LINEAR : GL_NEAREST);
+    SDL_DestroySurface(image);
+    if (smooth) {
+        // Zooming out would alias badly without mipmaps.
+        glBindTexture(GL_TEXTURE_2D, state.texture.id);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+}
+
+// Audio is decoded as it plays. Files are read from disk and archive entries through ReadRange as needed, only
+// entries of archives that can't read part of an entry are kept in memory, still undecoded.
+static void LoadPreviewAudio(PreviewWinState &state, DirectoryNode::Node *node, u8 *entry_buffer, u64 size, bool isVirtualRoot) {
+    if (isVirtualRoot && entry_buffer) {
+        state.audio.buffer = (u8*)malloc(size);
+        memcpy(state.audio.buffer, entry_buffer, size);
+    }
+    state.audio.streams_archive = isVirtualRoot && !entry_buffer;
+
+    // Playback and the format lookup each read a stream of their own.
+    auto open = [&]() -> SDL_IOStream* {
+        if (!isVirtualRoot) return SDL_IOFromFile(node->FullPath.data(), "rb");
+        if (!entry_buffer) return Audio::OpenEntryStream(loaded_arc_base, selected_entry, current_buffer);
+        return SDL_IOFromConstMem(state.audio.buffer, size);
+    };
+
+    SDL_IOStream *info_io = open();
+    bool has_info = info_io && Audio::ReadInfo(info_io, &state.audio.spec, &state.audio.frames, &state.audio.metadata);
+    SDL_IOStream *snd_io = has_info ? open() : nullptr;
+    // Unlike loading a MIX_Audio, which copies all of the stream into memory first, the track reads it as it plays.
+    state.audio.loaded = snd_io && MIX_SetTrackIOStream(state.audio.track, snd_io, true);
+    if (!state.audio.loaded) {
+        Logger::error("Failed to load audio: {}", SDL_GetError());
+        if (state.audio.metadata) {
+            SDL_DestroyProperties(state.audio.metadata);
+            state.audio.metadata = 0;
+        }
+        free(state.audio.buffer);
+        state.audio.buffer = nullptr;
+        state.audio.streams_archive = false;
+        return;
+    }
+
+    MIX_PlayTrack(state.audio.track, 1);
+    double duration_frames = state.audio.frames;
+    double duration_sec = MIX_FramesToMS(state.audio.spec.freq, duration_frames) / 1000.0;
+    state.audio.playing = true;
+    state.audio.time.total_time_min = duration_sec / 60;
+    state.audio.time.total_time_sec = fmod(duration_sec, 60.0);
+    state.audio.update_timer = SDL_AddTimer(1000, TimerUpdateCB, nullptr);
+
+    // The overview decodes a second stream of its own, playback keeps its position in the first.
+    const Sint64 frames = state.audio.frames;
+    if (!isVirtualRoot) {
+        state.audio.overview = AudioOverview::Request(node->FullPath, node->FileSizeBytes, node->LastModifiedUnix, frames, [node]() {
+            return SDL_IOFromFile(node->FullPath.data(), "rb");
+        }, false);
+    } else if (!entry_buffer) {
+        state.audio.overview = AudioOverview::Request(node->FullPath, selected_entry->size, selected_entry->offset, frames, []() {
+            return Audio::OpenEntryStream(loaded_arc_base, selected_entry, current_buffer);
+        }, true);
+    } else {
+        state.audio.overview = AudioOverview::Request(node->FullPath, size, selected_entry ? selected_entry->offset : 0, frames, [&]() {
+            // Its own copy, playback's goes away with the track while the overview may still be working.
+            SDL_IOStream *io = SDL_IOFromDynamicMem();
+            if (io && (SDL_WriteIO(io, entry_buffer, size) != size || SDL_SeekIO(io, 0, SDL_IO_SEEK_SET) != 0)) {
+                SDL_CloseIO(io);
+                io = nullptr;
+            }
+            return io;
+        }, false);
+    }
+}
+
+void InitializePreviewData(DirectoryNode::Node *node, u8 *entry_buffer, u64 size, const std::string &ext, bool isVirtualRoot, SDL_Surface *image, ContentType typeOverride = ContentType::UNKNOWN) {
     ContentType type;
 
     PreviewWinState &state = GetPreviewState(preview_index);
@@ -466,49 +637,16 @@ void InitializePreviewData(DirectoryNode::Node *node, u8 *entry_buffer, u64 size
         state.contents.type = type;
 
         if (type == IMAGE) {
-            Image::LoadImage(entry_buffer, size, &state.texture.id, state.texture.size);
-            if (*state.texture.size.x < 256) {
-                Image::LoadImage(entry_buffer, size, &state.texture.id, state.texture.size, GL_NEAREST);
-            }
+            UploadPreviewImage(state, image);
         } else if (type == GIF) {
             Image::LoadGifAnimation(entry_buffer, size, &state.texture.anim);
             state.texture.frame = 0;
             state.texture.last_frame_time = SDL_GetTicks();
         } else if (type == AUDIO) {
-            if (isVirtualRoot) {
-                state.audio.buffer = (u8*)malloc(size);
-                memcpy(state.audio.buffer, entry_buffer, size);
-                SDL_IOStream *snd_io = SDL_IOFromMem(state.audio.buffer, size);
-                state.audio.music = MIX_LoadAudio_IO(state.audio.mixer, snd_io, true, true);
-                if (!state.audio.music) {
-                    Logger::error("Failed to load audio: {}", SDL_GetError());
-                    state.audio.buffer = nullptr;
-                }
-            } else {
-                state.audio.music = MIX_LoadAudio(state.audio.mixer, node->FullPath.data(), true);
-            }
-
-            if (state.audio.music) {
-                MIX_SetTrackAudio(state.audio.track, state.audio.music);
-                MIX_PlayTrack(state.audio.track, 1);
-                if (!MIX_GetAudioFormat(state.audio.music, &state.audio.spec)) {
-                    Logger::error("Failed to get audio format: {}", SDL_GetError());
-                    MIX_DestroyAudio(state.audio.music);
-                }
-                double duration_frames = MIX_GetAudioDuration(state.audio.music);
-                double duration_sec = MIX_FramesToMS(state.audio.spec.freq, duration_frames) / 1000.0;
-                state.audio.playing = true;
-                state.audio.time.total_time_min = duration_sec / 60;
-                state.audio.time.total_time_sec = fmod(duration_sec, 60.0);
-                state.audio.update_timer = SDL_AddTimer(1000, TimerUpdateCB, nullptr);
-            }
+            LoadPreviewAudio(state, node, entry_buffer, size, isVirtualRoot);
         } else if (type == ELF) {
             auto *elfFile = new ElfFile(entry_buffer, size);
             state.contents.elfFile = elfFile;
-        } else if (type == TEXT || type == HEX) {
-            auto text = std::string((char*)entry_buffer, size);
-            editor.SetText(text);
-            editor.SetTextChanged(false);
         }
 
         return;
@@ -516,10 +654,7 @@ void InitializePreviewData(DirectoryNode::Node *node, u8 *entry_buffer, u64 size
 
     // Automatic detection
     if (Image::IsImageExtension(ext)) {
-        Image::LoadImage(entry_buffer, size, &state.texture.id, state.texture.size);
-        if (*state.texture.size.x < 256) {
-            Image::LoadImage(entry_buffer, size, &state.texture.id, state.texture.size, GL_NEAREST);
-        }
+        UploadPreviewImage(state, image);
         type = IMAGE;
         state.contents.type = type;
     } else if (Image::IsGif(ext)) {
@@ -530,42 +665,14 @@ void InitializePreviewData(DirectoryNode::Node *node, u8 *entry_buffer, u64 size
     } else if (Audio::IsAudio(ext)) {
         type = AUDIO;
         state.contents.type = type;
-        if (isVirtualRoot) {
-            state.audio.buffer = (u8*)malloc(size);
-            memcpy(state.audio.buffer, entry_buffer, size);
-            SDL_IOStream *snd_io = SDL_IOFromMem(state.audio.buffer, size);
-            state.audio.music = MIX_LoadAudio_IO(state.audio.mixer, snd_io, true, true);
-            if (!state.audio.music) {
-                Logger::error("Failed to load audio: {}", SDL_GetError());
-                state.audio.buffer = nullptr;
-            }
-        } else {
-            state.audio.music = MIX_LoadAudio(state.audio.mixer, node->FullPath.data(), true);
-        }
-
-        if (state.audio.music) {
-            MIX_SetTrackAudio(state.audio.track, state.audio.music);
-            MIX_PlayTrack(state.audio.track, 1);
-            if (!MIX_GetAudioFormat(state.audio.music, &state.audio.spec)) {
-                Logger::error("Failed to get audio format: {}", SDL_GetError());
-                MIX_DestroyAudio(state.audio.music);
-            }
-            double duration_frames = MIX_GetAudioDuration(state.audio.music);
-            double duration_sec = MIX_FramesToMS(state.audio.spec.freq, duration_frames) / 1000.0;
-            state.audio.playing = true;
-            state.audio.time.total_time_min = duration_sec / 60;
-            state.audio.time.total_time_sec = fmod(duration_sec, 60.0);
-            state.audio.update_timer = SDL_AddTimer(1000, TimerUpdateCB, nullptr);
-        }
+        LoadPreviewAudio(state, node, entry_buffer, size, isVirtualRoot);
     } else if (ElfFile::IsValid(entry_buffer)) {
         auto *elfFile = new ElfFile(entry_buffer, size);
         state.contents.elfFile = elfFile;
         state.contents.type = ELF;
     } else {
-        // Default to text if size is less than 3MB
-        auto text = std::string((char*)entry_buffer, size);
-        editor.SetText(text);
-        editor.SetTextChanged(false);
+        // Default to text if size is less than 3MB. Either way it's shown straight from the buffer, the text only
+        // goes into the TextEditor once it gets edited.
         if (size < 3000000) {
             state.contents.type = TEXT;
         } else {
@@ -594,7 +701,8 @@ void ProcessFileLoadingResult(const FileLoadingResult& result, ContentType typeO
         selected_entry = result.selected_entry;
     }
 
-    if (typeOverride != ContentType::UNKNOWN) {
+    // Streamed audio was never read in, so there's nothing to look for an archive in either.
+    if (typeOverride != ContentType::UNKNOWN || result.streamed) {
         state.contents = {
             .data = result.entry_buffer,
             .size = result.size,
@@ -603,7 +711,7 @@ void ProcessFileLoadingResult(const FileLoadingResult& result, ContentType typeO
             .fileName = result.node->FileName
         };
 
-        InitializePreviewData(result.node, result.entry_buffer, result.size, result.ext, result.isVirtualRoot, typeOverride);
+        InitializePreviewData(result.node, result.entry_buffer, result.size, result.ext, result.isVirtualRoot, result.image, typeOverride);
         return;
     }
 
@@ -619,7 +727,7 @@ void ProcessFileLoadingResult(const FileLoadingResult& result, ContentType typeO
             .fileName = result.node->FileName
         };
 
-        InitializePreviewData(result.node, result.entry_buffer, result.size, result.ext, result.isVirtualRoot, typeOverride);
+        InitializePreviewData(result.node, result.entry_buffer, result.size, result.ext, result.isVirtualRoot, result.image, typeOverride);
         return;
     } else if (format_list.size() > 1) {
         Logger::warn("Multiple formats found for {}", result.node->FileName.data());
@@ -629,6 +737,9 @@ void ProcessFileLoadingResult(const FileLoadingResult& result, ContentType typeO
         }
     }
 
+    // Turned out to be an archive after all.
+    SDL_DestroySurface(result.image);
+
     auto format = format_list[0];
     auto arc = format->TryOpen(result.entry_buffer, result.size, result.node->FileName);
     if (arc == nullptr) {
@@ -642,6 +753,8 @@ void ProcessFileLoadingResult(const FileLoadingResult& result, ContentType typeO
 
     // Clean up previous archive if it exists
     if (loaded_arc_base) {
+        StopArchiveAudio();
+        Thumbnails::CloseArchive();
         loaded_arc_base->ArchiveDestroy();
         delete loaded_arc_base;
         loaded_arc_base = nullptr;
@@ -653,14 +766,9 @@ void ProcessFileLoadingResult(const FileLoadingResult& result, ContentType typeO
         current_buffer = nullptr;
     }
 
-    current_buffer = malloc<u8>(result.size);
-    if (current_buffer) {
-        memcpy(current_buffer, result.entry_buffer, result.size);
-    } else {
-        Logger::error("Failed to allocate current_buffer for archive");
-    }
-
-    free(result.entry_buffer);
+    // The archive keeps the exact buffer it was opened from, plugins are allowed to hold on to it until ArchiveDestroy.
+    current_buffer = result.entry_buffer;
+    Thumbnails::OpenArchive(arc, current_buffer, result.size, result.node->FullPath);
 
     rootNode = DirectoryNode::CreateTreeFromPath(result.node->FullPath);
 }
@@ -689,6 +797,7 @@ void DirectoryNode::HandleFileClick(Node *node, ContentType typeOverride, usize
         result.isVirtualRoot = isVirtualRoot;
         result.typeOverride = typeOverride;
         result.tab_index = tab_index;
+        bool is_audio = typeOverride == AUDIO || (typeOverride == ContentType::UNKNOWN && Audio::IsAudio(ext));
 
 #ifndef _WIN32
         try {
@@ -700,9 +809,18 @@ void DirectoryNode::HandleFileClick(Node *node, ContentType typeOverride, usize
                     entry_to_process = FindEntryByNode(loaded_arc_base->GetEntries(), node);
                 }
 
-                if (entry_to_process) {
+                if (entry_to_process && current_buffer && is_audio && Audio::CanStreamEntry(loaded_arc_base, entry_to_process, current_buffer)) {
+                    result.size = entry_to_process->size;
+                    result.streamed = true;
+                    result.success = true;
+                    result.selected_entry = entry_to_process;
+                } else if (entry_to_process) {
                     if (current_buffer) {
-                        auto arc_read = loaded_arc_base->OpenStream(entry_to_process, current_buffer);
+                        u8 *arc_read;
+                        {
+                            auto stream_lock = loaded_arc_base->LockStreams();
+                            arc_read = loaded_arc_base->OpenStream(entry_to_process, current_buffer);
+                        }
                         if (arc_read == nullptr) {
                             result.error_message = "Received nullptr from OpenStream! Cannot show entry.";
                             result.success = false;
@@ -732,6 +850,17 @@ void DirectoryNode::HandleFileClick(Node *node, ContentType typeOverride, usize
                     result.success = false;
                     Logger::error("Entry not found in archive: {}", node->FileName.c_str());
                 }
+            } else if (is_audio && !node->IsDirectory) {
+                std::error_code ec;
+                result.size = fs::file_size(node->FullPath, ec);
+                if (ec) {
+                    result.error_message = "Failed to read file from filesystem";
+                    result.success = false;
+                    Logger::error("Failed to read file: {}", node->FullPath.c_str());
+                } else {
+                    result.streamed = true;
+                    result.success = true;
+                }
             } else {
                 auto [fs_buffer, fs_size] = read_file_to_buffer<u8>(node->FullPath.data());
                 if (!fs_buffer) {
@@ -755,6 +884,12 @@ void DirectoryNode::HandleFileClick(Node *node, ContentType typeOverride, usize
                     }
                 }
             }
+
+            // Decoding is the slow part of opening an image, do it here so the UI thread only uploads the pixels.
+            bool is_image = typeOverride == IMAGE || (typeOverride == ContentType::UNKNOWN && Image::IsImageExtension(ext));
+            if (result.success && is_image) {
+                result.image = Image::DecodeImage(result.entry_buffer, result.size);
+            }
 #ifndef _WIN32
         } catch (const std::exception& e) {
             char error_message[512];
@@ -801,13 +936,8 @@ inline bool CanReadDirectory(const std::string& path) {
 #endif
 }
 
-void DirectoryNode::Display(Node *node) {
-    ImGui::TableNextRow();
-    ImGui::PushID(node);
-
-    ImGui::TableNextColumn();
-    ImGui::Selectable(node->FileName.data(), false, ImGuiSelectableFlags_AllowDoubleClick);
-
+// Handles clicks on the item just submitted for `node`, shared by the list and the grid.
+static void HandleNodeClicks(DirectoryNode::Node *node) {
     if (ImGui::IsItemClicked() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
         if (node->IsDirectory) {
             if (!rootNode->IsVirtualRoot && !CanReadDirectory(node->FullPath)) {
@@ -819,11 +949,11 @@ void DirectoryNode::Display(Node *node) {
                     node->Parent = rootNode;
                     rootNode = node;
                 } else {
-                    rootNode = CreateTreeFromPath(node->FullPath, rootNode);
+                    rootNode = DirectoryNode::CreateTreeFromPath(node->FullPath, rootNode);
                 }
             }
         } else {
-            HandleFileClick(node, ContentType::UNKNOWN, preview_index);
+            DirectoryNode::HandleFileClick(node, ContentType::UNKNOWN, preview_index);
         }
         if (rootNode->FullPath.ends_with("/")) {
             SetFilePath(rootNode->FullPath);
@@ -839,6 +969,15 @@ void DirectoryNode::Display(Node *node) {
         }
         ImGui::OpenPopup("FBContextMenu");
     }
+}
+
+void DirectoryNode::Display(Node *node) {
+    ImGui::TableNextRow();
+    ImGui::PushID(node);
+
+    ImGui::TableNextColumn();
+    ImGui::Selectable(node->FileName.data(), false, ImGuiSelectableFlags_AllowDoubleClick);
+    HandleNodeClicks(node);
 
     ImGui::TableNextColumn();
     ImGui::TextAligned(ALIGN_RIGHT, -FLT_MIN, node->FileSize);
@@ -883,11 +1022,123 @@ void SetFilePath(const std::string& file_path) {
     file_path_buf[copy_len] = '\0';
 }
 
+static void OpenParent(DirectoryNode::Node *node) {
+    if (node->Parent) {
+        rootNode = node->Parent;
+    } else {
+        UnloadArchive();
+        DirectoryNode::Unload(rootNode);
+        if (node->FullPath.ends_with("/")) {
+            node->FullPath.pop_back();
+        }
+        auto parent_path = fs::path(node->FullPath).parent_path().string();
+        if (parent_path.empty()) {
+            parent_path = "/";
+        }
+        rootNode = DirectoryNode::CreateTreeFromPath(parent_path);
+        if (current_buffer) {
+            free(current_buffer);
+            current_buffer = nullptr;
+        }
+    }
+    SetFilePath(rootNode->FullPath);
+}
+
+// Draws `text` centered in the cell's label line, cut short with an ellipsis if it doesn't fit.
+static void GridCellLabel(ImDrawList *draw_list, ImVec2 min, ImVec2 max, const std::string &text) {
+    const ImVec2 text_size = ImGui::CalcTextSize(text.c_str());
+    if (text_size.x < max.x - min.x) {
+        min.x += (max.x - min.x - text_size.x) * 0.5f;
+    }
+    ImGui::RenderTextEllipsis(draw_list, min, max, max.x, text.c_str(), nullptr, &text_size);
+}
+
+// `node` is null for the ".." cell.
+static void DisplayGridCell(DirectoryNode::Node *parent, DirectoryNode::Node *node, ImVec2 cell) {
+    const ImGuiStyle &style = ImGui::GetStyle();
+    ImGui::PushID(node ? (void*)node : (void*)"..");
+
+    const ImVec2 pos = ImGui::GetCursorScreenPos();
+    ImGui::Selectable("##cell", false, ImGuiSelectableFlags_AllowDoubleClick, cell);
+    if (!node) {
+        if (ImGui::IsItemClicked() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+            OpenParent(parent);
+        }
+    } else {
+        HandleNodeClicks(node);
+        if (ImGui::IsItemHovered() && !node->IsDirectory) {
+            ImGui::SetTooltip("%s\n%s", node->FileName.c_str(), node->FileSize.c_str());
+        }
+    }
+
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    const ImVec2 box_min = pos + ImVec2((cell.x - Thumbnails::Size) * 0.5f, style.FramePadding.y);
+    const ImVec2 box_size((float)Thumbnails::Size, (float)Thumbnails::Size);
+
+    Vec2<int> size(0, 0);
+    GLuint texture = node && Thumbnails::HasThumbnail(node) ? Thumbnails::Request(node, &size) : 0;
+    if (texture) {
+        // Fit inside the box without upscaling small images.
+        const float scale = std::min(1.0f, std::min(box_size.x / size.x, box_size.y / size.y));
+        const ImVec2 image_size = ImVec2(size.x * scale, size.y * scale);
+        const ImVec2 image_min = Floor(box_min + (box_size - image_size) * 0.5f);
+        draw_list->AddImage(texture, image_min, image_min + image_size);
+    } else {
+        const char *icon = !node || node->IsDirectory ? FOLDER_ICON : FILE_ICON;
+        const float icon_size = ImGui::GetFontSize() * 3.0f;
+        const ImVec2 icon_extent = ImGui::GetFont()->CalcTextSizeA(icon_size, FLT_MAX, 0.0f, icon);
+        draw_list->AddText(ImGui::GetFont(), icon_size, Floor(box_min + (box_size - icon_extent) * 0.5f), ImGui::GetColorU32(ImGuiCol_TextDisabled), icon);
+    }
+
+    const ImVec2 label_min = ImVec2(pos.x + style.FramePadding.x, box_min.y + box_size.y + style.FramePadding.y);
+    const ImVec2 label_max = ImVec2(pos.x + cell.x - style.FramePadding.x, label_min.y + ImGui::GetTextLineHeight());
+    GridCellLabel(draw_list, label_min, label_max, node ? node->FileName : std::string(".."));
+
+    ImGui::PopID();
+}
+
+static void DisplayGrid(DirectoryNode::Node *node) {
+    const ImGuiStyle &style = ImGui::GetStyle();
+    const ImVec2 cell(Thumbnails::Size + style.FramePadding.x * 2.0f, Thumbnails::Size + ImGui::GetTextLineHeight() + style.FramePadding.y * 3.0f);
+
+    ImGui::BeginChild("DirectoryGrid");
+    const int columns = std::max(1, (int)((ImGui::GetContentRegionAvail().x + style.ItemSpacing.x) / (cell.x + style.ItemSpacing.x)));
+    // The ".." cell comes first.
+    const usize count = node->Children.size() + 1;
+    const int rows = (int)((count + columns - 1) / columns);
+
+    ImGuiListClipper clipper;
+    clipper.Begin(rows, cell.y + style.ItemSpacing.y);
+    int end_row = 0;
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                const usize index = (usize)row * columns + column;
+                if (index >= count) break;
+                if (column > 0) ImGui::SameLine();
+                DisplayGridCell(node, index == 0 ? nullptr : node->Children[index - 1], cell);
+            }
+        }
+        end_row = clipper.DisplayEnd;
+    }
+
+    // Queue the next screenful after what's visible, so scrolling finds it ready.
+    const int visible_rows = (int)(ImGui::GetWindowHeight() / (cell.y + style.ItemSpacing.y)) + 1;
+    const usize prefetch_end = std::min(count, (usize)(end_row + visible_rows) * columns);
+    for (usize index = std::max<usize>((usize)end_row * columns, 1); index < prefetch_end; ++index) {
+        if (Thumbnails::HasThumbnail(node->Children[index - 1])) {
+            Thumbnails::Request(node->Children[index - 1]);
+        }
+    }
+
+    ImGui::EndChild();
+}
+
 #define FB_COLUMNS 3
 void DirectoryNode::Setup(Node *node) {
     ImGui::PushID(node);
 
-    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x - 48);
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x - 96);
     if (ImGui::InputText("##file_path", file_path_buf, 1024, ImGuiInputTextFlags_EnterReturnsTrue)) {
 #if defined(__linux__) || defined(EMSCRIPTEN)
     std::string expanded_path = LinuxExpandUserPath(std::string(file_path_buf));
@@ -910,6 +1161,18 @@ void DirectoryNode::Setup(Node *node) {
         ImGui::OpenPopup("Settings");
     };
 
+    ImGui::SameLine();
+
+    if (ImGui::Button(fb__grid_view ? "List" : "Grid", {40, 0})) {
+        fb__grid_view = !fb__grid_view;
+    }
+
+    if (fb__grid_view) {
+        DisplayGrid(node);
+        ImGui::PopID();
+        return;
+    }
+
     ImGui::BeginTable("DirectoryTable", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Resizable);
     ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_IndentDisable);
     ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 90.0f);
@@ -969,25 +1232,7 @@ void DirectoryNode::Setup(Node *node) {
     ImGui::TableNextColumn();
     AddDirectoryNodeChild("..", [node](){
         if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
-            if (node->Parent) {
-                rootNode = node->Parent;
-            } else {
-                UnloadArchive();
-                DirectoryNode::Unload(rootNode);
-                if (node->FullPath.ends_with("/")) {
-                    node->FullPath.pop_back();
-                }
-                auto parent_path = fs::path(node->FullPath).parent_path().string();
-                if (parent_path.empty()) {
-                    parent_path = "/";
-                }
-                rootNode = DirectoryNode::CreateTreeFromPath(parent_path);
-                if (current_buffer) {
-                    free(current_buffer);
-                    current_buffer = nullptr;
-                }
-            }
-            SetFilePath(rootNode->FullPath);
+            OpenParent(node);
         }
     });
     ImGui::TableNextColumn();
@@ -5,85 +5,289 @@
 
 #include <string_view>
 #include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
 
 #include <ResourceFormats/DDS/DDS.h>
-
-bool Image::LoadGifAnimation(void* data, size_t data_size, GifAnimation* out_animation)
-{
-    SDL_IOStream* stream = SDL_IOFromMem(data, data_size);
-    if (!stream) {
-        Logger::error("Failed to create IOStream: {}", SDL_GetError());
+#include <ResourceFormats/DDS/BCDecode.h>
+#include <ResourceFormats/TLG/TLGDecode.h>
+
+// How many decoded frames the worker may get ahead of playback.
+constexpr usize GifRingFrames = 4;
+
+struct GifStream {
+    IMG_AnimationDecoder *decoder = nullptr;
+    u8 *data = nullptr;
+    int frame_count = 0;
+
+    // Slots [head, head + count) hold decoded frames waiting to be shown, the rest belong to the worker.
+    SDL_Surface *slots[GifRingFrames] = {};
+    int slot_frames[GifRingFrames] = {};
+    usize head = 0;
+    usize count = 0;
+    bool stop = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+
+    // Worker only.
+    int next_frame = 0;
+};
+
+// Walks the GIF blocks for the frame count and delays without decoding anything, playback needs the total duration
+// up front. Delays of 0 or 10 ms get the 100 ms browsers use for them.
+static bool ScanGifFrames(const u8 *data, usize size, std::vector<u32> &delays) {
+    if (size < 13 || (memcmp(data, "GIF87a", 6) != 0 && memcmp(data, "GIF89a", 6) != 0)) {
         return false;
     }
+    usize pos = 13;
+    if (data[10] & 0x80) {
+        pos += 3 << ((data[10] & 7) + 1);
+    }
 
-    IMG_Animation* animation = IMG_LoadAnimation_IO(stream, 1);
-    if (!animation) {
-        Logger::error("Failed to load GIF animation: {}", SDL_GetError());
-        return false;
+    auto skip_sub_blocks = [&]() {
+        while (pos < size && data[pos] != 0) {
+            pos += data[pos] + 1;
+        }
+        pos++;
+        return pos <= size;
+    };
+
+    u32 delay = 0;
+    while (pos < size) {
+        u8 block = data[pos++];
+        if (block == 0x3B) {
+            break;
+        } else if (block == 0x21) {
+            if (pos >= size) return false;
+            u8 label = data[pos++];
+            if (label == 0xF9 && pos + 5 <= size && data[pos] == 4) {
+                delay = (data[pos + 2] | (data[pos + 3] << 8)) * 10;
+            }
+            if (!skip_sub_blocks()) return false;
+        } else if (block == 0x2C) {
+            if (pos + 10 > size) return false;
+            u8 flags = data[pos + 8];
+            pos += 9;
+            if (flags & 0x80) {
+                pos += 3 << ((flags & 7) + 1);
+            }
+            // LZW minimum code size, then the image data.
+            pos++;
+            if (pos > size || !skip_sub_blocks()) return false;
+            delays.push_back(delay <= 10 ? 100 : delay);
+            delay = 0;
+        } else {
+            return false;
+        }
     }
+    return !delays.empty();
+}
 
-    out_animation->frame_count = animation->count;
-    out_animation->width = animation->w;
-    out_animation->height = animation->h;
+// Decodes the next frame into `slot`, starting over at the end of the animation. Returns the frame's index, or -1
+// if decoding failed.
+static int DecodeGifFrame(GifStream *stream, SDL_Surface *slot) {
+    SDL_Surface *frame = nullptr;
+    Uint64 duration;
+    if (stream->next_frame >= stream->frame_count || !IMG_GetAnimationDecoderFrame(stream->decoder, &frame, &duration) || !frame) {
+        if (stream->next_frame == 0 || !IMG_ResetAnimationDecoder(stream->decoder)) {
+            return -1;
+        }
+        stream->next_frame = 0;
+        if (!IMG_GetAnimationDecoderFrame(stream->decoder, &frame, &duration) || !frame) {
+            return -1;
+        }
+    }
 
-    out_animation->delays = (u32*)SDL_calloc(out_animation->frame_count, sizeof(u32));
-    out_animation->total_duration_ms = 0;
+    // A plain copy converts to RGBA32, frames that don't cover the canvas get cleared edges.
+    if (frame->w != slot->w || frame->h != slot->h) {
+        SDL_FillSurfaceRect(slot, nullptr, 0);
+    }
+    SDL_SetSurfaceBlendMode(frame, SDL_BLENDMODE_NONE);
+    bool copied = SDL_BlitSurface(frame, nullptr, slot, nullptr);
+    SDL_DestroySurface(frame);
+    return copied ? stream->next_frame++ : -1;
+}
 
-    for (int i = 0; i < out_animation->frame_count; i++) {
-        out_animation->delays[i] = animation->delays[i];
-        out_animation->total_duration_ms += animation->delays[i];
+static void GifWorker(GifStream *stream) {
+    while (true) {
+        SDL_Surface *slot;
+        {
+            std::unique_lock lock(stream->mutex);
+            stream->cv.wait(lock, [&]() { return stream->stop || stream->count < GifRingFrames; });
+            if (stream->stop) return;
+            slot = stream->slots[(stream->head + stream->count) % GifRingFrames];
+        }
+
+        int frame = DecodeGifFrame(stream, slot);
+        if (frame < 0) {
+            Logger::error("Failed to decode GIF frame: {}", SDL_GetError());
+            return;
+        }
+
+        std::lock_guard lock(stream->mutex);
+        stream->slot_frames[(stream->head + stream->count) % GifRingFrames] = frame;
+        stream->count++;
     }
+}
 
-    for (int i = 0; i < out_animation->frame_count; i++) {
-        out_animation->delays[i] = animation->delays[i];
+static void DestroyGifStream(GifStream *stream) {
+    {
+        std::lock_guard lock(stream->mutex);
+        stream->stop = true;
+    }
+    stream->cv.notify_all();
+    if (stream->worker.joinable()) {
+        stream->worker.join();
+    }
+    if (stream->decoder) {
+        IMG_CloseAnimationDecoder(stream->decoder);
     }
+    for (SDL_Surface *slot : stream->slots) {
+        SDL_DestroySurface(slot);
+    }
+    free(stream->data);
+    delete stream;
+}
 
-    for (int i = 0; i < animation->count; i++) {
-        SDL_Surface* frame_surface = animation->frames[i];
-        if (!frame_surface) {
-            Logger::error("Failed to load frame {}: {}", i, SDL_GetError());
-            continue;
-        }
+static void UploadGifFrame(GLuint texture, const SDL_Surface *frame) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->pitch / 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame->w, frame->h, GL_RGBA, GL_UNSIGNED_BYTE, frame->pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
 
-        SDL_Surface* converted_surface = SDL_ConvertSurface(frame_surface, SDL_PIXELFORMAT_RGBA32);
-        SDL_DestroySurface(frame_surface);
+bool Image::LoadGifAnimation(void* data, size_t data_size, GifAnimation* out_animation)
+{
+    std::vector<u32> delays;
+    if (!ScanGifFrames((const u8*)data, data_size, delays)) {
+        Logger::error("Failed to load GIF animation: not a valid GIF");
+        return false;
+    }
+
+    // The decoder reads from the buffer for as long as the animation plays, so it gets its own copy.
+    auto *stream = new GifStream();
+    stream->frame_count = (int)delays.size();
+    stream->data = (u8*)malloc(data_size);
+    if (!stream->data) {
+        Logger::error("Failed to allocate memory for GIF animation");
+        delete stream;
+        return false;
+    }
+    memcpy(stream->data, data, data_size);
 
-        if (!converted_surface) {
-            Logger::error("Failed to convert frame {} to surface!", i);
-            continue;
+    SDL_IOStream* io = SDL_IOFromConstMem(stream->data, data_size);
+    if (!io) {
+        Logger::error("Failed to create IOStream: {}", SDL_GetError());
+        DestroyGifStream(stream);
+        return false;
+    }
+    stream->decoder = IMG_CreateAnimationDecoder_IO(io, true, "gif");
+    if (!stream->decoder) {
+        Logger::error("Failed to load GIF animation: {}", SDL_GetError());
+        DestroyGifStream(stream);
+        return false;
+    }
+
+    // The first frame is decoded right here so there's something to show immediately.
+    SDL_Surface *first = nullptr;
+    Uint64 duration;
+    if (!IMG_GetAnimationDecoderFrame(stream->decoder, &first, &duration) || !first) {
+        Logger::error("Failed to load GIF animation: {}", SDL_GetError());
+        DestroyGifStream(stream);
+        return false;
+    }
+    for (SDL_Surface *&slot : stream->slots) {
+        slot = SDL_CreateSurface(first->w, first->h, SDL_PIXELFORMAT_RGBA32);
+        if (!slot) {
+            Logger::error("Failed to create surface: {}", SDL_GetError());
+            SDL_DestroySurface(first);
+            DestroyGifStream(stream);
+            return false;
         }
+    }
+    SDL_SetSurfaceBlendMode(first, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(first, nullptr, stream->slots[0], nullptr);
+    SDL_DestroySurface(first);
+    stream->next_frame = 1;
+
+    out_animation->frame_count = stream->frame_count;
+    out_animation->width = stream->slots[0]->w;
+    out_animation->height = stream->slots[0]->h;
+    out_animation->delays = (u32*)SDL_calloc(out_animation->frame_count, sizeof(u32));
+    out_animation->total_duration_ms = 0;
+    for (int i = 0; i < out_animation->frame_count; i++) {
+        out_animation->delays[i] = delays[i];
+        out_animation->total_duration_ms += delays[i];
+    }
 
-        GLuint texture;
-        glGenTextures(1, &texture);
+    glGenTextures(2, out_animation->textures);
+    for (GLuint texture : out_animation->textures) {
         glBindTexture(GL_TEXTURE_2D, texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, converted_surface->w, converted_surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, converted_surface->pixels);
-
-        out_animation->frames.push_back(texture);
-        SDL_DestroySurface(converted_surface);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, out_animation->width, out_animation->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     }
+    UploadGifFrame(out_animation->textures[0], stream->slots[0]);
+    out_animation->front_texture = 0;
+    out_animation->shown_frame = 0;
 
-    IMG_FreeAnimation(animation);
+    out_animation->stream = stream;
+    stream->worker = std::thread(GifWorker, stream);
     return true;
 }
 
-GLuint Image::GetGifFrame(const GifAnimation& animation, int *frame_index)
+GLuint Image::GetGifFrame(GifAnimation& animation, int *frame_index)
 {
-    if (animation.frames.empty()) return 0;
+    GifStream *stream = animation.stream;
+    if (!stream) return 0;
 
     *frame_index = *frame_index % animation.frame_count;
-    return animation.frames[*frame_index];
+    if (*frame_index != animation.shown_frame) {
+        SDL_Surface *frame = nullptr;
+        int frame_number = 0;
+        {
+            std::lock_guard lock(stream->mutex);
+            if (stream->count > 0) {
+                frame = stream->slots[stream->head];
+                frame_number = stream->slot_frames[stream->head];
+            }
+        }
+
+        // The worker doesn't touch a slot until it's popped, so uploading can happen without the lock. Frames go to
+        // the texture that isn't on screen, so the upload never waits on the previous draw.
+        if (frame) {
+            animation.front_texture ^= 1;
+            UploadGifFrame(animation.textures[animation.front_texture], frame);
+            animation.shown_frame = frame_number;
+            {
+                std::lock_guard lock(stream->mutex);
+                stream->head = (stream->head + 1) % GifRingFrames;
+                stream->count--;
+            }
+            stream->cv.notify_one();
+        }
+        *frame_index = animation.shown_frame;
+    }
+    return animation.textures[animation.front_texture];
 }
 
 void Image::UnloadAnimation(GifAnimation* animation)
 {
-    for (GLuint texture : animation->frames) {
-        glDeleteTextures(1, &texture);
+    if (animation->stream) {
+        DestroyGifStream(animation->stream);
+        animation->stream = nullptr;
+    }
+    if (animation->textures[0]) {
+        glDeleteTextures(2, animation->textures);
+        animation->textures[0] = animation->textures[1] = 0;
     }
-    animation->frames.clear();
+    SDL_free(animation->delays);
+    animation->delays = nullptr;
     animation->frame_count = 0;
     return;
 }
@@ -108,33 +312,63 @@ GLuint Image::LoadTex(const u8* data, Vec2<int> size, u32 mode) {
     return image_texture;
 }
 
-bool Image::LoadImage(void* data, size_t data_size, GLuint *out_texture, Vec2<int*> out_size, u32 mode) {
+SDL_Surface *Image::DecodeImage(const void* data, size_t data_size) {
+    u32 tlg_width, tlg_height;
+    if (TLGDecode::ReadSize((const u8*)data, data_size, &tlg_width, &tlg_height)) {
+        SDL_Surface *surface = SDL_CreateSurface(tlg_width, tlg_height, SDL_PIXELFORMAT_RGBA32);
+        if (!surface) {
+            Logger::error("Failed to create surface: {}", SDL_GetError());
+            return nullptr;
+        }
+        if (!TLGDecode::DecodeRGBA8((const u8*)data, data_size, (u8*)surface->pixels)) {
+            Logger::error("Failed to decode TLG: image data is corrupt or truncated");
+            SDL_DestroySurface(surface);
+            return nullptr;
+        }
+        return surface;
+    }
+
     dds::Image image;
     auto result = dds::readImage((u8*)data, data_size, &image);
     if (result == dds::ReadResult::Success) {
-        Vec2<int> img_size(image.width, image.height);
-        auto id = Image::LoadTex(image.mipmaps[0].data(), img_size);
-        *out_texture = id;
-        *out_size.x = image.width;
-        *out_size.y = image.height;
+        // The reader doesn't check the pixel data against the file size, the decoder does.
+        const u8 *pixels = image.mipmaps.empty() ? nullptr : image.mipmaps[0].data();
+        const u8 *end = (const u8*)data + data_size;
+        usize available = pixels && pixels < end ? end - pixels : 0;
+        if (!DDSDecode::IsSupported(image.format)) {
+            Logger::error("Unsupported DDS format {}", (u32)image.format);
+            return nullptr;
+        }
 
-        return true;
+        SDL_Surface *surface = SDL_CreateSurface(image.width, image.height, SDL_PIXELFORMAT_RGBA32);
+        if (!surface) {
+            Logger::error("Failed to create surface: {}", SDL_GetError());
+            return nullptr;
+        }
+        // 4 byte pixels are never padded, so the surface is tightly packed like the decoder wants.
+        if (!pixels || !DDSDecode::DecodeRGBA8(image.format, pixels, available, image.width, image.height, (u8*)surface->pixels)) {
+            Logger::error("Failed to decode DDS: pixel data is truncated");
+            SDL_DestroySurface(surface);
+            return nullptr;
+        }
+        return surface;
     } else if (result != dds::ReadResult::InvalidMagic) {
         Logger::log("Failed to load DDS into memory!");
         Logger::log("Error: {}", dds::DecodeReadResult(result).c_str());
     }
 
-    u8 *image_data;
-
-    SDL_IOStream *stream = SDL_IOFromMem(data, data_size);
+    SDL_IOStream *stream = SDL_IOFromConstMem(data, data_size);
     if (!stream) {
         Logger::error("Failed to create IOStream: {}", SDL_GetError());
-        return false;
+        return nullptr;
     }
     SDL_Surface *surface = IMG_Load_IO(stream, 1);
     if (!surface) {
         Logger::error("Failed to load image: {}", SDL_GetError());
-        return false;
+        return nullptr;
+    }
+    if (surface->format == SDL_PIXELFORMAT_RGBA32) {
+        return surface;
     }
 
     SDL_Surface *converted_surface = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
@@ -142,20 +376,29 @@ bool Image::LoadImage(void* data, size_t data_size, GLuint *out_texture, Vec2<in
 
     if (!converted_surface) {
         Logger::error("Failed to convert surface format: {}", SDL_GetError());
-        return false;
+        return nullptr;
     }
+    return converted_surface;
+}
 
-    Vec2<int> img_size(converted_surface->w, converted_surface->h);
-    image_data = (u8*)(converted_surface->pixels);
-
-    GLuint image_texture = LoadTex(image_data, img_size, mode);
+GLuint Image::UploadImage(const SDL_Surface *surface, Vec2<int*> out_size, u32 mode) {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->pitch / 4);
+    GLuint image_texture = LoadTex((const u8*)surface->pixels, Vec2<int>(surface->w, surface->h), mode);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 
-    SDL_DestroySurface(converted_surface);
+    *out_size.x = surface->w;
+    *out_size.y = surface->h;
+    return image_texture;
+}
 
-    *out_texture = image_texture;
-    *out_size.x = img_size.x;
-    *out_size.y = img_size.y;
+bool Image::LoadImage(void* data, size_t data_size, GLuint *out_texture, Vec2<int*> out_size, u32 mode) {
+    SDL_Surface *surface = DecodeImage(data, data_size);
+    if (!surface) {
+        return false;
+    }
 
+    *out_texture = UploadImage(surface, out_size, mode);
+    SDL_DestroySurface(surface);
     return true;
 }
 
@@ -14,22 +14,34 @@
 #include <util/vec.h>
 #include <util/int.h>
 
+struct GifStream;
+
+// Frames are decoded a few at a time on a worker and uploaded into a pair of textures as playback reaches them, so
+// memory doesn't grow with the length of the animation.
 struct GifAnimation {
-    std::vector<GLuint> frames;
+    GifStream *stream = nullptr;
+    GLuint textures[2] = {};
+    int front_texture = 0;
+    int shown_frame = 0;
     int frame_count = 0;
-    int width;
-    int height;
-    u32 *delays;
+    int width = 0;
+    int height = 0;
+    u32 *delays = nullptr;
     u32 total_duration_ms = 0;
 };
 
 namespace Image {
     GLuint LoadTex(const u8* data, Vec2<int> size, u32 mode = GL_LINEAR);
     bool LoadImage(void* data, size_t data_size, GLuint *out_texture, Vec2<int*> out_size, u32 mode = GL_LINEAR);
+    // Decodes a DDS or anything SDL_image reads to an RGBA32 surface. Doesn't touch GL, so it's safe off the UI thread.
+    SDL_Surface *DecodeImage(const void* data, size_t data_size);
+    GLuint UploadImage(const SDL_Surface *surface, Vec2<int*> out_size, u32 mode = GL_LINEAR);
     bool LoadGifAnimation(void* data, size_t data_size, GifAnimation* out_animation);
     bool UnloadTexture(GLuint texture);
     void UnloadAnimation(GifAnimation* animation);
     bool IsGif(std::string_view ext);
-    GLuint GetGifFrame(const GifAnimation& animation, int *frame_index);
+    // Returns the texture for `frame_index`, or for the latest decoded frame before it if the worker is behind, in which
+    // case `frame_index` is moved back to it.
+    GLuint GetGifFrame(GifAnimation& animation, int *frame_index);
     bool IsImageExtension(const std::string& ext);
 };
@@ -1,9 +1,12 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include <PreviewWindow.h>
 #include <Audio.h>
+#include <AudioOverview.h>
 #include <DirectoryNode.h>
 #include <ImVec2Util.h>
 #include <Markdown.h>
+#include <TextView.h>
+#include <TiledImage.h>
 #include <SDL3/SDL_audio.h>
 #include <util/Text.h>
 #include <imgui.h>
@@ -75,7 +78,12 @@ void PreviewWindow::RenderImagePreview() {
         image_preview.pan += delta;
     }
 
-    if (texture->id) {
+    if (texture->tiled) {
+        ImVec2 draw_pos = Floor(cursor_pos + image_preview.pan);
+        if (!texture->tiled->Draw(ImGui::GetWindowDrawList(), draw_pos, image_preview.zoom)) {
+            ImGui::Text("Building preview...");
+        }
+    } else if (texture->id) {
         ImVec2 image_size = ImVec2(*texture->size.x * image_preview.zoom, *texture->size.y * image_preview.zoom);
         ImVec2 draw_pos = Floor(cursor_pos + image_preview.pan);
         ImVec2 draw_end = draw_pos + Floor(image_size);
@@ -90,6 +98,10 @@ void PreviewWindow::RenderGifPreview() {
     PreviewWinState &state = GetPreviewState(preview_index);
     PWinStateTexture *texture = &state.texture;
     GifAnimation &anim = texture->anim;
+    if (!anim.stream) {
+        ImGui::Text("Failed to load image!");
+        return;
+    }
     ImVec2 image_size = ImVec2(anim.width, anim.height);
     ImGui::SetCursorPos(ImVec2((ImGui::GetWindowSize().x - image_size.x) * 0.5f, 50));
     ImGui::Image(Image::GetGifFrame(anim, &texture->frame), image_size);
@@ -150,7 +162,7 @@ void SelectableCopyableText(const std::string& text) {
 
 void PreviewWindow::RenderAudioPlayer() {
     PreviewWinState &state = GetPreviewState(preview_index);
-    if (state.audio.music) {
+    if (state.audio.loaded) {
         ImGui::Text("Playing: %s", state.contents.path.c_str());
         TimeInfo time = state.audio.time;
         if (state.audio.playing) {
@@ -185,7 +197,7 @@ void PreviewWindow::RenderAudioPlayer() {
         );
         ImGui::SameLine();
         const double current_pos = MIX_FramesToMS(state.audio.spec.freq, MIX_GetTrackPlaybackPosition(state.audio.track));
-        int total_time = MIX_FramesToMS(state.audio.spec.freq, MIX_GetAudioDuration(state.audio.music));
+        int total_time = MIX_FramesToMS(state.audio.spec.freq, state.audio.frames);
         if (total_time > 0.0) {
             ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 5.0f);
             ImGui::SetCursorPosY(ImGui::GetCursorPosY() + 8);
@@ -249,12 +261,27 @@ void PreviewWindow::RenderAudioPlayer() {
             };
         }
 
+        if (state.audio.loaded && state.audio.overview) {
+            const Sint64 total_frames = state.audio.frames;
+            const Sint64 position = MIX_GetTrackPlaybackPosition(state.audio.track);
+            const float progress = total_frames > 0 ? std::clamp((float)position / total_frames, 0.0f, 1.0f) : 0.0f;
+            float seek;
+            if (state.audio.overview->Draw("AudioOverview", {ImGui::GetContentRegionAvail().x, 64.0f}, progress, showSpectrogram, &seek) && total_frames > 0) {
+                MIX_SetTrackPlaybackPosition(state.audio.track, (Sint64)(seek * total_frames));
+            }
+            ImGui::Checkbox("Spectrogram", &showSpectrogram);
+            if (!state.audio.overview->Done()) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("Working out the overview...");
+            }
+        }
+
         if (ImGui::SliderInt("Music Volume", &state.audio.volumePercent, 0, 100, "%d%%")) {
             float sdlVolume = state.audio.volumePercent / 100.0f;
             MIX_SetTrackGain(state.audio.track, sdlVolume);
         }
 
-        auto properties = MIX_GetAudioProperties(state.audio.music);
+        auto properties = state.audio.metadata;
 
         std::string titleTag = std::string(SDL_GetStringProperty(properties, MIX_PROP_METADATA_TITLE_STRING, "Unknown"));
         if (!Text::trim(titleTag).empty())
@@ -272,12 +299,8 @@ void PreviewWindow::RenderAudioPlayer() {
         if (!Text::trim(copyrightTag).empty())
             SelectableCopyableText("Copyright: " + copyrightTag);
 
-        SDL_AudioSpec spec = {
-            .format = SDL_AUDIO_S16,
-            .channels = 2,
-            .freq = 44100,
-        };
-        if (MIX_GetAudioFormat(state.audio.music, &spec)) {
+        const SDL_AudioSpec &spec = state.audio.spec;
+        if (spec.freq > 0) {
             ImGui::Text("Sample Rate: %d kHz", spec.freq / 1000);
             // If there are more than 2 channels, this will report as stereo
             // eventually i'll do something about this but im lazy :)
@@ -329,6 +352,33 @@ void PreviewWindow::RenderTextViewer(ImGuiIO &io) {
     int *encoding = (int*)&state.contents.encoding;
     ImGui::Combo("##EncodingCombo", encoding, encodings, SIZEOF_ARRAY(encodings));
 
+    if (!state.contents.editing) {
+        ImGui::SameLine();
+        if (ImGui::Button("Edit")) {
+            TextConverter::SetCurrentEncoding(encodings[state.contents.encoding]);
+            auto text = std::string((char*)state.contents.data, state.contents.size);
+            editor.SetText(TextConverter::convert_to_utf8(text));
+            editor.SetTextChanged(false);
+            state.contents.editing = true;
+        }
+    }
+
+    if (!state.contents.editing) {
+        TextView *&view = state.contents.textView;
+        if (view && view->Encoding() != state.contents.encoding) {
+            delete view;
+            view = nullptr;
+        }
+        if (!view) {
+            view = new TextView(state.contents.data, state.contents.size, state.contents.encoding);
+        }
+        if (!view->Indexed()) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("Indexing lines...");
+        }
+        view->Render("TextView");
+        return;
+    }
 
     if (currentEncoding != encodings[state.contents.encoding]) {
         TextConverter::SetCurrentEncoding(encodings[state.contents.encoding]);
@@ -367,9 +417,7 @@ void PreviewWindow::RenderHexEditor(ImGuiIO &io) {
     PreviewWinState &state = GetPreviewState(preview_index);
     if (ImGui::Button("Text View")) {
         state.contents.type = ContentType::TEXT;
-        // don't like that I have to do this here, but whatever
-        editor.SetText(std::string((char*)state.contents.data, state.contents.size));
-        editor.SetTextChanged(false);
+        state.contents.editing = false;
         text_viewer_override = true;
     }
     auto pos = font_registry.find("MonoFont");
@@ -388,9 +436,7 @@ void PreviewWindow::RenderMarkdownEditor(ImGuiIO &io) {
     PreviewWinState &state = GetPreviewState(preview_index);
     if (ImGui::Button("Text View")) {
         state.contents.type = ContentType::TEXT;
-        // don't like that I have to do this here, but whatever
-        editor.SetText(std::string((char*)state.contents.data, state.contents.size));
-        editor.SetTextChanged(false);
+        state.contents.editing = false;
         text_viewer_override = true;
     }
     markdown((const char*)state.contents.data, (const char*)state.contents.data + state.contents.size);
@@ -7,6 +7,7 @@
 
 namespace PreviewWindow {
     inline float timeToSetOnRelease = 0.0f;
+    inline bool showSpectrogram = false;
     void RenderImagePreview();
     void RenderGifPreview();
     void RenderAudioPlayer();
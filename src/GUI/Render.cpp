@@ -4,6 +4,7 @@
 #include <Markdown.h>
 #include <PreviewWindow.h>
 #include <Themes.h>
+#include <Thumbnails.h>
 #include <UIError.h>
 #include "SDK/util/rd_log.h"
 #include "SDK/util/rd_log_schema.h"
@@ -460,6 +461,7 @@ void GUI::StartRenderLoop() {
         ImGui::NewFrame();
 
         DirectoryNode::ProcessPendingFileLoads();
+        Thumbnails::Update();
 
         // ImGui::ShowDemoWindow(&running);
 
@@ -510,7 +512,8 @@ void GUI::StartRenderLoop() {
             PreviewContextMenu();
 
             if (preview_index == i && last_preview_index != preview_index) {
-                if ((state.contents.type == TEXT || state.contents.type == MARKDOWN) &&
+                // The editor is shared between tabs, only one that's being edited needs its text back.
+                if (state.contents.type == TEXT && state.contents.editing &&
                     state.contents.data && state.contents.size > 0) {
                     editor.SetText(std::string((char*)state.contents.data, state.contents.size));
                     editor.SetTextChanged(false);
@@ -586,7 +589,8 @@ void GUI::StartRenderLoop() {
 
     PreviewWinState &state = GetPreviewState(preview_index);
 
-    MIX_DestroyAudio(state.audio.music);
+    // Closes the stream the track is reading.
+    MIX_SetTrackAudio(state.audio.track, nullptr);
 
     SDL_DestroyWindow(window);
     SDL_RemoveTimer(state.audio.update_timer);
@@ -0,0 +1,309 @@
+#include <TextView.h>
+#include <imgui.h>
+#include <imgui_internal.h>
+#include <util/Text.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+
+#include "state.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RD_TEXTVIEW_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RD_TEXTVIEW_NEON
+#endif
+
+// Scanning this much takes well under a frame, anything bigger is indexed on a worker.
+constexpr usize SyncIndexBytes = 1 << 20;
+// The worker publishes the rows it found after every block.
+constexpr usize IndexBlockBytes = 4 << 20;
+constexpr int TabSize = 4;
+
+// Calls `found` with the offset of every '\n' in [begin, end).
+template <typename Found>
+static void FindNewlines(const u8 *data, usize begin, usize end, Found &&found) {
+    usize i = begin;
+#if defined(RD_TEXTVIEW_SSE2)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= end; i += 16) {
+        u32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), newline));
+        while (mask) {
+            found(i + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+#elif defined(RD_TEXTVIEW_NEON)
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    for (; i + 16 <= end; i += 16) {
+        const uint8x16_t equal = vceqq_u8(vld1q_u8(data + i), newline);
+        // Narrowed to four bits per byte, NEON has no movemask.
+        u64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+        while (mask) {
+            const int bit = std::countr_zero(mask);
+            found(i + bit / 4);
+            mask &= ~(0xFull << bit);
+        }
+    }
+#endif
+    while (i < end) {
+        const u8 *newline = (const u8*)memchr(data + i, '\n', end - i);
+        if (!newline) break;
+        found(newline - data);
+        i = newline - data + 1;
+    }
+}
+
+TextView::TextView(const u8 *data, usize size, ContentEncoding encoding) : data(data), size(size), encoding(encoding) {
+    if (size <= SyncIndexBytes) {
+        BuildIndex();
+    } else {
+        worker = std::thread(&TextView::BuildIndex, this);
+    }
+}
+
+TextView::~TextView() {
+    cancel = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+// Rows have to start on a character, a cut in the middle of one would garble both rows.
+u64 TextView::SplitPoint(u64 start, u64 limit) const {
+    if (encoding == UTF16) {
+        u64 point = start + ((limit - start) & ~1ull);
+        // Keep surrogate pairs together.
+        if (point - start > 2 && point + 1 < size && data[point + 1] >= 0xDC && data[point + 1] <= 0xDF) {
+            point -= 2;
+        }
+        return point;
+    }
+    if (encoding == SHIFT_JIS) {
+        // Trail bytes look like anything, the only way to tell is to walk from the start.
+        u64 point = start;
+        while (point < limit) {
+            const u8 c = data[point];
+            const u64 length = (c >= 0x81 && c <= 0x9F) || (c >= 0xE0 && c <= 0xFC) ? 2 : 1;
+            if (point + length > limit) break;
+            point += length;
+        }
+        return point;
+    }
+    u64 point = limit;
+    while (point > start + 1 && (data[point] & 0xC0) == 0x80) {
+        point--;
+    }
+    return point;
+}
+
+void TextView::AddLine(u64 start, u64 next, Index &out) {
+    auto add = [&](u64 row) {
+        out.rows.push_back(row);
+        if ((out.rows.size() - 1) % LineCheckpointRows == 0) {
+            out.line_checkpoints.push_back(out.lines - 1);
+        }
+    };
+    out.lines++;
+    add(start);
+    while (next - start > MaxRowBytes) {
+        start = SplitPoint(start, start + MaxRowBytes);
+        add(start | Continuation);
+    }
+}
+
+// Finds where the lines in [begin, end) end, the one starting at `line_start` first.
+void TextView::IndexRange(usize begin, usize end, u64 *line_start, Index &out) {
+    std::vector<u64> next_lines;
+    if (encoding == UTF16) {
+        FindNewlines(data, begin, end, [&](usize at) {
+            if (at % 2 == 0 && at + 1 < size && data[at + 1] == 0) {
+                next_lines.push_back(at + 2);
+            }
+        });
+    } else {
+        FindNewlines(data, begin, end, [&](usize at) { next_lines.push_back(at + 1); });
+    }
+
+    std::lock_guard lock(mutex);
+    for (u64 next : next_lines) {
+        AddLine(*line_start, next, out);
+        *line_start = next;
+    }
+    out.next_start = *line_start;
+}
+
+void TextView::BuildIndex() {
+    u64 line_start = 0;
+    for (usize begin = 0; begin < size; begin += IndexBlockBytes) {
+        if (cancel) return;
+        IndexRange(begin, std::min(size, begin + IndexBlockBytes), &line_start, index);
+    }
+
+    std::lock_guard lock(mutex);
+    // Whatever follows the last newline is a line too, an empty one if the file ends with it.
+    AddLine(line_start, size, index);
+    index.next_start = size;
+    indexed.store(true, std::memory_order_release);
+}
+
+std::string TextView::DecodeRow(u64 start, u64 end, bool line_ends) const {
+    const u64 unit = encoding == UTF16 ? 2 : 1;
+    auto ends_with = [&](char c) {
+        return end - start >= unit && data[end - unit] == c && (unit == 1 || data[end - 1] == 0);
+    };
+    if (line_ends && ends_with('\n')) {
+        end -= unit;
+        if (ends_with('\r')) end -= unit;
+    }
+    if (start == 0) {
+        if (encoding == UTF8 && end >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) start = 3;
+        if (encoding == UTF16 && end >= 2 && data[0] == 0xFF && data[1] == 0xFE) start = 2;
+    }
+
+    std::string text((const char*)data + start, end - start);
+    if (encoding == UTF16) return TextConverter::UTF16LEToUTF8(text);
+    if (encoding == SHIFT_JIS) return TextConverter::ShiftJISToUTF8(text);
+    return text;
+}
+
+// ImGui has no tab stops and stops drawing at a NUL, so tabs are spaced out like TextEditor does and other control
+// characters become spaces.
+static std::string ForDisplay(const std::string &text) {
+    std::string display;
+    display.reserve(text.size());
+    int column = 0;
+    for (char c : text) {
+        if (c == '\t') {
+            display.append(TabSize - column % TabSize, ' ');
+            column += TabSize - column % TabSize;
+            continue;
+        }
+        display.push_back((u8)c < 0x20 || c == 0x7F ? ' ' : c);
+        // Only the first byte of a UTF-8 sequence is a column.
+        column += ((u8)c & 0xC0) != 0x80;
+    }
+    return display;
+}
+
+std::string TextView::CopyRows(usize first, usize last) {
+    std::vector<u64> rows;
+    u64 next_start;
+    {
+        std::lock_guard lock(mutex);
+        last = std::min(last, index.rows.size() - 1);
+        rows.assign(index.rows.begin() + first, index.rows.begin() + last + 1);
+        next_start = last + 1 < index.rows.size() ? index.rows[last + 1] : index.next_start;
+    }
+    rows.push_back(next_start);
+
+    std::string text;
+    for (usize i = 0; i + 1 < rows.size(); ++i) {
+        const bool line_ends = !(rows[i + 1] & Continuation);
+        text += DecodeRow(rows[i] & ~Continuation, rows[i + 1] & ~Continuation, line_ends);
+        if (line_ends && i + 2 < rows.size()) text += '\n';
+    }
+    return text;
+}
+
+void TextView::Render(const char *id) {
+    ImGui::BeginChild(id, {0, 0}, false, ImGuiWindowFlags_HorizontalScrollbar);
+
+    usize row_count;
+    u64 lines;
+    {
+        std::lock_guard lock(mutex);
+        row_count = index.rows.size();
+        lines = index.lines;
+    }
+
+    const float line_height = ImGui::GetTextLineHeightWithSpacing();
+    char number[32];
+    const int digits = snprintf(number, sizeof(number), "%llu", (unsigned long long)std::max<u64>(lines, 1));
+    const float gutter = ImGui::CalcTextSize("0").x * (digits + 2);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+
+    // Selection is by whole rows: click, shift click or drag, then Ctrl+C.
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    const i64 mouse_row = std::clamp<i64>((i64)std::floor((mouse.y - origin.y) / line_height), 0, std::max<i64>((i64)row_count - 1, 0));
+    if (row_count > 0 && ImGui::IsWindowHovered() && ImGui::GetCurrentWindow()->InnerClipRect.Contains(mouse) && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+        if (!ImGui::GetIO().KeyShift || selection_anchor < 0) {
+            selection_anchor = mouse_row;
+        }
+        selection_end = mouse_row;
+        dragging = true;
+    } else if (dragging && ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+        selection_end = mouse_row;
+    } else {
+        dragging = false;
+    }
+    const i64 selected_first = std::min(selection_anchor, selection_end);
+    const i64 selected_last = std::max(selection_anchor, selection_end);
+    if (selection_anchor >= 0 && ImGui::IsWindowFocused() && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_C)) {
+        ImGui::SetClipboardText(CopyRows(selected_first, selected_last).c_str());
+    }
+
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    const ImU32 number_color = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+    const ImU32 selection_color = ImGui::GetColorU32(ImGuiCol_TextSelectedBg);
+    const float row_width = std::max(ImGui::GetWindowWidth() + ImGui::GetScrollX(), max_width);
+
+    std::vector<std::pair<usize, std::string>> decoded;
+    std::vector<u64> rows;
+    ImGuiListClipper clipper;
+    clipper.Begin((int)row_count, line_height);
+    while (clipper.Step()) {
+        const usize first = clipper.DisplayStart, last = clipper.DisplayEnd;
+        if (first >= last) continue;
+
+        u64 line;
+        {
+            std::lock_guard lock(mutex);
+            rows.assign(index.rows.begin() + first, index.rows.begin() + last);
+            rows.push_back(last < index.rows.size() ? index.rows[last] : index.next_start);
+            // Counted on from the closest checkpoint, line numbers start at 1 on screen.
+            const usize checkpoint = first / LineCheckpointRows;
+            line = index.line_checkpoints[checkpoint];
+            for (usize row = checkpoint * LineCheckpointRows + 1; row <= first; ++row) {
+                line += !(index.rows[row] & Continuation);
+            }
+        }
+
+        for (usize row = first; row < last; ++row) {
+            const u64 start = rows[row - first];
+            const u64 next = rows[row - first + 1];
+            if (row != first && !(start & Continuation)) line++;
+
+            auto cached = std::lower_bound(cached_rows.begin(), cached_rows.end(), row, [](const auto &entry, usize row) {
+                return entry.first < row;
+            });
+            std::string text = cached != cached_rows.end() && cached->first == row
+                ? std::move(cached->second)
+                : ForDisplay(DecodeRow(start & ~Continuation, next & ~Continuation, !(next & Continuation)));
+
+            const ImVec2 pos = ImGui::GetCursorScreenPos();
+            if ((i64)row >= selected_first && (i64)row <= selected_last) {
+                draw_list->AddRectFilled(pos, {pos.x + row_width, pos.y + line_height}, selection_color);
+            }
+            if (!(start & Continuation)) {
+                const int length = snprintf(number, sizeof(number), "%*llu", digits, (unsigned long long)line + 1);
+                draw_list->AddText(pos, number_color, number, number + length);
+            }
+            ImGui::SetCursorScreenPos({pos.x + gutter, pos.y});
+            ImGui::TextUnformatted(text.data(), text.data() + text.size());
+            max_width = std::max(max_width, ImGui::GetItemRectMax().x - origin.x);
+            decoded.emplace_back(row, std::move(text));
+        }
+    }
+    // Keeps the horizontal scroll range from jumping around with whatever rows are on screen.
+    ImGui::Dummy({max_width, 0.0f});
+
+    std::sort(decoded.begin(), decoded.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    cached_rows = std::move(decoded);
+    ImGui::EndChild();
+}
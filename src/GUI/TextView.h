@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <util/int.h>
+
+enum ContentEncoding : int;
+
+// Read only view of a text file that doesn't copy it. Where the rows start is found by a SIMD scan for newlines, on a
+// worker for large files, and only the rows on screen are decoded and laid out. Lines longer than MaxRowBytes are
+// wrapped into several rows so a minified file still scrolls. The TextEditor is only needed once the text gets edited.
+class TextView {
+public:
+    static constexpr usize MaxRowBytes = 4096;
+
+    // `data` isn't copied and has to outlive the view.
+    TextView(const u8 *data, usize size, ContentEncoding encoding);
+    ~TextView();
+    TextView(const TextView&) = delete;
+    TextView &operator=(const TextView&) = delete;
+
+    ContentEncoding Encoding() const { return encoding; }
+    bool Indexed() const { return indexed.load(std::memory_order_acquire); }
+
+    void Render(const char *id);
+
+private:
+    // Set on rows that continue a line wrapped at MaxRowBytes, they don't get a line number.
+    static constexpr u64 Continuation = 1ull << 63;
+    // Every this many rows the line number of the row is kept, so line numbers don't need a counter per row.
+    static constexpr usize LineCheckpointRows = 1024;
+
+    struct Index {
+        // Offsets of the rows, with Continuation set on those that don't start a line.
+        std::vector<u64> rows;
+        // Line number of every LineCheckpointRows-th row.
+        std::vector<u64> line_checkpoints;
+        u64 lines = 0;
+        // Where the row after the last one starts, the end of the last row.
+        u64 next_start = 0;
+    };
+
+    void BuildIndex();
+    void IndexRange(usize begin, usize end, u64 *line_start, Index &out);
+    void AddLine(u64 start, u64 next, Index &out);
+    u64 SplitPoint(u64 start, u64 limit) const;
+    std::string DecodeRow(u64 start, u64 end, bool line_ends) const;
+    std::string CopyRows(usize first, usize last);
+
+    const u8 *data;
+    usize size;
+    ContentEncoding encoding;
+    std::atomic<bool> indexed = false;
+    std::atomic<bool> cancel = false;
+    std::thread worker;
+
+    // Guards `index`, which the worker adds to as it scans a large file.
+    std::mutex mutex;
+    Index index;
+
+    // Rows decoded for the last frame, sorted by row.
+    std::vector<std::pair<usize, std::string>> cached_rows;
+    float max_width = 0.0f;
+    // Selected rows, by the row the selection started at and the one it extends to.
+    i64 selection_anchor = -1;
+    i64 selection_end = -1;
+    bool dragging = false;
+};
@@ -0,0 +1,439 @@
+#include <Thumbnails.h>
+#include <DirectoryNode.h>
+#include <Image.h>
+#include <ArchiveFormats/ArchiveFormat.h>
+#include <SDK/util/Logger.hpp>
+#include <util/BufferPool.h>
+#include <zero_templates.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Textures kept around for thumbnails that scrolled out of view, about a thousand of them at full size.
+constexpr usize MemoryBudget = 64 << 20;
+// Uploads are cheap at this size, but opening a cached folder can finish hundreds in one go.
+constexpr usize UploadsPerFrame = 32;
+// Anything bigger isn't worth reading in full for a thumbnail.
+constexpr u64 MaxSourceSize = 256ull << 20;
+// Bytes at either end of an archive that go into its identity, on top of its path, size and modification time.
+constexpr usize ArchiveSampleSize = 64 << 10;
+
+// FNV-1a, only has to tell files apart.
+static u64 HashBytes(const void *data, usize size, u64 hash = 0xCBF29CE484222325ull) {
+    for (usize i = 0; i < size; ++i) {
+        hash ^= ((const u8*)data)[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static u64 HashString(const std::string &str, u64 hash) {
+    // The length keeps ("ab", "c") and ("a", "bc") apart.
+    u64 size = str.size();
+    hash = HashBytes(&size, sizeof(size), hash);
+    return HashBytes(str.data(), str.size(), hash);
+}
+
+static std::string NormalizePath(std::string path) {
+    std::replace(path.begin(), path.end(), '\\', '/');
+    return path;
+}
+
+namespace {
+    struct Job {
+        u64 key;
+        // Empty for archive entries.
+        std::string path;
+        const Entry *entry = nullptr;
+    };
+
+    struct Finished {
+        u64 key;
+        // Null if the source couldn't be decoded.
+        SDL_Surface *surface;
+    };
+
+    struct Texture {
+        u64 key;
+        GLuint id;
+        Vec2<int> size;
+        usize bytes;
+    };
+
+    struct NodeInfo {
+        std::string path;
+        // 0 if the node has nothing to show.
+        u64 key;
+        const Entry *entry;
+    };
+
+    // Shared with the workers.
+    struct Pool {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable archive_idle;
+        std::deque<Job> pending;
+        std::unordered_set<u64> running;
+        std::vector<Finished> finished;
+        std::vector<std::thread> workers;
+        bool stop = false;
+
+        ArchiveBase *archive = nullptr;
+        u8 *buffer = nullptr;
+        usize archive_jobs = 0;
+
+        // Workers use the shared buffer pool, it has to outlive them.
+        Pool() {
+            BufferPool::Shared();
+        }
+
+        ~Pool() {
+            {
+                std::lock_guard lock(mutex);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto &worker : workers) {
+                worker.join();
+            }
+            for (auto &done : finished) {
+                SDL_DestroySurface(done.surface);
+            }
+        }
+    };
+
+    // UI thread only.
+    struct Cache {
+        std::list<Texture> lru;
+        std::unordered_map<u64, std::list<Texture>::iterator> textures;
+        usize bytes = 0;
+        std::unordered_set<u64> failed;
+        std::deque<Finished> uploads;
+        std::unordered_set<u64> uploading;
+
+        std::vector<Job> requests;
+        std::unordered_set<u64> requested;
+        std::unordered_map<const DirectoryNode::Node*, NodeInfo> nodes;
+
+        std::string archive_path;
+        u64 archive_id = 0;
+        std::unordered_map<std::string, const Entry*> entries;
+    };
+}
+
+static Pool pool;
+static Cache cache;
+
+static fs::path CachePath(u64 key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.png", (unsigned long long)key);
+    return fs::path(".cache") / "thumbnails" / name;
+}
+
+static SDL_Surface *ToRGBA(SDL_Surface *surface) {
+    if (!surface || surface->format == SDL_PIXELFORMAT_RGBA32) {
+        return surface;
+    }
+    SDL_Surface *converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+    SDL_DestroySurface(surface);
+    return converted;
+}
+
+// Box filter down to fit in Size x Size. Colour is weighted by alpha, so transparent pixels don't darken the edges.
+static SDL_Surface *Shrink(SDL_Surface *image) {
+    if (image->w <= Thumbnails::Size && image->h <= Thumbnails::Size) {
+        return image;
+    }
+    const double scale = (double)Thumbnails::Size / std::max(image->w, image->h);
+    const int width = std::max(1, (int)(image->w * scale + 0.5));
+    const int height = std::max(1, (int)(image->h * scale + 0.5));
+
+    SDL_Surface *thumb = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    if (!thumb) {
+        SDL_DestroySurface(image);
+        return nullptr;
+    }
+
+    std::vector<u64> sums((usize)width * 4);
+    for (int y = 0; y < height; ++y) {
+        const int y0 = (int)((i64)y * image->h / height);
+        const int y1 = std::max(y0 + 1, (int)((i64)(y + 1) * image->h / height));
+        std::fill(sums.begin(), sums.end(), 0);
+        for (int sy = y0; sy < y1; ++sy) {
+            const u8 *row = (const u8*)image->pixels + (usize)sy * image->pitch;
+            for (int x = 0; x < width; ++x) {
+                const int x0 = (int)((i64)x * image->w / width);
+                const int x1 = std::max(x0 + 1, (int)((i64)(x + 1) * image->w / width));
+                u64 *sum = &sums[(usize)x * 4];
+                for (int sx = x0; sx < x1; ++sx) {
+                    const u8 *pixel = row + (usize)sx * 4;
+                    sum[0] += pixel[0] * pixel[3];
+                    sum[1] += pixel[1] * pixel[3];
+                    sum[2] += pixel[2] * pixel[3];
+                    sum[3] += pixel[3];
+                }
+            }
+        }
+
+        u8 *out = (u8*)thumb->pixels + (usize)y * thumb->pitch;
+        for (int x = 0; x < width; ++x) {
+            const int x0 = (int)((i64)x * image->w / width);
+            const int x1 = std::max(x0 + 1, (int)((i64)(x + 1) * image->w / width));
+            const u64 area = (u64)(x1 - x0) * (y1 - y0);
+            const u64 *sum = &sums[(usize)x * 4];
+            for (int c = 0; c < 3; ++c) {
+                out[x * 4 + c] = sum[3] ? (u8)((sum[c] + sum[3] / 2) / sum[3]) : 0;
+            }
+            out[x * 4 + 3] = (u8)((sum[3] + area / 2) / area);
+        }
+    }
+
+    SDL_DestroySurface(image);
+    return thumb;
+}
+
+static SDL_Surface *Generate(const Job &job, ArchiveBase *archive, u8 *buffer) {
+    const fs::path cache_path = CachePath(job.key);
+    std::error_code ec;
+    if (fs::exists(cache_path, ec)) {
+        if (SDL_Surface *cached = ToRGBA(IMG_Load(cache_path.string().c_str()))) {
+            return cached;
+        }
+        Logger::error("Ignoring unreadable thumbnail {}", cache_path.string());
+    }
+
+    u8 *data = nullptr;
+    usize size = 0;
+    bool pooled = false;
+    if (job.entry) {
+        if (!archive || job.entry->size > MaxSourceSize) return nullptr;
+        size = job.entry->size;
+
+        // Shared with the preview loader, extraction and audio streaming.
+        auto stream_lock = archive->LockStreams();
+        BufferPool &buffers = BufferPool::Shared();
+        data = (u8*)buffers.Allocate(size);
+        pooled = data && archive->ReadRange(job.entry, buffer, 0, data, size) == size;
+        if (!pooled) {
+            buffers.Deallocate(data, size);
+            data = archive->OpenStream(job.entry, buffer);
+        }
+    } else {
+        if (fs::file_size(job.path, ec) > MaxSourceSize || ec) return nullptr;
+        auto [file, file_size] = read_file_to_buffer<u8>(job.path.c_str());
+        data = file;
+        size = file_size > 0 ? file_size : 0;
+    }
+    if (!data) return nullptr;
+
+    SDL_Surface *image = Image::DecodeImage(data, size);
+    if (pooled) BufferPool::Shared().Deallocate(data, size);
+    else free(data);
+    if (!image) return nullptr;
+
+    SDL_Surface *thumb = Shrink(image);
+    if (!thumb) return nullptr;
+
+    // Written under a temporary name first, so a cached thumbnail is either complete or absent.
+    fs::path temp_path = fs::path(cache_path).concat(".tmp");
+    fs::create_directories(cache_path.parent_path(), ec);
+    if (!ec && IMG_SavePNG(thumb, temp_path.string().c_str())) {
+        fs::rename(temp_path, cache_path, ec);
+    }
+    if (ec) {
+        fs::remove(temp_path, ec);
+    }
+    return thumb;
+}
+
+static void Worker(usize thread_count) {
+    ArchiveBase::stream_workers = thread_count;
+    std::unique_lock lock(pool.mutex);
+    while (true) {
+        pool.wake.wait(lock, []() { return pool.stop || !pool.pending.empty(); });
+        if (pool.stop) return;
+
+        Job job = std::move(pool.pending.front());
+        pool.pending.pop_front();
+        pool.running.insert(job.key);
+        ArchiveBase *archive = job.entry ? pool.archive : nullptr;
+        u8 *buffer = pool.buffer;
+        if (job.entry) pool.archive_jobs++;
+        lock.unlock();
+
+        SDL_Surface *thumb = Generate(job, archive, buffer);
+
+        lock.lock();
+        pool.running.erase(job.key);
+        pool.finished.push_back({job.key, thumb});
+        if (job.entry && --pool.archive_jobs == 0) {
+            pool.archive_idle.notify_all();
+        }
+    }
+}
+
+bool Thumbnails::HasThumbnail(const DirectoryNode::Node *node) {
+    if (node->IsDirectory) return false;
+    const std::string &name = node->FileName;
+    std::string ext = name.substr(name.find_last_of('.') + 1);
+    return Image::IsImageExtension(ext) || Image::IsGif(ext);
+}
+
+static const NodeInfo &GetNodeInfo(const DirectoryNode::Node *node) {
+    auto it = cache.nodes.find(node);
+    // Nodes get freed and their addresses reused, the path tells whether it's still the same one.
+    if (it != cache.nodes.end() && it->second.path == node->FullPath) {
+        return it->second;
+    }
+
+    NodeInfo info = { node->FullPath, 0, nullptr };
+    const std::string &path = cache.archive_path;
+    if (!path.empty() && node->FullPath.size() > path.size() + 1 && node->FullPath.starts_with(path)) {
+        auto entry = cache.entries.find(NormalizePath(node->FullPath.substr(path.size() + 1)));
+        if (entry != cache.entries.end()) {
+            info.entry = entry->second;
+            u64 key = HashString(info.entry->name, cache.archive_id);
+            key = HashBytes(&info.entry->offset, sizeof(info.entry->offset), key);
+            info.key = HashBytes(&info.entry->size, sizeof(info.entry->size), key);
+        }
+    } else {
+        u64 key = HashString(node->FullPath, 0xCBF29CE484222325ull);
+        key = HashBytes(&node->FileSizeBytes, sizeof(node->FileSizeBytes), key);
+        info.key = HashBytes(&node->LastModifiedUnix, sizeof(node->LastModifiedUnix), key);
+    }
+    return cache.nodes.insert_or_assign(node, std::move(info)).first->second;
+}
+
+GLuint Thumbnails::Request(const DirectoryNode::Node *node, Vec2<int> *size) {
+    const NodeInfo &info = GetNodeInfo(node);
+    if (info.key == 0) return 0;
+
+    auto it = cache.textures.find(info.key);
+    if (it != cache.textures.end()) {
+        cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+        if (size) *size = it->second->size;
+        return it->second->id;
+    }
+
+    if (!cache.failed.contains(info.key) && !cache.uploading.contains(info.key) && cache.requested.insert(info.key).second) {
+        cache.requests.push_back({ info.key, info.entry ? std::string() : node->FullPath, info.entry });
+    }
+    return 0;
+}
+
+static void Upload(const Finished &done) {
+    if (!done.surface) {
+        cache.failed.insert(done.key);
+        return;
+    }
+
+    Texture texture = { done.key, 0, Vec2<int>(0, 0), (usize)done.surface->w * done.surface->h * 4 };
+    texture.id = Image::UploadImage(done.surface, Vec2<int*>(&texture.size.x, &texture.size.y));
+    SDL_DestroySurface(done.surface);
+
+    cache.lru.push_front(texture);
+    cache.textures[done.key] = cache.lru.begin();
+    cache.bytes += texture.bytes;
+
+    while (cache.bytes > MemoryBudget && cache.lru.size() > 1) {
+        Texture &oldest = cache.lru.back();
+        Image::UnloadTexture(oldest.id);
+        cache.bytes -= oldest.bytes;
+        cache.textures.erase(oldest.key);
+        cache.lru.pop_back();
+    }
+}
+
+void Thumbnails::Update() {
+    if (!cache.requests.empty() && pool.workers.empty()) {
+        // One core stays free for the UI thread and the preview loader.
+        usize thread_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (usize i = 0; i < thread_count; ++i) {
+            pool.workers.emplace_back(Worker, thread_count);
+        }
+    }
+
+    bool queued;
+    {
+        std::lock_guard lock(pool.mutex);
+        for (Finished &done : pool.finished) {
+            cache.uploads.push_back(done);
+            cache.uploading.insert(done.key);
+        }
+        pool.finished.clear();
+
+        // Whatever wasn't requested again has scrolled out of view.
+        pool.pending.clear();
+        for (Job &job : cache.requests) {
+            if (!pool.running.contains(job.key) && !cache.uploading.contains(job.key) && (!job.entry || pool.archive)) {
+                pool.pending.push_back(std::move(job));
+            }
+        }
+        queued = !pool.pending.empty();
+    }
+    if (queued) {
+        pool.wake.notify_all();
+    }
+    cache.requests.clear();
+    cache.requested.clear();
+
+    for (usize i = 0; i < UploadsPerFrame && !cache.uploads.empty(); ++i) {
+        Upload(cache.uploads.front());
+        cache.uploading.erase(cache.uploads.front().key);
+        cache.uploads.pop_front();
+    }
+}
+
+void Thumbnails::OpenArchive(ArchiveBase *archive, u8 *buffer, usize size, const std::string &path) {
+    CloseArchive();
+
+    // Identifies the archive without hashing all of it. An archive that isn't on disk (one opened from inside another
+    // archive) has no modification time, the samples still tell apart different archives under the same name.
+    std::error_code ec;
+    u64 modified = (u64)fs::last_write_time(path, ec).time_since_epoch().count();
+    if (ec) modified = 0;
+    u64 id = HashString(path, 0xCBF29CE484222325ull);
+    id = HashBytes(&size, sizeof(size), id);
+    id = HashBytes(&modified, sizeof(modified), id);
+    const usize sample = std::min(size, ArchiveSampleSize);
+    id = HashBytes(buffer, sample, id);
+    id = HashBytes(buffer + size - sample, sample, id);
+
+    cache.archive_path = path;
+    cache.archive_id = id;
+    for (auto &[name, entry] : archive->GetEntries()) {
+        cache.entries.emplace(NormalizePath(entry->name), entry);
+    }
+
+    std::lock_guard lock(pool.mutex);
+    pool.archive = archive;
+    pool.buffer = buffer;
+}
+
+void Thumbnails::CloseArchive() {
+    {
+        std::unique_lock lock(pool.mutex);
+        std::erase_if(pool.pending, [](const Job &job) { return job.entry != nullptr; });
+        pool.archive_idle.wait(lock, []() { return pool.archive_jobs == 0; });
+        pool.archive = nullptr;
+        pool.buffer = nullptr;
+    }
+
+    std::erase_if(cache.requests, [](const Job &job) { return job.entry != nullptr; });
+    std::erase_if(cache.nodes, [](const auto &node) { return node.second.entry != nullptr; });
+    cache.entries.clear();
+    cache.archive_path.clear();
+    cache.archive_id = 0;
+}
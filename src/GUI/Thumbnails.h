@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <gl3.h>
+#include <util/int.h>
+#include <util/vec.h>
+
+class ArchiveBase;
+namespace DirectoryNode { struct Node; }
+
+// Thumbnails for the grid view. A pool of workers decodes and shrinks images in the order the UI asked for them, and
+// keeps the results in `.cache/thumbnails`, named after a hash of the file (or of the archive and entry) they came from.
+// Finished thumbnails are kept as textures in an LRU bounded by bytes.
+namespace Thumbnails {
+    constexpr int Size = 128;
+
+    bool HasThumbnail(const DirectoryNode::Node *node);
+
+    // Returns the node's thumbnail if it's ready and queues it otherwise. Requests are worked on in the order they were
+    // made, and a request that isn't repeated the next frame is dropped, so only what's on screen gets generated.
+    GLuint Request(const DirectoryNode::Node *node, Vec2<int> *size = nullptr);
+
+    // Hands the last frame's requests to the workers and uploads what they finished. UI thread only, once per frame.
+    void Update();
+
+    // Archive entries are read from the loaded archive, it has to be announced after opening and before destroying it.
+    void OpenArchive(ArchiveBase *archive, u8 *buffer, usize size, const std::string &path);
+    void CloseArchive();
+}
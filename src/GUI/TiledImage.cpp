@@ -0,0 +1,174 @@
+#include <TiledImage.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Up to 1 MiB each, enough to cover a 4K screen about twice over.
+constexpr usize MaxResidentTiles = 192;
+// A tile upload is a 1 MiB copy, a few per frame keeps panning smooth.
+constexpr int UploadsPerFrame = 8;
+// Above this the image is only drawn tile by tile anyway, and past it mipmaps matter more than sharing one texture.
+constexpr int MaxSingleTextureSize = 4096;
+
+bool TiledImage::NeedsTiling(int width, int height) {
+    static GLint max_texture_size = 0;
+    if (max_texture_size == 0) {
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    }
+    return std::max(width, height) > std::min<GLint>(max_texture_size, MaxSingleTextureSize);
+}
+
+TiledImage::TiledImage(SDL_Surface *image) : image(image) {
+    Level level = { image->w, image->h, image->pitch, (u8*)image->pixels };
+    levels.push_back(level);
+    while (std::max(level.width, level.height) > TileSize) {
+        level.width = (level.width + 1) / 2;
+        level.height = (level.height + 1) / 2;
+        level.pitch = level.width * 4;
+        level.pixels = nullptr;
+        levels.push_back(level);
+    }
+
+    if (levels.size() > 1) {
+        worker = std::thread(&TiledImage::BuildLevels, this);
+    }
+}
+
+TiledImage::~TiledImage() {
+    cancel = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (auto &[key, tile] : tiles) {
+        glDeleteTextures(1, &tile.texture);
+    }
+    for (usize i = 1; i < levels.size(); ++i) {
+        free(levels[i].pixels);
+    }
+    SDL_DestroySurface(image);
+}
+
+// Plain 2x2 box filter like glGenerateMipmap, the last row or column is repeated for odd sizes.
+void TiledImage::BuildLevels() {
+    for (usize i = 1; i < levels.size(); ++i) {
+        const Level &src = levels[i - 1];
+        Level &dst = levels[i];
+        dst.pixels = (u8*)malloc((usize)dst.pitch * dst.height);
+        if (!dst.pixels) return;
+
+        for (int y = 0; y < dst.height; ++y) {
+            if (cancel) return;
+            const u8 *row0 = src.pixels + (usize)std::min(y * 2, src.height - 1) * src.pitch;
+            const u8 *row1 = src.pixels + (usize)std::min(y * 2 + 1, src.height - 1) * src.pitch;
+            u8 *out = dst.pixels + (usize)y * dst.pitch;
+            for (int x = 0; x < dst.width; ++x) {
+                const usize x0 = (usize)x * 8;
+                const usize x1 = (usize)std::min(x * 2 + 1, src.width - 1) * 4;
+                for (int c = 0; c < 4; ++c) {
+                    out[x * 4 + c] = (u8)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+        levels_ready.store(i + 1, std::memory_order_release);
+    }
+}
+
+GLuint TiledImage::GetTile(int level, int x, int y, bool upload) {
+    const u64 key = (u64)level << 48 | (u64)y << 24 | (u64)x;
+    auto it = tiles.find(key);
+    if (it != tiles.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru);
+        it->second.last_used = frame;
+        return it->second.texture;
+    }
+    if (!upload || uploads_left == 0) return 0;
+    uploads_left--;
+
+    const Level &source = levels[level];
+    const int width = std::min(TileSize, source.width - x * TileSize);
+    const int height = std::min(TileSize, source.height - y * TileSize);
+    const u8 *pixels = source.pixels + (usize)y * TileSize * source.pitch + (usize)x * TileSize * 4;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, source.pitch / 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    lru.push_front(key);
+    tiles[key] = { texture, frame, lru.begin() };
+    Evict();
+    return texture;
+}
+
+void TiledImage::Evict() {
+    while (tiles.size() > MaxResidentTiles) {
+        auto it = tiles.find(lru.back());
+        // Everything left is on screen right now.
+        if (it->second.last_used == frame) break;
+        glDeleteTextures(1, &it->second.texture);
+        tiles.erase(it);
+        lru.pop_back();
+    }
+}
+
+bool TiledImage::Draw(ImDrawList *draw_list, ImVec2 pos, float zoom) {
+    frame++;
+    uploads_left = UploadsPerFrame;
+
+    // The smallest level that still has at least one texel per screen pixel.
+    int level = 0;
+    while (level + 1 < (int)levels.size() && zoom * (1 << (level + 1)) <= 1.0f) {
+        level++;
+    }
+    const usize ready = levels_ready.load(std::memory_order_acquire);
+    level = std::min(level, (int)ready - 1);
+
+    const Level &source = levels[level];
+    // Screen pixels per texel of this level.
+    const float scale_x = (float)image->w / source.width * zoom;
+    const float scale_y = (float)image->h / source.height * zoom;
+
+    const ImVec2 clip_min = draw_list->GetClipRectMin();
+    const ImVec2 clip_max = draw_list->GetClipRectMax();
+    const int tiles_x = (source.width + TileSize - 1) / TileSize;
+    const int tiles_y = (source.height + TileSize - 1) / TileSize;
+    const int x0 = std::max(0, (int)std::floor((clip_min.x - pos.x) / scale_x / TileSize));
+    const int y0 = std::max(0, (int)std::floor((clip_min.y - pos.y) / scale_y / TileSize));
+    const int x1 = std::min(tiles_x - 1, (int)std::floor((clip_max.x - pos.x) / scale_x / TileSize));
+    const int y1 = std::min(tiles_y - 1, (int)std::floor((clip_max.y - pos.y) / scale_y / TileSize));
+    if (x1 < x0 || y1 < y0) return true;
+
+    // Zoomed out further than the levels built so far, this would need most of the full size image on the GPU.
+    if ((usize)(x1 - x0 + 1) * (y1 - y0 + 1) > MaxResidentTiles / 2) return false;
+
+    // Tiles that aren't uploaded yet are covered with the matching part of the smallest level meanwhile.
+    const int top = (int)levels.size() - 1;
+    // It's a single tile, so it goes up first.
+    const GLuint overview = level != top && ready == levels.size() ? GetTile(top, 0, 0, true) : 0;
+
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            const float tile_x0 = (float)x * TileSize, tile_y0 = (float)y * TileSize;
+            const float tile_x1 = (float)std::min((x + 1) * TileSize, source.width);
+            const float tile_y1 = (float)std::min((y + 1) * TileSize, source.height);
+            const ImVec2 p_min(std::floor(pos.x + tile_x0 * scale_x), std::floor(pos.y + tile_y0 * scale_y));
+            const ImVec2 p_max(std::floor(pos.x + tile_x1 * scale_x), std::floor(pos.y + tile_y1 * scale_y));
+
+            if (GLuint texture = GetTile(level, x, y, true)) {
+                draw_list->AddImage(texture, p_min, p_max);
+            } else if (overview) {
+                const ImVec2 uv_min(tile_x0 / source.width, tile_y0 / source.height);
+                const ImVec2 uv_max(tile_x1 / source.width, tile_y1 / source.height);
+                draw_list->AddImage(overview, p_min, p_max, uv_min, uv_max);
+            }
+        }
+    }
+    return true;
+}
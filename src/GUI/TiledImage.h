@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL.h>
+#include <gl3.h>
+#include <imgui.h>
+#include <util/int.h>
+
+// Previews images too big for one texture, or too big to zoom out of without mipmaps. The decoded image is cut into
+// tiles that are uploaded as they come into view, and a worker builds half size levels of it down to a single tile, so
+// a zoomed out view draws from the level closest to screen resolution. Tile textures live in an LRU capped at a
+// fixed count, only the tiles on screen are ever needed at once.
+class TiledImage {
+public:
+    static constexpr int TileSize = 512;
+
+    // Whether an image this size should be shown through a TiledImage rather than a single texture.
+    static bool NeedsTiling(int width, int height);
+
+    // Takes ownership of `image`, which must be RGBA32.
+    explicit TiledImage(SDL_Surface *image);
+    ~TiledImage();
+    TiledImage(const TiledImage&) = delete;
+    TiledImage &operator=(const TiledImage&) = delete;
+
+    int Width() const { return image->w; }
+    int Height() const { return image->h; }
+
+    // Draws the image scaled by `zoom` with its top left corner at `pos`, as far as it's inside the draw list's clip
+    // rect. Returns false if nothing could be drawn yet because the right level is still being built.
+    bool Draw(ImDrawList *draw_list, ImVec2 pos, float zoom);
+
+private:
+    struct Level {
+        int width;
+        int height;
+        int pitch;
+        u8 *pixels;
+    };
+
+    struct Tile {
+        GLuint texture;
+        u64 last_used;
+        std::list<u64>::iterator lru;
+    };
+
+    void BuildLevels();
+    // Returns the tile's texture, uploading it if there's upload budget left this frame. 0 if it isn't resident.
+    GLuint GetTile(int level, int x, int y, bool upload);
+    void Evict();
+
+    SDL_Surface *image;
+    // Level 0 is the image itself, every level after it half the size of the one before.
+    std::vector<Level> levels;
+    std::atomic<usize> levels_ready = 1;
+    std::atomic<bool> cancel = false;
+    std::thread worker;
+
+    std::unordered_map<u64, Tile> tiles;
+    std::list<u64> lru;
+    u64 frame = 0;
+    int uploads_left = 0;
+};
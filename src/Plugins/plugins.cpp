@@ -3,6 +3,7 @@
 #include <SDK/util/Logger.hpp>
 #include "../SDK/sdk.h"
 #include "../SDK/ArchiveFormatWrapper.h"
+#include <util/BufferPool.h>
 
 #include <string>
 #include <filesystem>
@@ -110,6 +111,10 @@ void Plugins::LoadPlugins(const char* path) {
         auto getArchiveFormat = reinterpret_cast<RD_GetArchiveFormat_t>(GetSym(handle, "RD_GetArchiveFormat"));
         auto name = reinterpret_cast<const char**>(GetSym(handle, "RD_PluginName"));
         auto version = reinterpret_cast<const char**>(GetSym(handle, "RD_PluginVersion"));
+        // Optional, plugins built before it existed speak ABI v1.
+        auto abi_version = reinterpret_cast<const u32*>(GetSym(handle, "RD_PluginABIVersion"));
+        // Optional as well, no capabilities means every call is made from one thread at a time.
+        auto capabilities = reinterpret_cast<const u32*>(GetSym(handle, "RD_PluginCapabilities"));
 
         if (!init || !shutdown || !getArchiveFormat || !name || !version) {
             Logger::error("Invalid plugin: {}", entry.path().string());
@@ -130,6 +135,14 @@ void Plugins::LoadPlugins(const char* path) {
         plugin.shutdown = shutdown;
         plugin.getArchiveFormat = getArchiveFormat;
         plugin.ctx = global_ctx;
+        plugin.abi_version = abi_version ? *abi_version : 1;
+        plugin.capabilities = capabilities ? *capabilities : 0;
+
+        if (plugin.abi_version > RD_ABI_VERSION) {
+            Logger::error("Plugin {} needs ABI v{}, this build only supports up to v{}", entry.path().string(), plugin.abi_version, RD_ABI_VERSION);
+            CloseLib(handle);
+            continue;
+        }
 
         static HostAPI host_api = {};
         host_api.get_sdk_context = []() -> sdk_ctx* { return global_ctx; };
@@ -149,6 +162,12 @@ void Plugins::LoadPlugins(const char* path) {
             }
         };
         host_api.log_fmtv = rd_log_fmtv;
+        host_api.allocate = [](usize size) -> void* {
+            return BufferPool::Shared().Allocate(size);
+        };
+        host_api.deallocate = [](void* ptr, usize size) {
+            BufferPool::Shared().Deallocate(ptr, size);
+        };
 
         if (!init(&host_api)) {
             Logger::error("Plugin {} failed to init", entry.path().string());
@@ -162,7 +181,7 @@ void Plugins::LoadPlugins(const char* path) {
 
         const ArchiveFormatVTable* vtable = getArchiveFormat(global_ctx);
         if (vtable) {
-            if (ArchiveFormatWrapper* wrapper = AddArchiveFormat(global_ctx, vtable)) {
+            if (ArchiveFormatWrapper* wrapper = AddArchiveFormat(global_ctx, vtable, plugin.abi_version, plugin.capabilities)) {
                 extractor_manager->RegisterFormat(std::unique_ptr<ArchiveFormatWrapper>(wrapper));
             } else {
                 Logger::error("Failed to create archive format wrapper!");
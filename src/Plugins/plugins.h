@@ -27,6 +27,8 @@ namespace Plugins {
         RD_PluginShutdown_t shutdown;
         RD_GetArchiveFormat_t getArchiveFormat;
         sdk_ctx *ctx;
+        u32 abi_version;
+        u32 capabilities;
     };
 
     static std::vector<Plugin> plugins;
@@ -0,0 +1,879 @@
+#include "BCDecode.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RD_BCDECODE_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RD_BCDECODE_NEON
+#endif
+
+namespace {
+    // Pixels per block side and bytes per decoded pixel.
+    constexpr u32 BlockDim = 4;
+    constexpr u32 Channels = 4;
+
+    // Below this many pixels starting threads costs more than it saves.
+    constexpr u64 ThreadedPixels = 512 * 512;
+    // Block rows a worker takes at a time.
+    constexpr u32 RowsPerBatch = 8;
+
+    // Partition tables shared by BC6H (first 32 entries) and BC7.
+    const u8 Partitions2[64][16] = {
+        {0,0,1,1,0,0,1,1,0,0,1,1,0,0,1,1}, {0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1},
+        {0,1,1,1,0,1,1,1,0,1,1,1,0,1,1,1}, {0,0,0,1,0,0,1,1,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,1,0,0,0,1,0,0,1,1}, {0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1},
+        {0,0,0,1,0,0,1,1,0,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,1,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1}, {0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,1},
+        {0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1},
+        {0,0,0,1,0,1,1,1,1,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1},
+        {0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1}, {0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1},
+        {0,0,0,0,1,0,0,0,1,1,1,0,1,1,1,1}, {0,1,1,1,0,0,0,1,0,0,0,0,0,0,0,0},
+        {0,0,0,0,0,0,0,0,1,0,0,0,1,1,1,0}, {0,1,1,1,0,0,1,1,0,0,0,1,0,0,0,0},
+        {0,0,1,1,0,0,0,1,0,0,0,0,0,0,0,0}, {0,0,0,0,1,0,0,0,1,1,0,0,1,1,1,0},
+        {0,0,0,0,0,0,0,0,1,0,0,0,1,1,0,0}, {0,1,1,1,0,0,1,1,0,0,1,1,0,0,0,1},
+        {0,0,1,1,0,0,0,1,0,0,0,1,0,0,0,0}, {0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0},
+        {0,1,1,0,0,1,1,0,0,1,1,0,0,1,1,0}, {0,0,1,1,0,1,1,0,0,1,1,0,1,1,0,0},
+        {0,0,0,1,0,1,1,1,1,1,1,0,1,0,0,0}, {0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0},
+        {0,1,1,1,0,0,0,1,1,0,0,0,1,1,1,0}, {0,0,1,1,1,0,0,1,1,0,0,1,1,1,0,0},
+        {0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1}, {0,0,0,0,1,1,1,1,0,0,0,0,1,1,1,1},
+        {0,1,0,1,1,0,1,0,0,1,0,1,1,0,1,0}, {0,0,1,1,0,0,1,1,1,1,0,0,1,1,0,0},
+        {0,0,1,1,1,1,0,0,0,0,1,1,1,1,0,0}, {0,1,0,1,0,1,0,1,1,0,1,0,1,0,1,0},
+        {0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1}, {0,1,0,1,1,0,1,0,1,0,1,0,0,1,0,1},
+        {0,1,1,1,0,0,1,1,1,1,0,0,1,1,1,0}, {0,0,0,1,0,0,1,1,1,1,0,0,1,0,0,0},
+        {0,0,1,1,0,0,1,0,0,1,0,0,1,1,0,0}, {0,0,1,1,1,0,1,1,1,1,0,1,1,1,0,0},
+        {0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0}, {0,0,1,1,1,1,0,0,1,1,0,0,0,0,1,1},
+        {0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1}, {0,0,0,0,0,1,1,0,0,1,1,0,0,0,0,0},
+        {0,1,0,0,1,1,1,0,0,1,0,0,0,0,0,0}, {0,0,1,0,0,1,1,1,0,0,1,0,0,0,0,0},
+        {0,0,0,0,0,0,1,0,0,1,1,1,0,0,1,0}, {0,0,0,0,0,1,0,0,1,1,1,0,0,1,0,0},
+        {0,1,1,0,1,1,0,0,1,0,0,1,0,0,1,1}, {0,0,1,1,0,1,1,0,1,1,0,0,1,0,0,1},
+        {0,1,1,0,0,0,1,1,1,0,0,1,1,1,0,0}, {0,0,1,1,1,0,0,1,1,1,0,0,0,1,1,0},
+        {0,1,1,0,1,1,0,0,1,1,0,0,1,0,0,1}, {0,1,1,0,0,0,1,1,0,0,1,1,1,0,0,1},
+        {0,1,1,1,1,1,1,0,1,0,0,0,0,0,0,1}, {0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,1},
+        {0,0,0,0,1,1,1,1,0,0,1,1,0,0,1,1}, {0,0,1,1,0,0,1,1,1,1,1,1,0,0,0,0},
+        {0,0,1,0,0,0,1,0,1,1,1,0,1,1,1,0}, {0,1,0,0,0,1,0,0,0,1,1,1,0,1,1,1},
+    };
+
+    const u8 Partitions3[64][16] = {
+        {0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2}, {0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1},
+        {0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1}, {0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2}, {0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2},
+        {0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1}, {0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1},
+        {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2},
+        {0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2}, {0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2},
+        {0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2}, {0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2},
+        {0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2}, {0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0},
+        {0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2}, {0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0},
+        {0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2}, {0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1},
+        {0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2}, {0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1},
+        {0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2}, {0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0},
+        {0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0}, {0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2},
+        {0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0}, {0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1},
+        {0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2}, {0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2},
+        {0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1}, {0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1},
+        {0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2}, {0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1},
+        {0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2}, {0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0},
+        {0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0}, {0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0},
+        {0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0}, {0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1},
+        {0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1}, {0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2},
+        {0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1}, {0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2},
+        {0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1}, {0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1},
+        {0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1}, {0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1},
+        {0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2}, {0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1},
+        {0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2}, {0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2},
+        {0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2}, {0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2},
+        {0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2},
+        {0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2}, {0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2},
+        {0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2}, {0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2},
+        {0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1}, {0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2},
+        {0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2}, {0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0},
+    };
+
+    // Pixels whose index is stored with one bit less, for the second subset of two and the second and third of three.
+    const u8 Anchors2[64] = {
+        15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+        15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+        15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+         6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+    };
+    const u8 Anchors3a[64] = {
+         3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,
+         3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+         8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,
+         3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3,
+    };
+    const u8 Anchors3b[64] = {
+        15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8,
+        15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+        15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8,
+        15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+    };
+
+    // Interpolation weights out of 64 by index size.
+    const u8 Weights2[4] = {0, 21, 43, 64};
+    const u8 Weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+    const u8 Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    const u8 *WeightsFor(u32 bits) {
+        return bits == 2 ? Weights2 : bits == 3 ? Weights3 : Weights4;
+    }
+
+    // The 128 bits of a BC6H/BC7 block, read from the least significant bit up.
+    struct BlockBits {
+        u64 lo, hi;
+        u32 pos = 0;
+
+        explicit BlockBits(const u8 *block) {
+            memcpy(&lo, block, sizeof(lo));
+            memcpy(&hi, block + sizeof(lo), sizeof(hi));
+        }
+
+        u32 Read(u32 count) {
+            if (count == 0) return 0;
+            u64 value;
+            if (pos >= 64) value = hi >> (pos - 64);
+            else if (pos + count <= 64) value = lo >> pos;
+            else value = (lo >> pos) | (hi << (64 - pos));
+            pos += count;
+            return (u32)(value & ((1ull << count) - 1));
+        }
+
+        // Some BC6H fields are stored most significant bit first.
+        u32 ReadReversed(u32 count) {
+            u32 value = Read(count), reversed = 0;
+            for (u32 i = 0; i < count; ++i) reversed = (reversed << 1) | ((value >> i) & 1);
+            return reversed;
+        }
+    };
+
+    // Palette entries `(e0 * (64 - w) + e1 * w + 32) >> 6` for each weight, on all four channels at once. `count` is
+    // always even, two entries fill a vector.
+    void InterpolatePalette(const u8 *e0, const u8 *e1, const u8 *weights, u32 count, u8 (*out)[Channels]) {
+#if defined(RD_BCDECODE_SSE2)
+        const __m128i a = _mm_setr_epi16(e0[0], e0[1], e0[2], e0[3], e0[0], e0[1], e0[2], e0[3]);
+        const __m128i b = _mm_setr_epi16(e1[0], e1[1], e1[2], e1[3], e1[0], e1[1], e1[2], e1[3]);
+        const __m128i total = _mm_set1_epi16(64);
+        const __m128i round = _mm_set1_epi16(32);
+        for (u32 i = 0; i < count; i += 2) {
+            __m128i w = _mm_setr_epi16(weights[i], weights[i], weights[i], weights[i],
+                                       weights[i + 1], weights[i + 1], weights[i + 1], weights[i + 1]);
+            __m128i v = _mm_add_epi16(_mm_mullo_epi16(a, _mm_sub_epi16(total, w)), _mm_mullo_epi16(b, w));
+            v = _mm_srli_epi16(_mm_add_epi16(v, round), 6);
+            _mm_storel_epi64((__m128i*)out[i], _mm_packus_epi16(v, v));
+        }
+#elif defined(RD_BCDECODE_NEON)
+        const uint16x8_t a = vmovl_u8(vcreate_u8((u64)e0[0] | (u64)e0[1] << 8 | (u64)e0[2] << 16 | (u64)e0[3] << 24 |
+                                                (u64)e0[0] << 32 | (u64)e0[1] << 40 | (u64)e0[2] << 48 | (u64)e0[3] << 56));
+        const uint16x8_t b = vmovl_u8(vcreate_u8((u64)e1[0] | (u64)e1[1] << 8 | (u64)e1[2] << 16 | (u64)e1[3] << 24 |
+                                                (u64)e1[0] << 32 | (u64)e1[1] << 40 | (u64)e1[2] << 48 | (u64)e1[3] << 56));
+        for (u32 i = 0; i < count; i += 2) {
+            uint16x8_t w = vcombine_u16(vdup_n_u16(weights[i]), vdup_n_u16(weights[i + 1]));
+            uint16x8_t v = vmlaq_u16(vmulq_u16(a, vsubq_u16(vdupq_n_u16(64), w)), b, w);
+            vst1_u8(out[i], vrshrn_n_u16(v, 6));
+        }
+#else
+        for (u32 i = 0; i < count; ++i) {
+            for (u32 c = 0; c < Channels; ++c) {
+                out[i][c] = (u8)((e0[c] * (64 - weights[i]) + e1[c] * weights[i] + 32) >> 6);
+            }
+        }
+#endif
+    }
+
+    void Expand565(u16 color, u8 *out) {
+        u32 r = (color >> 11) & 0x1F, g = (color >> 5) & 0x3F, b = color & 0x1F;
+        out[0] = (u8)((r << 3) | (r >> 2));
+        out[1] = (u8)((g << 2) | (g >> 4));
+        out[2] = (u8)((b << 3) | (b >> 2));
+        out[3] = 255;
+    }
+
+    // The color half of BC1-BC3. BC2 and BC3 always use four colors, BC1 switches to three and transparent black when
+    // the endpoints are in ascending order.
+    void DecodeColorBlock(const u8 *block, u8 *out, bool allow_transparent) {
+        u16 c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+        u32 indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((u32)block[7] << 24);
+
+        u8 palette[4][Channels];
+        Expand565(c0, palette[0]);
+        Expand565(c1, palette[1]);
+        if (c0 > c1 || !allow_transparent) {
+            for (u32 c = 0; c < 3; ++c) {
+                palette[2][c] = (u8)((2 * palette[0][c] + palette[1][c]) / 3);
+                palette[3][c] = (u8)((palette[0][c] + 2 * palette[1][c]) / 3);
+            }
+            palette[2][3] = palette[3][3] = 255;
+        } else {
+            for (u32 c = 0; c < 3; ++c) palette[2][c] = (u8)((palette[0][c] + palette[1][c]) / 2);
+            palette[2][3] = 255;
+            memset(palette[3], 0, Channels);
+        }
+
+        for (u32 i = 0; i < 16; ++i, indices >>= 2) {
+            memcpy(out + i * Channels, palette[indices & 3], Channels);
+        }
+    }
+
+    // One channel of BC3 alpha, BC4 and BC5: two endpoints and 3 bit indices. Values are signed for the SNORM
+    // variants and get shifted to 0-255 for display.
+    void DecodeChannelBlock(const u8 *block, u8 *out, u32 channel, bool is_signed) {
+        i32 e0 = is_signed ? std::max<i32>((i8)block[0], -127) : block[0];
+        i32 e1 = is_signed ? std::max<i32>((i8)block[1], -127) : block[1];
+        const i32 low = is_signed ? -127 : 0, high = is_signed ? 127 : 255;
+
+        i32 palette[8] = {e0, e1};
+        if (e0 > e1) {
+            for (i32 i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * e0 + i * e1) / 7;
+        } else {
+            for (i32 i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * e0 + i * e1) / 5;
+            palette[6] = low;
+            palette[7] = high;
+        }
+
+        u8 values[8];
+        for (u32 i = 0; i < 8; ++i) {
+            values[i] = is_signed ? (u8)((palette[i] + 127) * 255 / 254) : (u8)palette[i];
+        }
+
+        u64 indices = 0;
+        for (u32 i = 0; i < 6; ++i) indices |= (u64)block[2 + i] << (8 * i);
+        for (u32 i = 0; i < 16; ++i, indices >>= 3) {
+            out[i * Channels + channel] = values[indices & 7];
+        }
+    }
+
+    void DecodeBC1(const u8 *block, u8 *out) {
+        DecodeColorBlock(block, out, true);
+    }
+
+    void DecodeBC2(const u8 *block, u8 *out) {
+        DecodeColorBlock(block + 8, out, false);
+        for (u32 i = 0; i < 16; ++i) {
+            u32 alpha = (block[i / 2] >> ((i & 1) * 4)) & 0xF;
+            out[i * Channels + 3] = (u8)(alpha * 17);
+        }
+    }
+
+    void DecodeBC3(const u8 *block, u8 *out) {
+        DecodeColorBlock(block + 8, out, false);
+        DecodeChannelBlock(block, out, 3, false);
+    }
+
+    template <bool Signed>
+    void DecodeBC4(const u8 *block, u8 *out) {
+        DecodeChannelBlock(block, out, 0, Signed);
+        for (u32 i = 0; i < 16; ++i) {
+            out[i * Channels + 1] = out[i * Channels + 2] = out[i * Channels];
+            out[i * Channels + 3] = 255;
+        }
+    }
+
+    template <bool Signed>
+    void DecodeBC5(const u8 *block, u8 *out) {
+        DecodeChannelBlock(block, out, 0, Signed);
+        DecodeChannelBlock(block + 8, out, 1, Signed);
+        for (u32 i = 0; i < 16; ++i) {
+            out[i * Channels + 2] = 0;
+            out[i * Channels + 3] = 255;
+        }
+    }
+
+    struct BC7Mode {
+        u8 subsets;
+        u8 partition_bits;
+        u8 rotation_bits;
+        u8 index_selection_bits;
+        u8 color_bits;
+        u8 alpha_bits;
+        u8 endpoint_pbits;
+        u8 shared_pbits;
+        u8 index_bits;
+        u8 index_bits2;
+    };
+
+    const BC7Mode BC7Modes[8] = {
+        {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+        {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+        {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+        {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+        {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+        {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+        {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+        {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+    };
+
+    u8 ExpandBits(u32 value, u32 bits) {
+        value <<= 8 - bits;
+        return (u8)(value | (value >> bits));
+    }
+
+    void DecodeBC7(const u8 *block, u8 *out) {
+        BlockBits bits(block);
+        u32 mode = 0;
+        while (mode < 8 && !bits.Read(1)) mode++;
+        if (mode == 8) {
+            // Reserved mode, decoders output transparent black.
+            memset(out, 0, 16 * Channels);
+            return;
+        }
+
+        const BC7Mode &m = BC7Modes[mode];
+        u32 partition = bits.Read(m.partition_bits);
+        u32 rotation = bits.Read(m.rotation_bits);
+        u32 index_selection = bits.Read(m.index_selection_bits);
+
+        u32 endpoint_count = m.subsets * 2u;
+        u8 endpoints[6][Channels];
+        for (u32 c = 0; c < 3; ++c) {
+            for (u32 e = 0; e < endpoint_count; ++e) endpoints[e][c] = (u8)bits.Read(m.color_bits);
+        }
+        for (u32 e = 0; e < endpoint_count; ++e) endpoints[e][3] = (u8)bits.Read(m.alpha_bits);
+
+        u32 pbits[6] = {};
+        if (m.endpoint_pbits) {
+            for (u32 e = 0; e < endpoint_count; ++e) pbits[e] = bits.Read(1);
+        } else if (m.shared_pbits) {
+            for (u32 s = 0; s < m.subsets; ++s) pbits[s * 2] = pbits[s * 2 + 1] = bits.Read(1);
+        }
+
+        u32 has_pbit = m.endpoint_pbits | m.shared_pbits;
+        for (u32 e = 0; e < endpoint_count; ++e) {
+            for (u32 c = 0; c < 3; ++c) {
+                endpoints[e][c] = ExpandBits((endpoints[e][c] << has_pbit) | pbits[e], m.color_bits + has_pbit);
+            }
+            endpoints[e][3] = m.alpha_bits ? ExpandBits((endpoints[e][3] << has_pbit) | pbits[e], m.alpha_bits + has_pbit) : 255;
+        }
+
+        static const u8 NoPartition[16] = {};
+        const u8 *subset_of = m.subsets == 2 ? Partitions2[partition] : m.subsets == 3 ? Partitions3[partition] : NoPartition;
+        u8 anchors[3] = {0, 0, 0};
+        if (m.subsets == 2) anchors[1] = Anchors2[partition];
+        if (m.subsets == 3) {
+            anchors[1] = Anchors3a[partition];
+            anchors[2] = Anchors3b[partition];
+        }
+
+        u8 indices[16], indices2[16];
+        for (u32 i = 0; i < 16; ++i) {
+            indices[i] = (u8)bits.Read(m.index_bits - (i == anchors[subset_of[i]]));
+        }
+        if (m.index_bits2) {
+            for (u32 i = 0; i < 16; ++i) indices2[i] = (u8)bits.Read(m.index_bits2 - (i == 0));
+        }
+
+        if (!m.index_bits2) {
+            u8 palette[3][16][Channels];
+            for (u32 s = 0; s < m.subsets; ++s) {
+                InterpolatePalette(endpoints[s * 2], endpoints[s * 2 + 1], WeightsFor(m.index_bits), 1u << m.index_bits, palette[s]);
+            }
+            for (u32 i = 0; i < 16; ++i) {
+                memcpy(out + i * Channels, palette[subset_of[i]][indices[i]], Channels);
+            }
+            return;
+        }
+
+        // Modes 4 and 5 index color and alpha separately, mode 4 can swap which of them gets the larger indices.
+        u32 color_bits = m.index_bits, alpha_bits = m.index_bits2;
+        const u8 *color_indices = indices, *alpha_indices = indices2;
+        if (index_selection) {
+            std::swap(color_bits, alpha_bits);
+            std::swap(color_indices, alpha_indices);
+        }
+
+        u8 color_palette[8][Channels], alpha_palette[8][Channels];
+        InterpolatePalette(endpoints[0], endpoints[1], WeightsFor(color_bits), 1u << color_bits, color_palette);
+        InterpolatePalette(endpoints[0], endpoints[1], WeightsFor(alpha_bits), 1u << alpha_bits, alpha_palette);
+        for (u32 i = 0; i < 16; ++i) {
+            u8 *pixel = out + i * Channels;
+            memcpy(pixel, color_palette[color_indices[i]], 3);
+            pixel[3] = alpha_palette[alpha_indices[i]][3];
+            if (rotation) std::swap(pixel[3], pixel[rotation - 1]);
+        }
+    }
+
+    // BC6H mode numbers by their 2 or 5 bit prefix, -1 for reserved prefixes.
+    const i8 BC6HModeByPrefix[32] = {
+         0,  1,  2, 10, -1, -1,  3, 11, -1, -1,  4, 12, -1, -1,  5, 13,
+        -1, -1,  6, -1, -1, -1,  7, -1, -1, -1,  8, -1, -1, -1,  9, -1,
+    };
+
+    struct BC6HMode {
+        bool transformed;
+        u8 endpoint_bits;
+        u8 delta_bits[3];
+    };
+
+    const BC6HMode BC6HModes[14] = {
+        {true, 10, {5, 5, 5}}, {true, 7, {6, 6, 6}},  {true, 11, {5, 4, 4}}, {true, 11, {4, 5, 4}},
+        {true, 11, {4, 4, 5}}, {true, 9, {5, 5, 5}},  {true, 8, {6, 5, 5}},  {true, 8, {5, 6, 5}},
+        {true, 8, {5, 5, 6}},  {false, 6, {6, 6, 6}}, {false, 10, {10, 10, 10}}, {true, 11, {9, 9, 9}},
+        {true, 12, {8, 8, 8}}, {true, 16, {4, 4, 4}},
+    };
+
+    i32 SignExtend(i32 value, u32 bits) {
+        u32 shift = 32 - bits;
+        return (i32)((u32)value << shift) >> shift;
+    }
+
+    i32 Unquantize(i32 value, u32 bits, bool is_signed) {
+        if (!is_signed) {
+            if (bits >= 15) return value;
+            if (value == 0) return 0;
+            if (value == (1 << bits) - 1) return 0xFFFF;
+            return ((value << 16) + 0x8000) >> bits;
+        }
+
+        if (bits >= 16) return value;
+        bool negative = value < 0;
+        if (negative) value = -value;
+        i32 result;
+        if (value == 0) result = 0;
+        else if (value >= (1 << (bits - 1)) - 1) result = 0x7FFF;
+        else result = ((value << 15) + 0x4000) >> (bits - 1);
+        return negative ? -result : result;
+    }
+
+    // Half float bits in [0, 1] to sRGB bytes. BC6H is linear HDR, the preview clamps it and applies the sRGB curve.
+    const u8 *HalfToSRGBTable() {
+        static const std::vector<u8> table = [] {
+            std::vector<u8> table(0x3C01);
+            for (u32 h = 0; h < table.size(); ++h) {
+                u32 exponent = h >> 10, mantissa = h & 0x3FF;
+                float value = exponent ? std::ldexp(1.0f + mantissa / 1024.0f, (i32)exponent - 15) : std::ldexp(mantissa / 1024.0f, -14);
+                value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                table[h] = (u8)std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f);
+            }
+            return table;
+        }();
+        return table.data();
+    }
+
+    u8 FinishBC6H(i32 value, bool is_signed, const u8 *srgb) {
+        u32 half;
+        if (!is_signed) {
+            half = (u32)(value * 31) >> 6;
+        } else {
+            // Negative values clamp to black anyway.
+            if (value < 0) return 0;
+            half = (u32)(value * 31) >> 5;
+        }
+        return half > 0x3C00 ? 255 : srgb[half];
+    }
+
+    template <bool Signed>
+    void DecodeBC6H(const u8 *block, u8 *out) {
+        BlockBits bits(block);
+        u32 prefix = bits.Read(2);
+        if (prefix > 1) prefix |= bits.Read(3) << 2;
+        i32 mode = BC6HModeByPrefix[prefix];
+        if (mode < 0) {
+            for (u32 i = 0; i < 16; ++i) {
+                memset(out + i * Channels, 0, 3);
+                out[i * Channels + 3] = 255;
+            }
+            return;
+        }
+
+        // Endpoints w, x, y, z: the two of the first region then the two of the second.
+        i32 r[4] = {}, g[4] = {}, b[4] = {};
+        auto field = [&](i32 &value, u32 shift, u32 count) { value |= (i32)(bits.Read(count) << shift); };
+        auto bit = [&](i32 &value, u32 index) { value |= (i32)(bits.Read(1) << index); };
+        auto reversed = [&](i32 &value, u32 shift, u32 count) { value |= (i32)(bits.ReadReversed(count) << shift); };
+
+        switch (mode) {
+            case 0:
+                bit(g[2], 4); bit(b[2], 4); bit(b[3], 4);
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 5); bit(g[3], 4); field(g[2], 0, 4);
+                field(g[1], 0, 5); bit(b[3], 0); field(g[3], 0, 4);
+                field(b[1], 0, 5); bit(b[3], 1); field(b[2], 0, 4);
+                field(r[2], 0, 5); bit(b[3], 2); field(r[3], 0, 5); bit(b[3], 3);
+                break;
+            case 1:
+                bit(g[2], 5); bit(g[3], 4); bit(g[3], 5);
+                field(r[0], 0, 7); bit(b[3], 0); bit(b[3], 1); bit(b[2], 4);
+                field(g[0], 0, 7); bit(b[2], 5); bit(b[3], 2); bit(g[2], 4);
+                field(b[0], 0, 7); bit(b[3], 3); bit(b[3], 5); bit(b[3], 4);
+                field(r[1], 0, 6); field(g[2], 0, 4);
+                field(g[1], 0, 6); field(g[3], 0, 4);
+                field(b[1], 0, 6); field(b[2], 0, 4);
+                field(r[2], 0, 6); field(r[3], 0, 6);
+                break;
+            case 2:
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 5); bit(r[0], 10); field(g[2], 0, 4);
+                field(g[1], 0, 4); bit(g[0], 10); bit(b[3], 0); field(g[3], 0, 4);
+                field(b[1], 0, 4); bit(b[0], 10); bit(b[3], 1); field(b[2], 0, 4);
+                field(r[2], 0, 5); bit(b[3], 2); field(r[3], 0, 5); bit(b[3], 3);
+                break;
+            case 3:
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 4); bit(r[0], 10); bit(g[3], 4); field(g[2], 0, 4);
+                field(g[1], 0, 5); bit(g[0], 10); field(g[3], 0, 4);
+                field(b[1], 0, 4); bit(b[0], 10); bit(b[3], 1); field(b[2], 0, 4);
+                field(r[2], 0, 4); bit(b[3], 0); bit(b[3], 2); field(r[3], 0, 4); bit(g[2], 4); bit(b[3], 3);
+                break;
+            case 4:
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 4); bit(r[0], 10); bit(b[2], 4); field(g[2], 0, 4);
+                field(g[1], 0, 4); bit(g[0], 10); bit(b[3], 0); field(g[3], 0, 4);
+                field(b[1], 0, 5); bit(b[0], 10); field(b[2], 0, 4);
+                field(r[2], 0, 4); bit(b[3], 1); bit(b[3], 2); field(r[3], 0, 4); bit(b[3], 4); bit(b[3], 3);
+                break;
+            case 5:
+                field(r[0], 0, 9); bit(b[2], 4); field(g[0], 0, 9); bit(g[2], 4); field(b[0], 0, 9); bit(b[3], 4);
+                field(r[1], 0, 5); bit(g[3], 4); field(g[2], 0, 4);
+                field(g[1], 0, 5); bit(b[3], 0); field(g[3], 0, 4);
+                field(b[1], 0, 5); bit(b[3], 1); field(b[2], 0, 4);
+                field(r[2], 0, 5); bit(b[3], 2); field(r[3], 0, 5); bit(b[3], 3);
+                break;
+            case 6:
+                field(r[0], 0, 8); bit(g[3], 4); bit(b[2], 4);
+                field(g[0], 0, 8); bit(b[3], 2); bit(g[2], 4);
+                field(b[0], 0, 8); bit(b[3], 3); bit(b[3], 4);
+                field(r[1], 0, 6); field(g[2], 0, 4);
+                field(g[1], 0, 5); bit(b[3], 0); field(g[3], 0, 4);
+                field(b[1], 0, 5); bit(b[3], 1); field(b[2], 0, 4);
+                field(r[2], 0, 6); field(r[3], 0, 6);
+                break;
+            case 7:
+                field(r[0], 0, 8); bit(b[3], 0); bit(b[2], 4);
+                field(g[0], 0, 8); bit(g[2], 5); bit(g[2], 4);
+                field(b[0], 0, 8); bit(g[3], 5); bit(b[3], 4);
+                field(r[1], 0, 5); bit(g[3], 4); field(g[2], 0, 4);
+                field(g[1], 0, 6); field(g[3], 0, 4);
+                field(b[1], 0, 5); bit(b[3], 1); field(b[2], 0, 4);
+                field(r[2], 0, 5); bit(b[3], 2); field(r[3], 0, 5); bit(b[3], 3);
+                break;
+            case 8:
+                field(r[0], 0, 8); bit(b[3], 1); bit(b[2], 4);
+                field(g[0], 0, 8); bit(b[2], 5); bit(g[2], 4);
+                field(b[0], 0, 8); bit(b[3], 5); bit(b[3], 4);
+                field(r[1], 0, 5); bit(g[3], 4); field(g[2], 0, 4);
+                field(g[1], 0, 5); bit(b[3], 0); field(g[3], 0, 4);
+                field(b[1], 0, 6); field(b[2], 0, 4);
+                field(r[2], 0, 5); bit(b[3], 2); field(r[3], 0, 5); bit(b[3], 3);
+                break;
+            case 9:
+                field(r[0], 0, 6); bit(g[3], 4); bit(b[3], 0); bit(b[3], 1); bit(b[2], 4);
+                field(g[0], 0, 6); bit(g[2], 5); bit(b[2], 5); bit(b[3], 2); bit(g[2], 4);
+                field(b[0], 0, 6); bit(g[3], 5); bit(b[3], 3); bit(b[3], 5); bit(b[3], 4);
+                field(r[1], 0, 6); field(g[2], 0, 4);
+                field(g[1], 0, 6); field(g[3], 0, 4);
+                field(b[1], 0, 6); field(b[2], 0, 4);
+                field(r[2], 0, 6); field(r[3], 0, 6);
+                break;
+            case 10:
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 10); field(g[1], 0, 10); field(b[1], 0, 10);
+                break;
+            case 11:
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 9); bit(r[0], 10);
+                field(g[1], 0, 9); bit(g[0], 10);
+                field(b[1], 0, 9); bit(b[0], 10);
+                break;
+            case 12:
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 8); reversed(r[0], 10, 2);
+                field(g[1], 0, 8); reversed(g[0], 10, 2);
+                field(b[1], 0, 8); reversed(b[0], 10, 2);
+                break;
+            case 13:
+                field(r[0], 0, 10); field(g[0], 0, 10); field(b[0], 0, 10);
+                field(r[1], 0, 4); reversed(r[0], 10, 6);
+                field(g[1], 0, 4); reversed(g[0], 10, 6);
+                field(b[1], 0, 4); reversed(b[0], 10, 6);
+                break;
+        }
+
+        const BC6HMode &m = BC6HModes[mode];
+        const u32 regions = mode < 10 ? 2 : 1;
+        const u32 partition = regions == 2 ? bits.Read(5) : 0;
+        const u32 endpoint_count = regions * 2;
+        const u32 bits_mask = (1u << m.endpoint_bits) - 1;
+
+        i32 *channels[3] = {r, g, b};
+        for (u32 c = 0; c < 3; ++c) {
+            i32 *e = channels[c];
+            if (Signed) e[0] = SignExtend(e[0], m.endpoint_bits);
+            for (u32 i = 1; i < endpoint_count; ++i) {
+                if (m.transformed) {
+                    e[i] = (e[0] + SignExtend(e[i], m.delta_bits[c])) & bits_mask;
+                    if (Signed) e[i] = SignExtend(e[i], m.endpoint_bits);
+                } else if (Signed) {
+                    e[i] = SignExtend(e[i], m.endpoint_bits);
+                }
+            }
+            for (u32 i = 0; i < endpoint_count; ++i) e[i] = Unquantize(e[i], m.endpoint_bits, Signed);
+        }
+
+        const u8 *subset_of = regions == 2 ? Partitions2[partition] : nullptr;
+        const u32 index_bits = regions == 2 ? 3 : 4;
+        const u8 *weights = WeightsFor(index_bits);
+        const u8 *srgb = HalfToSRGBTable();
+        for (u32 i = 0; i < 16; ++i) {
+            u32 subset = subset_of ? subset_of[i] : 0;
+            bool anchor = i == 0 || (subset_of && i == Anchors2[partition]);
+            i32 w = weights[bits.Read(index_bits - anchor)];
+
+            u8 *pixel = out + i * Channels;
+            for (u32 c = 0; c < 3; ++c) {
+                i32 value = (channels[c][subset * 2] * (64 - w) + channels[c][subset * 2 + 1] * w + 32) >> 6;
+                pixel[c] = FinishBC6H(value, Signed, srgb);
+            }
+            pixel[3] = 255;
+        }
+    }
+
+    typedef void (*BlockDecoder)(const u8 *block, u8 *out);
+
+    struct BlockFormat {
+        BlockDecoder decode;
+        u32 block_size;
+    };
+
+    BlockFormat GetBlockFormat(DXGI_FORMAT format) {
+        switch (format) {
+            case DXGI_FORMAT_BC1_TYPELESS:
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+                return {DecodeBC1, 8};
+            case DXGI_FORMAT_BC2_TYPELESS:
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+                return {DecodeBC2, 16};
+            case DXGI_FORMAT_BC3_TYPELESS:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+                return {DecodeBC3, 16};
+            case DXGI_FORMAT_BC4_TYPELESS:
+            case DXGI_FORMAT_BC4_UNORM:
+                return {DecodeBC4<false>, 8};
+            case DXGI_FORMAT_BC4_SNORM:
+                return {DecodeBC4<true>, 8};
+            case DXGI_FORMAT_BC5_TYPELESS:
+            case DXGI_FORMAT_BC5_UNORM:
+                return {DecodeBC5<false>, 16};
+            case DXGI_FORMAT_BC5_SNORM:
+                return {DecodeBC5<true>, 16};
+            case DXGI_FORMAT_BC6H_TYPELESS:
+            case DXGI_FORMAT_BC6H_UF16:
+                return {DecodeBC6H<false>, 16};
+            case DXGI_FORMAT_BC6H_SF16:
+                return {DecodeBC6H<true>, 16};
+            case DXGI_FORMAT_BC7_TYPELESS:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                return {DecodeBC7, 16};
+            default:
+                return {nullptr, 0};
+        }
+    }
+
+    float HalfToFloat(u16 half) {
+        u32 exponent = (half >> 10) & 0x1F, mantissa = half & 0x3FF;
+        float value;
+        if (exponent == 0) value = std::ldexp((float)mantissa, -24);
+        else if (exponent == 31) value = mantissa ? 0.0f : INFINITY;
+        else value = std::ldexp((float)(mantissa | 0x400), (i32)exponent - 25);
+        return half & 0x8000 ? -value : value;
+    }
+
+    u8 UnitToByte(float value) {
+        return (u8)std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f);
+    }
+
+    u16 Read16(const u8 *src) {
+        return (u16)(src[0] | (src[1] << 8));
+    }
+
+    u32 Read32(const u8 *src) {
+        return src[0] | (src[1] << 8) | (src[2] << 16) | ((u32)src[3] << 24);
+    }
+
+    // Uncompressed formats, one pixel at a time. Returns the pixel size, or 0 if the format isn't one of these.
+    u32 PixelSize(DXGI_FORMAT format) {
+        switch (format) {
+            case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+            case DXGI_FORMAT_B8G8R8X8_UNORM:
+            case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            case DXGI_FORMAT_R10G10B10A2_UNORM:
+            case DXGI_FORMAT_R16G16_UNORM:
+                return 4;
+            case DXGI_FORMAT_R8G8_UNORM:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_B5G6R5_UNORM:
+            case DXGI_FORMAT_B5G5R5A1_UNORM:
+            case DXGI_FORMAT_B4G4R4A4_UNORM:
+                return 2;
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_A8_UNORM:
+                return 1;
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+                return 8;
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    void DecodeRow(DXGI_FORMAT format, const u8 *src, u32 width, u8 *dst) {
+        const u32 pixel_size = PixelSize(format);
+        for (u32 x = 0; x < width; ++x, src += pixel_size, dst += Channels) {
+            switch (format) {
+                case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+                case DXGI_FORMAT_R8G8B8A8_UNORM:
+                case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+                    memcpy(dst, src, Channels);
+                    break;
+                case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+                case DXGI_FORMAT_B8G8R8A8_UNORM:
+                case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+                    dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0]; dst[3] = src[3];
+                    break;
+                case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+                case DXGI_FORMAT_B8G8R8X8_UNORM:
+                case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+                    dst[0] = src[2]; dst[1] = src[1]; dst[2] = src[0]; dst[3] = 255;
+                    break;
+                case DXGI_FORMAT_R10G10B10A2_UNORM: {
+                    u32 v = Read32(src);
+                    dst[0] = (u8)((v >> 2) & 0xFF); dst[1] = (u8)((v >> 12) & 0xFF); dst[2] = (u8)((v >> 22) & 0xFF);
+                    dst[3] = (u8)((v >> 30) * 85);
+                    break;
+                }
+                case DXGI_FORMAT_R16G16_UNORM:
+                    dst[0] = src[1]; dst[1] = src[3]; dst[2] = 0; dst[3] = 255;
+                    break;
+                case DXGI_FORMAT_R8G8_UNORM:
+                    dst[0] = src[0]; dst[1] = src[1]; dst[2] = 0; dst[3] = 255;
+                    break;
+                case DXGI_FORMAT_R16_UNORM:
+                    dst[0] = dst[1] = dst[2] = src[1]; dst[3] = 255;
+                    break;
+                case DXGI_FORMAT_B5G6R5_UNORM: {
+                    Expand565(Read16(src), dst);
+                    break;
+                }
+                case DXGI_FORMAT_B5G5R5A1_UNORM: {
+                    u32 v = Read16(src), r = (v >> 10) & 0x1F, g = (v >> 5) & 0x1F, b = v & 0x1F;
+                    dst[0] = (u8)((r << 3) | (r >> 2)); dst[1] = (u8)((g << 3) | (g >> 2)); dst[2] = (u8)((b << 3) | (b >> 2));
+                    dst[3] = v & 0x8000 ? 255 : 0;
+                    break;
+                }
+                case DXGI_FORMAT_B4G4R4A4_UNORM: {
+                    u32 v = Read16(src);
+                    dst[0] = (u8)(((v >> 8) & 0xF) * 17); dst[1] = (u8)(((v >> 4) & 0xF) * 17); dst[2] = (u8)((v & 0xF) * 17);
+                    dst[3] = (u8)((v >> 12) * 17);
+                    break;
+                }
+                case DXGI_FORMAT_R8_UNORM:
+                    dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255;
+                    break;
+                case DXGI_FORMAT_A8_UNORM:
+                    dst[0] = dst[1] = dst[2] = 255; dst[3] = src[0];
+                    break;
+                case DXGI_FORMAT_R16G16B16A16_UNORM:
+                    for (u32 c = 0; c < Channels; ++c) dst[c] = src[c * 2 + 1];
+                    break;
+                case DXGI_FORMAT_R16G16B16A16_FLOAT:
+                    for (u32 c = 0; c < Channels; ++c) dst[c] = UnitToByte(HalfToFloat(Read16(src + c * 2)));
+                    break;
+                case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                    for (u32 c = 0; c < Channels; ++c) {
+                        float value;
+                        memcpy(&value, src + c * 4, sizeof(value));
+                        dst[c] = UnitToByte(value);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Block rows [first, last) of the image.
+    void DecodeBlockRows(const BlockFormat &format, const u8 *src, u32 width, u32 height, u32 first, u32 last, u8 *dst) {
+        const u32 blocks_x = (width + BlockDim - 1) / BlockDim;
+        const usize dst_stride = (usize)width * Channels;
+        u8 pixels[BlockDim * BlockDim * Channels];
+
+        for (u32 by = first; by < last; ++by) {
+            const u8 *block = src + (usize)by * blocks_x * format.block_size;
+            const u32 rows = std::min(BlockDim, height - by * BlockDim);
+            for (u32 bx = 0; bx < blocks_x; ++bx, block += format.block_size) {
+                format.decode(block, pixels);
+
+                const u32 columns = std::min(BlockDim, width - bx * BlockDim);
+                u8 *out = dst + (usize)by * BlockDim * dst_stride + (usize)bx * BlockDim * Channels;
+                for (u32 y = 0; y < rows; ++y) {
+                    memcpy(out + y * dst_stride, pixels + y * BlockDim * Channels, columns * Channels);
+                }
+            }
+        }
+    }
+}
+
+bool DDSDecode::IsSupported(DXGI_FORMAT format) {
+    return GetBlockFormat(format).decode || PixelSize(format);
+}
+
+usize DDSDecode::SourceSize(DXGI_FORMAT format, u32 width, u32 height) {
+    if (BlockFormat block = GetBlockFormat(format); block.decode) {
+        return (usize)((width + BlockDim - 1) / BlockDim) * ((height + BlockDim - 1) / BlockDim) * block.block_size;
+    }
+    return (usize)width * height * PixelSize(format);
+}
+
+bool DDSDecode::DecodeRGBA8(DXGI_FORMAT format, const u8 *src, usize src_size, u32 width, u32 height, u8 *dst) {
+    if (!IsSupported(format) || width == 0 || height == 0 || src_size < SourceSize(format, width, height)) {
+        return false;
+    }
+
+    BlockFormat block = GetBlockFormat(format);
+    if (!block.decode) {
+        const usize src_stride = (usize)width * PixelSize(format);
+        for (u32 y = 0; y < height; ++y) {
+            DecodeRow(format, src + y * src_stride, width, dst + (usize)y * width * Channels);
+        }
+        return true;
+    }
+
+    const u32 block_rows = (height + BlockDim - 1) / BlockDim;
+    std::atomic<u32> next = 0;
+    auto worker = [&]() {
+        for (u32 first = next.fetch_add(RowsPerBatch); first < block_rows; first = next.fetch_add(RowsPerBatch)) {
+            DecodeBlockRows(block, src, width, height, first, std::min(first + RowsPerBatch, block_rows), dst);
+        }
+    };
+
+    u32 thread_count = 1;
+    if ((u64)width * height >= ThreadedPixels) {
+        thread_count = std::min<u32>(std::max(1u, std::thread::hardware_concurrency()), (block_rows + RowsPerBatch - 1) / RowsPerBatch);
+    }
+    std::vector<std::thread> workers;
+    for (u32 i = 1; i < thread_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "dds_formats.h"
+#include <util/int.h>
+
+// CPU decoding of DDS pixel data to RGBA8, for the block compressed (BC1-BC7) and common uncompressed DXGI formats
+// GL can't take as is. Single channel formats come out as grey, two channel formats as red/green.
+namespace DDSDecode {
+    bool IsSupported(DXGI_FORMAT format);
+
+    // Bytes of `format` data a width x height image takes, 0 for unsupported formats.
+    usize SourceSize(DXGI_FORMAT format, u32 width, u32 height);
+
+    // Decodes a width x height image into tightly packed RGBA8 at `dst`, which must hold width * height * 4 bytes.
+    // Large block compressed images are split across threads by rows of blocks.
+    bool DecodeRGBA8(DXGI_FORMAT format, const u8 *src, usize src_size, u32 width, u32 height, u8 *dst);
+}
@@ -0,0 +1,582 @@
+#include "TLGDecode.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RD_TLG_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RD_TLG_NEON
+#endif
+
+namespace {
+    constexpr usize MagicSize = 11;
+    const char Tlg0Magic[] = "TLG0.0\0sds\x1a";
+    const char Tlg5Magic[] = "TLG5.0\0raw\x1a";
+    const char Tlg6Magic[] = "TLG6.0\0raw\x1a";
+
+    // LZSS dictionary size, shared by TLG5 and TLG6's filter table.
+    constexpr u32 SlideSize = 4096;
+    // TLG6 codes the image in square blocks, each with its own filter.
+    constexpr u32 BlockSize = 8;
+    constexpr int GolombNCount = 4;
+    // Golomb coded values can overread by this much past the end of their bits.
+    constexpr usize BitsPadding = 16;
+
+    // Below this many pixels starting threads costs more than it saves.
+    constexpr u64 ThreadedPixels = 512 * 512;
+
+    u32 Read32(const u8 *src) {
+        u32 value;
+        memcpy(&value, src, sizeof(value));
+        return value;
+    }
+
+    enum class Version { Tlg5, Tlg6 };
+
+    struct Header {
+        Version version;
+        u32 colors;
+        u32 width;
+        u32 height;
+        // TLG5 only, rows per separately compressed block.
+        u32 block_height;
+        // Everything after the header.
+        const u8 *data;
+        usize size;
+    };
+
+    bool ReadHeader(const u8 *src, usize size, Header &header) {
+        // The container only adds tags after the image, which aren't needed to show it.
+        if (size >= MagicSize + 4 && !memcmp(src, Tlg0Magic, MagicSize)) {
+            const u32 raw_size = Read32(src + MagicSize);
+            src += MagicSize + 4;
+            size -= MagicSize + 4;
+            if (raw_size > size) return false;
+            size = raw_size;
+        }
+        if (size < MagicSize) return false;
+
+        if (!memcmp(src, Tlg5Magic, MagicSize)) {
+            if (size < MagicSize + 13) return false;
+            const u8 *fields = src + MagicSize;
+            header.version = Version::Tlg5;
+            header.colors = fields[0];
+            header.width = Read32(fields + 1);
+            header.height = Read32(fields + 5);
+            header.block_height = Read32(fields + 9);
+            header.data = fields + 13;
+            header.size = size - MagicSize - 13;
+            return (header.colors == 3 || header.colors == 4) && header.width && header.height && header.block_height;
+        }
+        if (!memcmp(src, Tlg6Magic, MagicSize)) {
+            if (size < MagicSize + 16) return false;
+            const u8 *fields = src + MagicSize;
+            header.version = Version::Tlg6;
+            header.colors = fields[0];
+            header.width = Read32(fields + 4);
+            header.height = Read32(fields + 8);
+            header.block_height = 0;
+            header.data = fields + 16;
+            header.size = size - MagicSize - 16;
+            // The data flag, color type and external Golomb table fields are reserved and always 0.
+            const bool reserved_clear = !fields[1] && !fields[2] && !fields[3];
+            return (header.colors == 1 || header.colors == 3 || header.colors == 4) && reserved_clear && header.width && header.height;
+        }
+        return false;
+    }
+
+    // LZSS with a ring dictionary that carries over between calls: a flag byte for every 8 items, literals are one
+    // byte, matches a 12 bit dictionary position and 4 bit length, with an extra length byte when that's 15.
+    bool DecompressSlide(const u8 *in, usize in_size, u8 *out, usize out_size, u8 *text, u32 &r, usize *out_len) {
+        const u8 *end = in + in_size;
+        usize written = 0;
+        u32 flags = 0;
+        while (in < end) {
+            flags >>= 1;
+            if (!(flags & 0x100)) {
+                flags = *in++ | 0xff00;
+                if (in == end) break;
+            }
+            if (flags & 1) {
+                if (end - in < 2) return false;
+                u32 pos = in[0] | (in[1] & 0x0F) << 8;
+                u32 len = (in[1] >> 4) + 3;
+                in += 2;
+                if (len == 18) {
+                    if (in == end) return false;
+                    len += *in++;
+                }
+                if (len > out_size - written) return false;
+                for (u32 i = 0; i < len; ++i) {
+                    const u8 c = text[pos];
+                    out[written++] = c;
+                    text[r] = c;
+                    pos = (pos + 1) & (SlideSize - 1);
+                    r = (r + 1) & (SlideSize - 1);
+                }
+            } else {
+                if (written == out_size) return false;
+                out[written++] = text[r] = *in++;
+                r = (r + 1) & (SlideSize - 1);
+            }
+        }
+        *out_len = written;
+        return true;
+    }
+
+    bool DecodeTlg5(const Header &header, u8 *dst) {
+        const u8 *src = header.data;
+        const u8 *end = header.data + header.size;
+        const u32 width = header.width, height = header.height;
+        const u32 block_height = std::min(header.block_height, height);
+
+        // Compressed size of each block, only needed for seeking.
+        const u32 block_count = (height - 1) / block_height + 1;
+        if ((usize)(end - src) < (usize)block_count * 4) return false;
+        src += (usize)block_count * 4;
+
+        const usize block_pixels = (usize)block_height * width;
+        std::vector<u8> channels[4];
+        for (u32 c = 0; c < header.colors; ++c) {
+            channels[c].resize(block_pixels);
+        }
+        std::vector<u8> text(SlideSize, 0);
+        u32 r = 0;
+
+        const usize stride = (usize)width * 4;
+        const std::vector<u8> zero_line(stride, 0);
+        for (u32 y0 = 0; y0 < height; y0 += block_height) {
+            const u32 y1 = (u32)std::min<u64>((u64)y0 + block_height, height);
+            const usize pixels = (usize)(y1 - y0) * width;
+
+            // Each channel is either LZSS compressed or stored, the dictionary runs on across channels and blocks.
+            for (u32 c = 0; c < header.colors; ++c) {
+                if (end - src < 5) return false;
+                const u8 stored = src[0];
+                const u32 size = Read32(src + 1);
+                src += 5;
+                if (size > (usize)(end - src)) return false;
+
+                usize written;
+                if (stored) {
+                    written = std::min<usize>(size, block_pixels);
+                    memcpy(channels[c].data(), src, written);
+                } else if (!DecompressSlide(src, size, channels[c].data(), block_pixels, text.data(), r, &written)) {
+                    return false;
+                }
+                if (written < pixels) return false;
+                src += size;
+            }
+
+            // Channels are stored as differences from the pixel above and the pixel to the left, with green
+            // subtracted from blue and red.
+            for (u32 y = y0; y < y1; ++y) {
+                const u8 *above = y ? dst + (usize)(y - 1) * stride : zero_line.data();
+                u8 *row = dst + (usize)y * stride;
+                const usize offset = (usize)(y - y0) * width;
+                const u8 *in_b = channels[0].data() + offset;
+                const u8 *in_g = channels[1].data() + offset;
+                const u8 *in_r = channels[2].data() + offset;
+                const u8 *in_a = header.colors == 4 ? channels[3].data() + offset : nullptr;
+                u8 sum_r = 0, sum_g = 0, sum_b = 0, sum_a = 0;
+                for (u32 x = 0; x < width; ++x) {
+                    const u8 g = in_g[x];
+                    sum_r += (u8)(in_r[x] + g);
+                    sum_g += g;
+                    sum_b += (u8)(in_b[x] + g);
+                    row[x * 4 + 0] = (u8)(sum_r + above[x * 4 + 0]);
+                    row[x * 4 + 1] = (u8)(sum_g + above[x * 4 + 1]);
+                    row[x * 4 + 2] = (u8)(sum_b + above[x * 4 + 2]);
+                    if (in_a) {
+                        sum_a += in_a[x];
+                        row[x * 4 + 3] = (u8)(sum_a + above[x * 4 + 3]);
+                    } else {
+                        row[x * 4 + 3] = 0xFF;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Golomb parameter k for a running sum of recent magnitudes and position in the current group of four values,
+    // stored as how many sums in a row share each k from 0 to 8.
+    const u16 GolombCompressed[GolombNCount][9] = {
+        {3, 7, 15, 27, 63, 108, 223, 448, 130},
+        {3, 5, 13, 24, 51, 95, 192, 384, 257},
+        {2, 5, 12, 21, 39, 86, 155, 320, 384},
+        {2, 3, 9, 18, 33, 61, 129, 258, 511},
+    };
+    constexpr int GolombSums = GolombNCount * 2 * 128;
+
+    struct GolombTable {
+        u8 k[GolombSums][GolombNCount];
+
+        GolombTable() {
+            for (int n = 0; n < GolombNCount; ++n) {
+                int a = 0;
+                for (int i = 0; i < 9; ++i) {
+                    for (int j = 0; j < GolombCompressed[n][i]; ++j) {
+                        k[a++][n] = (u8)i;
+                    }
+                }
+            }
+        }
+    };
+    const GolombTable Golomb;
+
+    // LSB first bit reader. Reads 32 bits at a time, the buffer needs BitsPadding bytes after the last real one.
+    struct BitReader {
+        const u8 *p;
+        u32 bit;
+
+        u32 Peek() const { return Read32(p) >> bit; }
+        void Skip(u32 count) {
+            bit += count;
+            p += bit >> 3;
+            bit &= 7;
+        }
+    };
+
+    // One channel of a row of blocks' residuals, in runs that alternate between zeros and Golomb coded values. The
+    // first channel clears the other bytes of each pixel. Run lengths are Elias gamma coded.
+    bool DecodeGolomb(const u8 *bits, const u8 *bits_end, u8 *pixels, u32 pixel_count, u32 channel) {
+        BitReader reader = { bits, 1 };
+        bool zero = !(bits[0] & 1);
+        int n = GolombNCount - 1;
+        int a = 0;
+
+        u8 *pixel = pixels;
+        u8 *const last = pixels + (usize)pixel_count * 4;
+        while (pixel < last) {
+            u32 zeros = 0, t;
+            while ((t = reader.Peek()) == 0) {
+                zeros += 32 - reader.bit;
+                reader.Skip(32 - reader.bit);
+                if (reader.p > bits_end) return false;
+            }
+            const u32 lead = std::countr_zero(t);
+            zeros += lead;
+            reader.Skip(lead + 1);
+            if (zeros > 24) return false;
+            u32 count = (1u << zeros) + (reader.Peek() & ((1u << zeros) - 1));
+            reader.Skip(zeros);
+            if (count > (usize)(last - pixel) / 4) return false;
+
+            if (zero) {
+                for (; count; --count, pixel += 4) {
+                    if (channel == 0) {
+                        memset(pixel, 0, 4);
+                    } else {
+                        pixel[channel] = 0;
+                    }
+                }
+            } else {
+                for (; count; --count, pixel += 4) {
+                    const u32 k = Golomb.k[a][n];
+                    t = reader.Peek();
+                    u32 quotient;
+                    if (t) {
+                        quotient = std::countr_zero(t);
+                        reader.Skip(quotient + 1);
+                    } else {
+                        // Escape for long quotients: skip to the 5th byte, which holds it.
+                        reader.p += 5;
+                        quotient = reader.p[-1];
+                        reader.bit = 0;
+                    }
+                    u32 v = (quotient << k) + (reader.Peek() & ((1u << k) - 1));
+                    reader.Skip(k);
+
+                    // Zig-zag: odd values are positive, even ones negative, 0 never occurs inside a run.
+                    const int sign = (int)(v & 1) - 1;
+                    v >>= 1;
+                    a += (int)v;
+                    const u8 value = (u8)(((int)v ^ sign) + sign + 1);
+                    if (channel == 0) {
+                        pixel[0] = value;
+                        pixel[1] = pixel[2] = pixel[3] = 0;
+                    } else {
+                        pixel[channel] = value;
+                    }
+
+                    if (--n < 0) {
+                        a >>= 1;
+                        n = GolombNCount - 1;
+                    }
+                    if (reader.p > bits_end || a >= GolombSums) return false;
+                }
+            }
+            zero = !zero;
+        }
+        return true;
+    }
+
+    // How each of the 16 color filters rebuilds the blue, green and red residuals from the stored ones, which had
+    // other channels subtracted from them to decorrelate.
+    template <typename V, typename Add>
+    inline void Unfilter(u32 code, V ib, V ig, V ir, V &b, V &g, V &r, Add add) {
+        switch (code) {
+            case 0: b = ib; g = ig; r = ir; break;
+            case 1: b = add(ib, ig); g = ig; r = add(ir, ig); break;
+            case 2: b = ib; g = add(ig, ib); r = add(ir, g); break;
+            case 3: g = add(ig, ir); b = add(ib, g); r = ir; break;
+            case 4: b = add(ib, ir); g = add(ig, b); r = add(ir, g); break;
+            case 5: b = add(ib, ir); g = add(ig, b); r = ir; break;
+            case 6: b = add(ib, ig); g = ig; r = ir; break;
+            case 7: b = ib; g = add(ig, ib); r = ir; break;
+            case 8: b = ib; g = ig; r = add(ir, ig); break;
+            case 9: r = add(ir, ib); g = add(ig, r); b = add(add(ib, ig), add(ir, ib)); break;
+            case 10: b = add(ib, ir); g = add(ig, ir); r = ir; break;
+            case 11: b = ib; g = add(ig, ib); r = add(ir, ib); break;
+            case 12: b = ib; r = add(ir, ib); g = add(ig, r); break;
+            case 13: b = add(ib, ig); r = add(ir, b); g = add(ig, r); break;
+            case 14: g = add(ig, ir); b = add(ib, g); r = add(ir, b); break;
+            default: b = ib; g = add(ig, add(ib, ib)); r = add(ir, add(ib, ib)); break;
+        }
+    }
+
+    // Applies color filter `code` to a block row of 8 B, G, R, A residuals, turning them into R, G, B, A.
+    void UnfilterRow(u32 code, u32 *values) {
+#if defined(RD_TLG_SSE2)
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+        auto add = [](__m128i x, __m128i y) { return _mm_add_epi8(x, y); };
+        for (u32 i = 0; i < BlockSize; i += 4) {
+            const __m128i x = _mm_loadu_si128((const __m128i*)(values + i));
+            __m128i b, g, r;
+            Unfilter(code, _mm_and_si128(x, mask), _mm_and_si128(_mm_srli_epi32(x, 8), mask),
+                     _mm_and_si128(_mm_srli_epi32(x, 16), mask), b, g, r, add);
+            const __m128i out = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                                             _mm_or_si128(_mm_slli_epi32(b, 16), _mm_and_si128(x, alpha_mask)));
+            _mm_storeu_si128((__m128i*)(values + i), out);
+        }
+#elif defined(RD_TLG_NEON)
+        const uint32x4_t mask = vdupq_n_u32(0xFF);
+        const uint32x4_t alpha_mask = vdupq_n_u32(0xFF000000);
+        auto add = [](uint32x4_t x, uint32x4_t y) {
+            return vreinterpretq_u32_u8(vaddq_u8(vreinterpretq_u8_u32(x), vreinterpretq_u8_u32(y)));
+        };
+        for (u32 i = 0; i < BlockSize; i += 4) {
+            const uint32x4_t x = vld1q_u32(values + i);
+            uint32x4_t b, g, r;
+            Unfilter(code, vandq_u32(x, mask), vandq_u32(vshrq_n_u32(x, 8), mask), vandq_u32(vshrq_n_u32(x, 16), mask),
+                     b, g, r, add);
+            vst1q_u32(values + i, vorrq_u32(vorrq_u32(r, vshlq_n_u32(g, 8)),
+                                            vorrq_u32(vshlq_n_u32(b, 16), vandq_u32(x, alpha_mask))));
+        }
+#else
+        auto add = [](u32 x, u32 y) { return (x + y) & 0xFF; };
+        for (u32 i = 0; i < BlockSize; ++i) {
+            const u32 x = values[i];
+            u32 b, g, r;
+            Unfilter(code, x & 0xFF, (x >> 8) & 0xFF, (x >> 16) & 0xFF, b, g, r, add);
+            values[i] = r | g << 8 | b << 16 | (x & 0xFF000000);
+        }
+#endif
+    }
+
+    // The predictors work on all four channels of a pixel at once, packed in a u32.
+
+    // 0xFF in each byte where a > b.
+    inline u32 GreaterMask(u32 a, u32 b) {
+        const u32 t = ((a & ~b) + (((a ^ ~b) >> 1) & 0x7F7F7F7F)) & 0x80808080;
+        return ((t >> 7) + 0x7F7F7F7F) ^ 0x7F7F7F7F;
+    }
+
+    inline u32 AddBytes(u32 a, u32 b) {
+        const u32 carries = (((a & b) << 1) + ((a ^ b) & 0xFEFEFEFE)) & 0x01010100;
+        return a + b - carries;
+    }
+
+    // Median edge detector: min(left, up) if the upper left pixel is above both, max if below, else left + up - upper left.
+    inline u32 Med(u32 left, u32 up, u32 up_left) {
+        const u32 swap = (left ^ up) & GreaterMask(left, up);
+        const u32 lo = swap ^ left;
+        const u32 hi = swap ^ up;
+        const u32 above = GreaterMask(up_left, hi);
+        const u32 below = GreaterMask(lo, up_left);
+        const u32 between = ~(above | below);
+        return (above & lo) | (below & hi) | ((hi & between) - (up_left & between) + (lo & between));
+    }
+
+    // Rounded up average of the left and upper pixel.
+    inline u32 Avg(u32 left, u32 up) {
+        return (left & up) + (((left ^ up) & 0xFEFEFEFE) >> 1) + ((left ^ up) & 0x01010101);
+    }
+
+    struct Tlg6Rows {
+        const Header &header;
+        u32 x_blocks;
+        // Left and upper left of the first pixel in a row and the row above the image.
+        u32 initial;
+        const std::vector<u32> &zero_line;
+    };
+
+    // Turns one row of blocks' residuals into pixels. Within a block, rows alternate direction and odd blocks are
+    // stored bottom up.
+    void ReconstructRows(const Tlg6Rows &image, const u8 *filters, const u8 *residuals, u32 y0, u32 y1, u8 *dst) {
+        const u32 width = image.header.width;
+        const usize stride = (usize)width * 4;
+        const u32 rows = y1 - y0;
+        for (u32 y = y0; y < y1; ++y) {
+            const u8 *above = y ? dst + (usize)(y - 1) * stride : (const u8*)image.zero_line.data();
+            u8 *row = dst + (usize)y * stride;
+            const u32 r = y - y0;
+            u32 left = image.initial, up_left = image.initial;
+            for (u32 i = 0; i < image.x_blocks; ++i) {
+                const u32 x0 = i * BlockSize;
+                const u32 w = std::min(BlockSize, width - x0);
+                const u8 *in = residuals + ((usize)i * rows * BlockSize + (usize)((i & 1) ? rows - 1 - r : r) * w) * 4;
+
+                u32 delta[BlockSize] = {};
+                for (u32 x = 0; x < w; ++x) {
+                    memcpy(&delta[x], in + ((y & 1) ? w - 1 - x : x) * 4, 4);
+                }
+                if (image.header.colors == 1) {
+                    for (u32 x = 0; x < w; ++x) {
+                        delta[x] = (delta[x] & 0xFF) * 0x010101;
+                    }
+                } else {
+                    UnfilterRow(filters[i] >> 1, delta);
+                }
+
+                const bool average = filters[i] & 1;
+                for (u32 x = 0; x < w; ++x) {
+                    const u32 up = Read32(above + (usize)(x0 + x) * 4);
+                    left = AddBytes(average ? Avg(left, up) : Med(left, up, up_left), delta[x]);
+                    up_left = up;
+                    memcpy(row + (usize)(x0 + x) * 4, &left, 4);
+                }
+            }
+        }
+    }
+
+    bool DecodeTlg6(const Header &header, u8 *dst) {
+        const u8 *src = header.data;
+        const u8 *end = header.data + header.size;
+        const u32 width = header.width, height = header.height;
+        const u32 x_blocks = (width - 1) / BlockSize + 1;
+        const u32 y_blocks = (height - 1) / BlockSize + 1;
+
+        // One filter code per block, bit 0 picks the predictor and the rest the color filter. The dictionary starts
+        // out filled with every pair of a color filter and predictor byte pattern.
+        std::vector<u8> filters((usize)x_blocks * y_blocks);
+        if (end - src < 4) return false;
+        const u32 filters_size = Read32(src);
+        src += 4;
+        if (filters_size > (usize)(end - src)) return false;
+        u8 text[SlideSize];
+        for (u32 i = 0, pos = 0; i < 32; ++i) {
+            for (u32 j = 0; j < 16; ++j, pos += 8) {
+                memset(text + pos, (int)i, 4);
+                memset(text + pos + 4, (int)j, 4);
+            }
+        }
+        u32 r = 0;
+        usize written;
+        if (!DecompressSlide(src, filters_size, filters.data(), filters.size(), text, r, &written) || written != filters.size()) {
+            return false;
+        }
+        src += filters_size;
+        if (std::any_of(filters.begin(), filters.end(), [](u8 code) { return code >= 32; })) return false;
+
+        // Golomb coded bits of each row of blocks and channel, found up front so rows can be decoded independently.
+        struct Bits {
+            const u8 *data;
+            u32 size;
+        };
+        std::vector<Bits> bits((usize)y_blocks * header.colors);
+        u32 max_size = 0;
+        for (Bits &entry : bits) {
+            if (end - src < 4) return false;
+            const u32 value = Read32(src);
+            src += 4;
+            const u32 method = value >> 30;
+            const u32 size = ((value & 0x3FFFFFFF) + 7) / 8;
+            // Golomb coding is the only method ever defined.
+            if (method != 0 || size == 0 || size > (usize)(end - src)) return false;
+            entry = { src, size };
+            max_size = std::max(max_size, size);
+            src += size;
+        }
+
+        // Without alpha, it comes out of the prediction as opaque.
+        const u32 initial = header.colors == 4 ? 0 : 0xFF000000;
+        const std::vector<u32> zero_line(width, initial);
+        const Tlg6Rows image = { header, x_blocks, initial, zero_line };
+
+        std::atomic<u32> next = 0;
+        std::atomic<bool> failed = false;
+        std::mutex mutex;
+        std::condition_variable reconstructed_cv;
+        u32 reconstructed = 0;
+        auto worker = [&]() {
+            std::vector<u8> residuals((usize)width * BlockSize * 4);
+            std::vector<u8> padded(max_size + BitsPadding);
+            for (u32 block_row = next++; block_row < y_blocks; block_row = next++) {
+                const u32 y0 = block_row * BlockSize;
+                const u32 y1 = std::min(y0 + BlockSize, height);
+                bool ok = !failed;
+                for (u32 c = 0; ok && c < header.colors; ++c) {
+                    const Bits &entry = bits[(usize)block_row * header.colors + c];
+                    memcpy(padded.data(), entry.data, entry.size);
+                    memset(padded.data() + entry.size, 0, BitsPadding);
+                    ok = DecodeGolomb(padded.data(), padded.data() + entry.size, residuals.data(), (y1 - y0) * width, c);
+                }
+
+                // Prediction needs the row above, so rows of blocks are put together in order while the next ones are
+                // still being Golomb decoded.
+                std::unique_lock lock(mutex);
+                reconstructed_cv.wait(lock, [&]() { return reconstructed == block_row; });
+                lock.unlock();
+                if (ok && !failed) {
+                    ReconstructRows(image, filters.data() + (usize)block_row * x_blocks, residuals.data(), y0, y1, dst);
+                } else {
+                    failed = true;
+                }
+                lock.lock();
+                reconstructed++;
+                lock.unlock();
+                reconstructed_cv.notify_all();
+            }
+        };
+
+        u32 thread_count = 1;
+        if ((u64)width * height >= ThreadedPixels) {
+            thread_count = std::min<u32>(std::max(1u, std::thread::hardware_concurrency()), y_blocks);
+        }
+        std::vector<std::thread> workers;
+        for (u32 i = 1; i < thread_count; ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : workers) {
+            thread.join();
+        }
+        return !failed;
+    }
+}
+
+bool TLGDecode::ReadSize(const u8 *src, usize src_size, u32 *width, u32 *height) {
+    Header header;
+    if (!ReadHeader(src, src_size, header)) return false;
+    *width = header.width;
+    *height = header.height;
+    return true;
+}
+
+bool TLGDecode::DecodeRGBA8(const u8 *src, usize src_size, u8 *dst) {
+    Header header;
+    if (!ReadHeader(src, src_size, header)) return false;
+    return header.version == Version::Tlg5 ? DecodeTlg5(header, dst) : DecodeTlg6(header, dst);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <util/int.h>
+
+// Decoding of KiriKiri's TLG images: TLG5 (LZSS compressed per channel deltas), TLG6 (Golomb coded residuals of
+// filtered 8x8 blocks) and the TLG0 "sds" container that wraps either of them with tags.
+namespace TLGDecode {
+    // Reads the image size, false if `src` isn't a TLG image the decoder can handle.
+    bool ReadSize(const u8 *src, usize src_size, u32 *width, u32 *height);
+
+    // Decodes into tightly packed RGBA8 at `dst`, which must hold width * height * 4 bytes. Large TLG6 images have the
+    // Golomb decoding of their rows of blocks split across threads.
+    bool DecodeRGBA8(const u8 *src, usize src_size, u8 *dst);
+}
@@ -0,0 +1,384 @@
+#pragma once
+
+#include "RDSquirrelLib.h"
+#include <ArchiveFormats/Decompress.h>
+#include <util/Inflate.h>
+#include <util/KeyStream.h>
+#include <util/Text.h>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Native versions of the per-byte loops format scripts need (decryption, decompression, name decoding, index
+// parsing), so those run at native speed and only the format logic stays in Squirrel. Functions that transform data
+// work on std blobs in place, functions that only read also accept buffer views.
+namespace RDSquirrelLib {
+    // Bytes of the blob or buffer view at `idx`, throws into the VM on anything else.
+    static inline bool GetBytes(HSQUIRRELVM vm, SQInteger idx, const u8 **data, usize *size) {
+        if (BufferView *view = GetView(vm, idx)) {
+            *data = Resolve(*view);
+            *size = view->size;
+            if (!*data) {
+                sq_throwerror(vm, "Buffer is no longer available");
+                return false;
+            }
+            return true;
+        }
+
+        SQUserPointer blob;
+        if (sq_gettype(vm, idx) == OT_INSTANCE && SQ_SUCCEEDED(sqstd_getblob(vm, idx, &blob))) {
+            *data = (const u8*)blob;
+            *size = sqstd_getblobsize(vm, idx);
+            return true;
+        }
+
+        sq_throwerror(vm, "Expected a blob or buffer");
+        return false;
+    }
+
+    static inline bool GetBlob(HSQUIRRELVM vm, SQInteger idx, u8 **data, usize *size) {
+        SQUserPointer blob;
+        if (sq_gettype(vm, idx) != OT_INSTANCE || SQ_FAILED(sqstd_getblob(vm, idx, &blob))) {
+            sq_throwerror(vm, "Expected a blob");
+            return false;
+        }
+        *data = (u8*)blob;
+        *size = sqstd_getblobsize(vm, idx);
+        return true;
+    }
+
+    // A key is a string, blob or buffer of key bytes, or an integer for a single byte key.
+    static inline bool GetKey(HSQUIRRELVM vm, SQInteger idx, std::vector<u8> &key) {
+        SQInteger byte;
+        const SQChar *text;
+        SQInteger length;
+        if (sq_gettype(vm, idx) == OT_INTEGER && SQ_SUCCEEDED(sq_getinteger(vm, idx, &byte))) {
+            key.assign(1, (u8)byte);
+        } else if (sq_gettype(vm, idx) == OT_STRING && SQ_SUCCEEDED(sq_getstringandsize(vm, idx, &text, &length))) {
+            key.assign((const u8*)text, (const u8*)text + length);
+        } else {
+            const u8 *data;
+            usize size;
+            if (!GetBytes(vm, idx, &data, &size)) return false;
+            key.assign(data, data + size);
+        }
+
+        if (key.empty()) {
+            sq_throwerror(vm, "Key is empty");
+            return false;
+        }
+        return true;
+    }
+
+    static inline SQInteger OptionalInteger(HSQUIRRELVM vm, SQInteger idx, SQInteger fallback) {
+        SQInteger value;
+        if (sq_gettop(vm) < idx || SQ_FAILED(sq_getinteger(vm, idx, &value))) return fallback;
+        return value;
+    }
+
+    // xor_key(blob, key, key_offset = 0): XORs the blob with the repeating key, starting `key_offset` bytes into it.
+    static inline SQInteger xor_key(HSQUIRRELVM vm) {
+        u8 *data;
+        usize size;
+        std::vector<u8> key;
+        if (!GetBlob(vm, 2, &data, &size) || !GetKey(vm, 3, key)) return SQ_ERROR;
+
+        XorKeyStream stream(key.data(), key.size());
+        stream.Apply(data, size, (u64)OptionalInteger(vm, 4, 0));
+        return 0;
+    }
+
+    template <bool Subtract>
+    static inline SQInteger add_key(HSQUIRRELVM vm) {
+        u8 *data;
+        usize size;
+        std::vector<u8> key;
+        if (!GetBlob(vm, 2, &data, &size) || !GetKey(vm, 3, key)) return SQ_ERROR;
+
+        usize phase = (usize)OptionalInteger(vm, 4, 0) % key.size();
+        if (key.size() == 1) {
+            // Single byte keys are the common case and vectorise as a plain loop.
+            u8 k = key[0];
+            for (usize i = 0; i < size; ++i) data[i] = Subtract ? data[i] - k : data[i] + k;
+            return 0;
+        }
+        for (usize i = 0; i < size; ++i) {
+            data[i] = Subtract ? data[i] - key[phase] : data[i] + key[phase];
+            if (++phase == key.size()) phase = 0;
+        }
+        return 0;
+    }
+
+    // inflate(src, unpacked_size, raw = false): a new blob with the zlib (or raw deflate) stream in `src` inflated.
+    static inline SQInteger inflate(HSQUIRRELVM vm) {
+        const u8 *data;
+        usize size;
+        SQInteger unpacked_size;
+        if (!GetBytes(vm, 2, &data, &size)) return SQ_ERROR;
+        if (SQ_FAILED(sq_getinteger(vm, 3, &unpacked_size)) || unpacked_size < 0)
+            return sq_throwerror(vm, "Expected the unpacked size");
+
+        SQBool raw = SQFalse;
+        if (sq_gettop(vm) >= 4) sq_getbool(vm, 4, &raw);
+
+        u8 *out = (u8*)sqstd_createblob(vm, unpacked_size);
+        if (!out) return sq_throwerror(vm, "Failed to allocate blob");
+        usize written = InflateContext::ForThread().Inflate(data, size, out, unpacked_size, raw ? -MAX_WBITS : MAX_WBITS);
+        if (written != (usize)unpacked_size) return sq_throwerror(vm, "Inflate failed");
+        return 1;
+    }
+
+    // lzss_decode(src, unpacked_size): a new blob with classic 4K ring LZSS data in `src` decoded.
+    static inline SQInteger lzss_decode(HSQUIRRELVM vm) {
+        const u8 *data;
+        usize size;
+        SQInteger unpacked_size;
+        if (!GetBytes(vm, 2, &data, &size)) return SQ_ERROR;
+        if (SQ_FAILED(sq_getinteger(vm, 3, &unpacked_size)) || unpacked_size < 0)
+            return sq_throwerror(vm, "Expected the unpacked size");
+
+        u8 *out = (u8*)sqstd_createblob(vm, unpacked_size);
+        if (!out) return sq_throwerror(vm, "Failed to allocate blob");
+        if (LzssDecode(data, size, out, unpacked_size) != (usize)unpacked_size) return sq_throwerror(vm, "LZSS data is truncated");
+        return 1;
+    }
+
+    // The text at [offset, offset + length) of the source at index 2, length -1 meaning up to the end.
+    static inline bool GetText(HSQUIRRELVM vm, const u8 **text, usize *length) {
+        const u8 *data;
+        usize size;
+        if (!GetBytes(vm, 2, &data, &size)) return false;
+
+        SQInteger offset = OptionalInteger(vm, 3, 0);
+        SQInteger count = OptionalInteger(vm, 4, -1);
+        if (offset < 0 || (usize)offset > size || (count >= 0 && (u64)offset + count > size)) {
+            sq_throwerror(vm, "Read out of bounds");
+            return false;
+        }
+        *text = data + offset;
+        *length = count >= 0 ? (usize)count : size - offset;
+        return true;
+    }
+
+    // Appends UTF-16LE code units to `out` as UTF-8, up to the first NUL. Unpaired surrogates become U+FFFD.
+    static inline void AppendUTF16LE(std::string &out, const u8 *data, usize length) {
+        auto append = [&](u32 c) {
+            if (c < 0x80) {
+                out += (char)c;
+            } else if (c < 0x800) {
+                out += (char)(0xC0 | (c >> 6));
+                out += (char)(0x80 | (c & 0x3F));
+            } else if (c < 0x10000) {
+                out += (char)(0xE0 | (c >> 12));
+                out += (char)(0x80 | ((c >> 6) & 0x3F));
+                out += (char)(0x80 | (c & 0x3F));
+            } else {
+                out += (char)(0xF0 | (c >> 18));
+                out += (char)(0x80 | ((c >> 12) & 0x3F));
+                out += (char)(0x80 | ((c >> 6) & 0x3F));
+                out += (char)(0x80 | (c & 0x3F));
+            }
+        };
+
+        for (usize i = 0; i + 1 < length; i += 2) {
+            u32 unit = data[i] | (data[i + 1] << 8);
+            if (unit == 0) break;
+
+            if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < length) {
+                u32 low = data[i + 2] | (data[i + 3] << 8);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    append(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                    i += 2;
+                    continue;
+                }
+            }
+            append(unit >= 0xD800 && unit < 0xE000 ? 0xFFFD : unit);
+        }
+    }
+
+    // decode_utf16(src, offset = 0, length = -1): a UTF-16LE name as a string, stopping at the first NUL.
+    static inline SQInteger decode_utf16(HSQUIRRELVM vm) {
+        const u8 *text;
+        usize length;
+        if (!GetText(vm, &text, &length)) return SQ_ERROR;
+
+        std::string out;
+        AppendUTF16LE(out, text, length);
+        sq_pushstring(vm, out.c_str(), out.size());
+        return 1;
+    }
+
+    // decode_sjis(src, offset = 0, length = -1): a Shift-JIS name as a string, stopping at the first NUL.
+    static inline SQInteger decode_sjis(HSQUIRRELVM vm) {
+        const u8 *text;
+        usize length;
+        if (!GetText(vm, &text, &length)) return SQ_ERROR;
+
+        std::string sjis((const char*)text, std::find(text, text + length, 0) - text);
+        std::string out = TextConverter::ShiftJISToUTF8(sjis);
+        // Plain ASCII passes through even where there's no converter.
+        if (out.empty() && std::all_of(sjis.begin(), sjis.end(), [](char c) { return (u8)c < 0x80; })) out = sjis;
+        sq_pushstring(vm, out.c_str(), out.size());
+        return 1;
+    }
+
+    // One field of a read_structs layout.
+    struct StructField {
+        enum Kind { Unsigned, Signed, Float, String, UTF16, Skip } kind;
+        std::string name;
+        usize size;
+    };
+
+    // Layouts are whitespace separated `name:type` pairs. Types are u8/u16/u32/u64, i8/i16/i32/i64, f32, sN for an N
+    // byte NUL padded string, wN for an N byte UTF-16LE string and xN (no name) to skip N bytes.
+    static inline bool ParseLayout(std::string_view layout, std::vector<StructField> &fields, usize &record_size) {
+        record_size = 0;
+        usize pos = 0;
+        while (pos < layout.size()) {
+            while (pos < layout.size() && isspace((u8)layout[pos])) pos++;
+            if (pos >= layout.size()) break;
+            usize end = pos;
+            while (end < layout.size() && !isspace((u8)layout[end])) end++;
+            std::string_view token = layout.substr(pos, end - pos);
+            pos = end;
+
+            usize colon = token.find(':');
+            std::string_view name = colon == std::string_view::npos ? std::string_view() : token.substr(0, colon);
+            std::string_view type = colon == std::string_view::npos ? token : token.substr(colon + 1);
+            if (type.size() < 2) return false;
+
+            usize count = 0;
+            for (char c : type.substr(1)) {
+                if (c < '0' || c > '9') return false;
+                count = count * 10 + (c - '0');
+                // Keeps the record size from wrapping.
+                if (count > UINT32_MAX) return false;
+            }
+
+            StructField field = { StructField::Skip, std::string(name), 0 };
+            switch (type[0]) {
+                case 'u': field.kind = StructField::Unsigned; field.size = count / 8; break;
+                case 'i': field.kind = StructField::Signed; field.size = count / 8; break;
+                case 'f': field.kind = StructField::Float; field.size = count / 8; break;
+                case 's': field.kind = StructField::String; field.size = count; break;
+                case 'w': field.kind = StructField::UTF16; field.size = count; break;
+                case 'x': field.kind = StructField::Skip; field.size = count; break;
+                default: return false;
+            }
+
+            bool integer = field.kind == StructField::Unsigned || field.kind == StructField::Signed;
+            if (integer && field.size != 1 && field.size != 2 && field.size != 4 && field.size != 8) return false;
+            if (field.kind == StructField::Float && field.size != 4) return false;
+            if (field.kind != StructField::Skip && field.name.empty()) return false;
+
+            record_size += field.size;
+            fields.push_back(std::move(field));
+        }
+        return record_size > 0;
+    }
+
+    static inline void PushField(HSQUIRRELVM vm, const StructField &field, const u8 *data) {
+        switch (field.kind) {
+            case StructField::Unsigned:
+            case StructField::Signed: {
+                u64 value = 0;
+                memcpy(&value, data, field.size);
+                if (field.kind == StructField::Signed && field.size < 8) {
+                    u32 shift = 64 - (u32)field.size * 8;
+                    value = (u64)((i64)(value << shift) >> shift);
+                }
+                sq_pushinteger(vm, (SQInteger)value);
+                break;
+            }
+            case StructField::Float: {
+                float value;
+                memcpy(&value, data, sizeof(value));
+                sq_pushfloat(vm, value);
+                break;
+            }
+            case StructField::String:
+                sq_pushstring(vm, (const SQChar*)data, std::find(data, data + field.size, 0) - data);
+                break;
+            case StructField::UTF16: {
+                std::string text;
+                AppendUTF16LE(text, data, field.size);
+                sq_pushstring(vm, text.c_str(), text.size());
+                break;
+            }
+            case StructField::Skip:
+                break;
+        }
+    }
+
+    // read_structs(src, offset, count, layout): an array of `count` tables read from back to back little endian
+    // records, for parsing a whole index in one call.
+    static inline SQInteger read_structs(HSQUIRRELVM vm) {
+        const u8 *data;
+        usize size;
+        SQInteger offset, count;
+        const SQChar *layout;
+        if (!GetBytes(vm, 2, &data, &size)) return SQ_ERROR;
+        if (SQ_FAILED(sq_getinteger(vm, 3, &offset)) || SQ_FAILED(sq_getinteger(vm, 4, &count)) ||
+            SQ_FAILED(sq_getstring(vm, 5, &layout))) {
+            return sq_throwerror(vm, "Expected offset, count and layout");
+        }
+
+        std::vector<StructField> fields;
+        usize record_size;
+        if (!ParseLayout(layout, fields, record_size)) return sq_throwerror(vm, "Invalid struct layout");
+        // Counts come from archive headers, the product could wrap.
+        if (offset < 0 || count < 0 || (usize)offset > size || (u64)count > (size - offset) / record_size) {
+            return sq_throwerror(vm, "Read out of bounds");
+        }
+
+        // Field names are pushed as string objects once and reused for every record.
+        std::vector<HSQOBJECT> keys(fields.size());
+        for (usize i = 0; i < fields.size(); ++i) {
+            sq_pushstring(vm, fields[i].name.c_str(), fields[i].name.size());
+            sq_getstackobj(vm, -1, &keys[i]);
+            sq_addref(vm, &keys[i]);
+            sq_pop(vm, 1);
+        }
+
+        sq_newarray(vm, 0);
+        const u8 *record = data + offset;
+        for (SQInteger n = 0; n < count; ++n, record += record_size) {
+            sq_newtable(vm);
+            const u8 *field_data = record;
+            for (usize i = 0; i < fields.size(); ++i) {
+                if (fields[i].kind != StructField::Skip) {
+                    sq_pushobject(vm, keys[i]);
+                    PushField(vm, fields[i], field_data);
+                    sq_rawset(vm, -3);
+                }
+                field_data += fields[i].size;
+            }
+            sq_arrayappend(vm, -2);
+        }
+
+        for (HSQOBJECT &key : keys) sq_release(vm, &key);
+        return 1;
+    }
+
+    static inline void RegisterFunction(HSQUIRRELVM vm, const SQChar *name, SQFUNCTION function) {
+        sq_pushstring(vm, name, -1);
+        sq_newclosure(vm, function, 0);
+        sq_newslot(vm, -3, SQFalse);
+    }
+
+    static inline void RegisterBulkFuncs(HSQUIRRELVM vm) {
+        sq_pushroottable(vm);
+
+        RegisterFunction(vm, SC("xor_key"), xor_key);
+        RegisterFunction(vm, SC("add_key"), add_key<false>);
+        RegisterFunction(vm, SC("sub_key"), add_key<true>);
+        RegisterFunction(vm, SC("inflate"), inflate);
+        RegisterFunction(vm, SC("lzss_decode"), lzss_decode);
+        RegisterFunction(vm, SC("decode_utf16"), decode_utf16);
+        RegisterFunction(vm, SC("decode_sjis"), decode_sjis);
+        RegisterFunction(vm, SC("read_structs"), read_structs);
+
+        sq_pop(vm, 1);
+    }
+}
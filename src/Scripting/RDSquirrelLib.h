@@ -1,54 +1,219 @@
+#pragma once
+
 #include "SQUtils.h"
 #include "squirrel.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 namespace RDSquirrelLib {
+    // Scripts get host memory (the archive, or the file being probed) as a read-only view instead of a raw pointer.
+    // A view only names a range of a live buffer, so reading or slicing one never copies, and the host can copy a
+    // view returned from OpenStream out of the archive in one go. Buffers are only live while the host call that
+    // handed them out runs, views a script keeps around after that read as empty.
+    struct BufferView {
+        u64 buffer;
+        u64 offset;
+        u64 size;
+    };
+
+    struct LiveBuffer {
+        u64 id;
+        const u8 *data;
+        u64 size;
+    };
+
+    // Tags BufferView userdata so other userdata can't be mistaken for one.
+    inline const int BufferViewTag = 0;
+
+    // Buffers currently handed out on this thread, innermost call last.
+    inline thread_local std::vector<LiveBuffer> live_buffers;
+    inline thread_local u64 next_buffer_id = 1;
+
+    static inline void PushView(HSQUIRRELVM vm, const BufferView &view) {
+        auto *data = (BufferView*)sq_newuserdata(vm, sizeof(BufferView));
+        *data = view;
+        sq_settypetag(vm, -1, (SQUserPointer)&BufferViewTag);
+    }
+
+    static inline BufferView *GetView(HSQUIRRELVM vm, SQInteger idx) {
+        if (sq_gettype(vm, idx) != OT_USERDATA) return nullptr;
+
+        SQUserPointer data, tag;
+        if (SQ_FAILED(sq_getuserdata(vm, idx, &data, &tag)) || tag != (SQUserPointer)&BufferViewTag) return nullptr;
+        return (BufferView*)data;
+    }
+
+    // The bytes a view covers, or nullptr once its buffer is gone.
+    static inline const u8 *Resolve(const BufferView &view) {
+        for (const LiveBuffer &live : live_buffers) {
+            if (live.id == view.buffer) {
+                return view.offset + view.size <= live.size ? live.data + view.offset : nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    // Hands `data` to scripts for the lifetime of this object, `object` is the view to pass them.
+    class ScopedBuffer {
+        HSQUIRRELVM vm;
+        u64 id;
+
+    public:
+        HSQOBJECT object;
+
+        ScopedBuffer(HSQUIRRELVM vm, const u8 *data, u64 size) : vm(vm), id(next_buffer_id++) {
+            live_buffers.push_back({id, data, size});
+            PushView(vm, {id, 0, size});
+            sq_getstackobj(vm, -1, &object);
+            sq_addref(vm, &object);
+            sq_pop(vm, 1);
+        }
+        ScopedBuffer(const ScopedBuffer&) = delete;
+        ScopedBuffer &operator=(const ScopedBuffer&) = delete;
+
+        ~ScopedBuffer() {
+            std::erase_if(live_buffers, [&](const LiveBuffer &live) { return live.id == id; });
+            sq_release(vm, &object);
+        }
+    };
+
+    // Reads the view at stack index 2 and the range given by the integer arguments after it. Throws into the VM and
+    // returns nullptr when anything is off.
+    static inline const u8 *GetRange(HSQUIRRELVM vm, SQInteger offset, SQInteger length, BufferView **view_out = nullptr) {
+        BufferView *view = GetView(vm, 2);
+        if (!view) {
+            sq_throwerror(vm, "Expected a buffer as first argument");
+            return nullptr;
+        }
+        if (offset < 0 || length < 0 || (u64)offset + (u64)length > view->size) {
+            sq_throwerror(vm, "Read out of bounds");
+            return nullptr;
+        }
+
+        const u8 *data = Resolve(*view);
+        if (!data) {
+            sq_throwerror(vm, "Buffer is no longer available");
+            return nullptr;
+        }
+        if (view_out) *view_out = view;
+        return data + offset;
+    }
+
     static inline SQInteger read_bytes(HSQUIRRELVM vm) {
-        SQUserPointer ptr;
         SQInteger offset, length;
+        if (SQ_FAILED(sq_getinteger(vm, 3, &offset)) || SQ_FAILED(sq_getinteger(vm, 4, &length)))
+            return sq_throwerror(vm, "Expected offset and length");
 
-        if (SQ_FAILED(sq_getuserpointer(vm, 2, &ptr))) return sq_throwerror(vm, "Expected userpointer as first argument");
-        sq_getinteger(vm, 3, &offset);
-        sq_getinteger(vm, 4, &length);
+        const u8 *data = GetRange(vm, offset, length);
+        if (!data) return SQ_ERROR;
 
-        u8* data = (u8*)ptr;
         sq_newarray(vm, 0);
         for (SQInteger i = 0; i < length; ++i) {
-            sq_pushinteger(vm, data[offset + i]);
+            sq_pushinteger(vm, data[i]);
             sq_arrayappend(vm, -2);
         }
         return 1;
     }
 
+    // A view of part of a buffer, returning one from OpenStream lets the host copy the entry straight out of it.
+    static inline SQInteger slice(HSQUIRRELVM vm) {
+        SQInteger offset, length;
+        if (SQ_FAILED(sq_getinteger(vm, 3, &offset)) || SQ_FAILED(sq_getinteger(vm, 4, &length)))
+            return sq_throwerror(vm, "Expected offset and length");
+
+        BufferView *view;
+        if (!GetRange(vm, offset, length, &view)) return SQ_ERROR;
+
+        PushView(vm, {view->buffer, view->offset + offset, (u64)length});
+        return 1;
+    }
+
+    // A mutable copy of part of a buffer as a std blob, for scripts that need to transform the bytes.
+    static inline SQInteger read_blob(HSQUIRRELVM vm) {
+        SQInteger offset, length;
+        if (SQ_FAILED(sq_getinteger(vm, 3, &offset)) || SQ_FAILED(sq_getinteger(vm, 4, &length)))
+            return sq_throwerror(vm, "Expected offset and length");
+
+        const u8 *data = GetRange(vm, offset, length);
+        if (!data) return SQ_ERROR;
+
+        SQUserPointer blob = sqstd_createblob(vm, length);
+        if (!blob) return sq_throwerror(vm, "Failed to allocate blob");
+        memcpy(blob, data, length);
+        return 1;
+    }
+
+    static inline SQInteger buffer_size(HSQUIRRELVM vm) {
+        BufferView *view = GetView(vm, 2);
+        if (!view) return sq_throwerror(vm, "Expected a buffer as first argument");
+
+        sq_pushinteger(vm, (SQInteger)view->size);
+        return 1;
+    }
+
     static inline SQInteger read_u16_le(HSQUIRRELVM vm) {
-        SQUserPointer ptr;
         SQInteger offset;
-
-        if (SQ_FAILED(sq_getuserpointer(vm, 2, &ptr)))
-            return sq_throwerror(vm, "Expected userpointer as first argument");
         if (SQ_FAILED(sq_getinteger(vm, 3, &offset)))
             return sq_throwerror(vm, "Expected offset as second argument");
 
-        u8* data = (u8*)ptr;
+        const u8 *data = GetRange(vm, offset, 2);
+        if (!data) return SQ_ERROR;
 
-        SQInteger value = data[offset] | (data[offset + 1] << 8);
+        SQInteger value = data[0] | (data[1] << 8);
 
         sq_pushinteger(vm, value);
         return 1;
     }
 
     static inline SQInteger read_u32_le(HSQUIRRELVM vm) {
-        SQUserPointer ptr;
         SQInteger offset;
+        if (SQ_FAILED(sq_getinteger(vm, 3, &offset)))
+            return sq_throwerror(vm, "Expected offset as second argument");
 
-        if (SQ_FAILED(sq_getuserpointer(vm, 2, &ptr))) return sq_throwerror(vm, "Expected userpointer as first argument");
-        sq_getinteger(vm, 3, &offset);
+        const u8 *data = GetRange(vm, offset, 4);
+        if (!data) return SQ_ERROR;
 
-        u8* data = (u8*)ptr;
-        SQInteger value = (data[offset + 3] << 24) | (data[offset + 2] << 16) | (data[offset + 1] << 8) | data[offset];
+        SQInteger value = ((SQInteger)data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
         sq_pushinteger(vm, value);
         return 1;
     }
 
+    // Copies what a script returned for an entry into `dst`: a buffer view, a std blob or, for older scripts, an array
+    // of byte values. Returns how many bytes were written, or -1 if the value at `idx` is none of those.
+    static inline i64 CopyStreamResult(HSQUIRRELVM vm, SQInteger idx, u8 *dst, usize capacity) {
+        if (BufferView *view = GetView(vm, idx)) {
+            const u8 *data = Resolve(*view);
+            if (!data) return -1;
+            usize count = (usize)std::min<u64>(view->size, capacity);
+            memcpy(dst, data, count);
+            return count;
+        }
+
+        SQUserPointer blob;
+        if (sq_gettype(vm, idx) == OT_INSTANCE && SQ_SUCCEEDED(sqstd_getblob(vm, idx, &blob))) {
+            usize count = std::min<usize>(sqstd_getblobsize(vm, idx), capacity);
+            memcpy(dst, blob, count);
+            return count;
+        }
+
+        if (sq_gettype(vm, idx) == OT_ARRAY) {
+            usize count = std::min<usize>(sq_getsize(vm, idx), capacity);
+            for (usize i = 0; i < count; ++i) {
+                sq_pushinteger(vm, i);
+                SQInteger value = 0;
+                if (SQ_SUCCEEDED(sq_rawget(vm, idx < 0 ? idx - 1 : idx))) {
+                    sq_getinteger(vm, -1, &value);
+                    sq_pop(vm, 1);
+                }
+                dst[i] = (u8)value;
+            }
+            return count;
+        }
+
+        return -1;
+    }
+
     static inline void RegisterAllFuncs(HSQUIRRELVM vm) {
         sq_pushroottable(vm);
 
@@ -64,6 +229,18 @@ namespace RDSquirrelLib {
         sq_newclosure(vm, RDSquirrelLib::read_u32_le, 0);
         sq_newslot(vm, -3, SQFalse);
 
+        sq_pushstring(vm, SC("slice"), -1);
+        sq_newclosure(vm, RDSquirrelLib::slice, 0);
+        sq_newslot(vm, -3, SQFalse);
+
+        sq_pushstring(vm, SC("read_blob"), -1);
+        sq_newclosure(vm, RDSquirrelLib::read_blob, 0);
+        sq_newslot(vm, -3, SQFalse);
+
+        sq_pushstring(vm, SC("buffer_size"), -1);
+        sq_newclosure(vm, RDSquirrelLib::buffer_size, 0);
+        sq_newslot(vm, -3, SQFalse);
+
         sq_pop(vm, 1);
     }
 }
@@ -91,10 +91,12 @@ struct SQUtils {
         // push function args
         push_all(vm, std::forward<Args>(args)...); // [table][function][this](...)
         if (SQ_FAILED(sq_call(vm, 1 + arg_count, SQTrue, SQTrue))) {
-            sq_pop(vm, 1);
+            sq_pop(vm, 2); // sq_call already popped the arguments, pop function and table
             return false;
         }
 
+        // [table][function][result] -> [result], pooled VMs are reused so nothing else may stay behind.
+        sq_remove(vm, -2);
         sq_remove(vm, -2);
         return true;
     }
@@ -107,6 +109,7 @@ struct SQUtils {
               sq_pop(vm, 1);
               return str;
           }
+          sq_pop(vm, 1);
         }
         return "";
     }
@@ -119,6 +122,7 @@ struct SQUtils {
               sq_pop(vm, 1);
               return num;
           }
+          sq_pop(vm, 1);
         }
         return 0;
     }
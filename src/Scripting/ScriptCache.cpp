@@ -0,0 +1,75 @@
+#include "ScriptCache.h"
+#include "squirrel.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// FNV-1a, only has to tell script versions apart.
+static u64 HashBytes(const char *data, usize size, u64 hash = 0xCBF29CE484222325ull) {
+    for (usize i = 0; i < size; ++i) {
+        hash ^= (u8)data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool ScriptCache::Load(HSQUIRRELVM vm, const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        Logger::error("Failed to open script: {}", path);
+        return false;
+    }
+    std::vector<char> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Bytecode stores integers, floats and characters at their native size.
+    const u32 layout[] = { SQUIRREL_VERSION_NUMBER, sizeof(SQInteger), sizeof(SQFloat), sizeof(SQChar) };
+    u64 hash = HashBytes(source.data(), source.size());
+    hash = HashBytes((const char*)layout, sizeof(layout), hash);
+
+    const fs::path script_path(path);
+    const fs::path cache_dir = script_path.parent_path() / ".cache";
+    const std::string stem = script_path.filename().string();
+    char cache_name[32];
+    snprintf(cache_name, sizeof(cache_name), ".%016llx.cnut", (unsigned long long)hash);
+    const fs::path cache_path = cache_dir / (stem + cache_name);
+
+    std::error_code ec;
+    if (fs::exists(cache_path, ec)) {
+        if (SQ_SUCCEEDED(sqstd_loadfile(vm, cache_path.string().c_str(), SQFalse))) {
+            hits++;
+            return true;
+        }
+        Logger::error("[Squirrel] Ignoring unreadable cache {}", cache_path.string());
+    }
+
+    if (SQ_FAILED(sq_compilebuffer(vm, source.data(), source.size(), path.c_str(), SQTrue))) {
+        return false;
+    }
+    misses++;
+
+    // Written under a temporary name first, so a cache file is either complete or absent.
+    const fs::path temp_path = fs::path(cache_path).concat(".tmp");
+    bool cached = false;
+    fs::create_directories(cache_dir, ec);
+    if (!ec && SQ_SUCCEEDED(sqstd_writeclosuretofile(vm, temp_path.string().c_str()))) {
+        // Drop the caches of older versions of this script.
+        for (const auto &entry : fs::directory_iterator(cache_dir, ec)) {
+            const std::string name = entry.path().filename().string();
+            if (name.size() == stem.size() + 22 && name.starts_with(stem + ".") && name.ends_with(".cnut")) {
+                fs::remove(entry.path(), ec);
+            }
+        }
+        fs::rename(temp_path, cache_path, ec);
+        cached = !ec;
+    }
+    if (!cached) {
+        fs::remove(temp_path, ec);
+        Logger::error("[Squirrel] Couldn't cache {}", path);
+    }
+    return true;
+}
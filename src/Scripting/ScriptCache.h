@@ -0,0 +1,17 @@
+#pragma once
+
+#include "SQUtils.h"
+#include <atomic>
+#include <string>
+
+// Compiled scripts are kept in a `.cache` directory next to the sources, named after the script and a hash of its
+// source plus everything the bytecode format depends on. A cached closure is only used if the name matches exactly, so
+// editing a script or updating Squirrel just compiles it again.
+struct ScriptCache {
+    // Pushes the compiled closure for the script at `path`, from the cache when it's fresh and compiling (and caching)
+    // it otherwise. Returns false with nothing pushed if the script doesn't compile.
+    static bool Load(HSQUIRRELVM vm, const std::string &path);
+
+    static inline std::atomic<u32> hits = 0;
+    static inline std::atomic<u32> misses = 0;
+};
@@ -1,21 +1,10 @@
-
 #include "ScriptManager.h"
 #include "SQUtils.h"
 #include "squirrel.h"
 
 bool ScriptManager::LoadFile(std::string path) {
     Logger::log("Loading {}...", path.c_str());
-
-    sq_pushroottable(vm);
-
-    if (SQ_FAILED(sqstd_dofile(vm, path.c_str(), SQFalse, SQTrue))) {
-        Logger::error("Failed to load script: {}", path.c_str());
-        sqstd_printcallstack(vm);
-        return false;
-    }
-
-    sq_pop(vm, 1);
-    return true;
+    return pool.AddScript(path, last_format);
 }
 
 // void DumpRootTable(HSQUIRRELVM vm) {
@@ -26,26 +15,28 @@ bool ScriptManager::LoadFile(std::string path) {
 // }
 
 SquirrelArchiveFormat* ScriptManager::Register() {
-    sq_pushroottable(vm);
-
-    sq_pushstring(vm, SC("archive_format"), -1);
-    if (SQ_FAILED(sq_get(vm, -2))) {
-        Logger::error("[Squirrel] 'archive_format' table not found in script!");
-        sq_pop(vm, 1);
+    if (last_format.empty()) {
+        Logger::error("[Squirrel] 'archive_format' table with a tag not found in script!");
         return nullptr;
     }
 
-    if (sq_gettype(vm, -1) != OT_TABLE) {
-        Logger::error("[Squirrel] 'archive_format' exists but is not a table!");
-        sq_pop(vm, 2);
-        return nullptr;
+    SquirrelVMPool::Lease lease = pool.Acquire();
+    const HSQOBJECT *table = lease.Format(last_format);
+    if (!table) return nullptr;
+
+    // Tag and description are read once here, so the UI never has to lease a VM for them.
+    HSQUIRRELVM vm = lease.vm();
+    std::string description = "GETDESC_FAIL";
+    sq_pushobject(vm, *table);
+    sq_pushstring(vm, SC("description"), -1);
+    if (SQ_SUCCEEDED(sq_get(vm, -2))) {
+        const SQChar *val;
+        if (SQ_SUCCEEDED(sq_getstring(vm, -1, &val))) description = val;
+        sq_pop(vm, 1);
     }
+    sq_pop(vm, 1);
 
-    HSQOBJECT table_obj;
-    sq_getstackobj(vm, -1, &table_obj);
-    sq_addref(vm, &table_obj);
-
-    sq_pop(vm, 2);
-
-    return new SquirrelArchiveFormat(vm, table_obj);
+    auto *format = new SquirrelArchiveFormat(&pool, last_format, description);
+    last_format.clear();
+    return format;
 }
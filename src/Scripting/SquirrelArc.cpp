@@ -1,10 +1,18 @@
 #include "SquirrelArc.h"
+#include "RDSquirrelLib.h"
 #include "squirrel.h"
+#include <util/memory.h>
 
 bool SquirrelArchiveFormat::CanHandleFile(u8 *buffer, u64 size, const std::string &ext) const {
     SQBool result;
 
-    if (!SQUtils::call_squirrel_function_in_table(vm, archive_format_table, "CanHandleFile", buffer, size, ext)) {
+    SquirrelVMPool::Lease lease = pool->Acquire();
+    const HSQOBJECT *table = lease.Format(tag);
+    if (!table) return false;
+    HSQUIRRELVM vm = lease.vm();
+
+    RDSquirrelLib::ScopedBuffer view(vm, buffer, size);
+    if (!SQUtils::call_squirrel_function_in_table(vm, *table, "CanHandleFile", view.object, size, ext)) {
         return false;
     }
 
@@ -18,31 +26,25 @@ bool SquirrelArchiveFormat::CanHandleFile(u8 *buffer, u64 size, const std::strin
 }
 
 ArchiveBase* SquirrelArchiveFormat::TryOpen(u8* buffer, u64 size, std::string file_name) {
-    HSQOBJECT result;
-
-    sq_pushobject(vm, archive_format_table);
-
-    if (!SQUtils::call_squirrel_function_in_table(vm, archive_format_table, "TryOpen", buffer, size, file_name)) {
-        sq_pop(vm, 1);
+    SquirrelVMPool::Lease lease = pool->Acquire();
+    const HSQOBJECT *table = lease.Format(tag);
+    if (!table) return nullptr;
+    HSQUIRRELVM vm = lease.vm();
+
+    // The VM goes back to the pool afterwards, so every exit leaves its stack the way it found it.
+    RDSquirrelLib::ScopedBuffer view(vm, buffer, size);
+    if (!SQUtils::call_squirrel_function_in_table(vm, *table, "TryOpen", view.object, size, file_name)) {
         return nullptr;
     }
-    if (sq_gettype(vm, -1) == OT_TABLE) {
-        sq_getstackobj(vm, -1, &result);
-        sq_addref(vm, &result);
-    } else {
-        sq_pop(vm, 1);
+    // [result]
+    if (sq_gettype(vm, -1) != OT_TABLE) {
         sq_pop(vm, 1);
         return nullptr;
     }
-    sq_pop(vm, 1);
-
-    // SQUtils::DumpSquirrelTable(vm, result);
 
-    sq_pushobject(vm, result);
+    // [result][entries], sq_get pops the key when it fails
     sq_pushstring(vm, "entries", -1);
-
     if (SQ_FAILED(sq_get(vm, -2))) {
-        sq_pop(vm, 2);
         sq_pop(vm, 1);
         return nullptr;
     }
@@ -68,10 +70,15 @@ ArchiveBase* SquirrelArchiveFormat::TryOpen(u8* buffer, u64 size, std::string fi
 
     sq_pop(vm, 2); // pop entries array and result table
 
-    return new SquirrelArchiveBase(vm, archive_format_table, entries);
+    return new SquirrelArchiveBase(pool, tag, entries, size);
 }
 
 u8* SquirrelArchiveBase::OpenStream(const Entry* entry, u8* buffer) {
+    SquirrelVMPool::Lease lease = pool->Acquire();
+    const HSQOBJECT *table = lease.Format(format);
+    if (!table) return nullptr;
+    HSQUIRRELVM vm = lease.vm();
+
     sq_newtable(vm);
     sq_pushstring(vm, "name", -1);
     sq_pushstring(vm, entry->name.data(), entry->name.size());
@@ -91,40 +98,21 @@ u8* SquirrelArchiveBase::OpenStream(const Entry* entry, u8* buffer) {
 
     sq_pop(vm, 1);
 
-    if (SQ_SUCCESS(SQUtils::call_squirrel_function_in_table(vm, archive_format_table, "OpenStream", entry_obj, buffer))) {
-        HSQOBJECT result;
-        sq_getstackobj(vm, -1, &result);
-        sq_addref(vm, &result);
-        sq_pop(vm, 1);
-
-        if (result._type == OT_ARRAY) {
-            sq_pushobject(vm, result);
-            SQInteger len = sq_getsize(vm, -1);
-
-            std::vector<u8> entry_buf;
-            entry_buf.reserve(len);
-
-            for (SQInteger i = 0; i < len; ++i) {
-                sq_pushinteger(vm, i);
-                if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
-                    SQInteger val;
-                    if (SQ_SUCCEEDED(sq_getinteger(vm, -1, &val))) {
-                        entry_buf.push_back(static_cast<u8>(val));
-                    }
-                    sq_pop(vm, 1);
-                }
-            }
-
-            sq_pop(vm, 1); // pop array
+    RDSquirrelLib::ScopedBuffer view(vm, buffer, archive_size);
+    bool called = SQUtils::call_squirrel_function_in_table(vm, *table, "OpenStream", entry_obj, view.object);
+    sq_release(vm, &entry_obj);
+    if (!called) return nullptr;
 
-            sq_release(vm, &entry_obj);
-            sq_release(vm, &result);
+    // Views and blobs are copied out with a single memcpy, arrays of byte values are still accepted from older scripts.
+    u8 *output = malloc<u8>(entry->size);
+    i64 written = output ? RDSquirrelLib::CopyStreamResult(vm, -1, output, entry->size) : -1;
+    sq_pop(vm, 1);
 
-            u8* entryData = (u8*)malloc(entry_buf.size());
-            memcpy(entryData, entry_buf.data(), entry_buf.size());
-            return entryData;
-        }
+    if (written < 0) {
+        Logger::error("[Squirrel] OpenStream for {} didn't return a buffer, blob or array", entry->name);
+        free(output);
+        return nullptr;
     }
-
-    return nullptr;
+    memset(output + written, 0, entry->size - written);
+    return output;
 }
@@ -1,19 +1,30 @@
+#pragma once
+
 #include "SQUtils.h"
+#include "SquirrelVMPool.h"
 #include "ArchiveFormats/ArchiveFormat.h"
 
 class SquirrelArchiveBase : public ArchiveBase {
   public:
-    HSQUIRRELVM vm;
-    HSQOBJECT archive_format_table;
+    SquirrelVMPool *pool;
+    // Tag of the format, resolved to its table in whichever VM a call gets.
+    std::string format;
     EntryMap entries;
+    // OpenStream only gets the buffer, scripts need to know how far they may read.
+    u64 archive_size;
 
-    SquirrelArchiveBase(HSQUIRRELVM vm, HSQOBJECT table, EntryMap entries) {
-        this->vm = vm;
+    SquirrelArchiveBase(SquirrelVMPool *pool, std::string format, EntryMap entries, u64 archive_size) {
+        this->pool = pool;
+        this->format = std::move(format);
         this->entries = entries;
-        this->archive_format_table = table;
+        this->archive_size = archive_size;
     }
 
     u8* OpenStream(const Entry *entry, u8 *buffer) override;
+    // Every call leases its own VM.
+    bool ConcurrentStreams() const override {
+        return true;
+    }
     EntryMapPtr GetEntries() override {
         EntryMapPtr entries;
         for (auto& entry : this->entries)
@@ -23,52 +34,22 @@ class SquirrelArchiveBase : public ArchiveBase {
 };
 
 class SquirrelArchiveFormat : public ArchiveFormat {
-  HSQUIRRELVM vm;
-  HSQOBJECT archive_format_table;
+  SquirrelVMPool *pool;
+  std::string tag;
+  std::string description;
 
 public:
-
-    char *tag;
-    char *description;
-
-  SquirrelArchiveFormat(HSQUIRRELVM vm, const HSQOBJECT &table) : vm(vm) {
-    sq_resetobject(&archive_format_table);
-    archive_format_table = table;
-    this->tag = (char*)malloc(128);
-    this->description = (char*)malloc(512);
-  }
-
-  ~SquirrelArchiveFormat() {
-      sq_release(vm, &archive_format_table);
-      free(this->tag);
-      free(this->description);
-  }
+  SquirrelArchiveFormat(SquirrelVMPool *pool, std::string tag, std::string description)
+    : pool(pool), tag(std::move(tag)), description(std::move(description)) {}
 
   const char* GetTag() const override {
-      snprintf(this->tag, 128, "%s", GetStringField("tag", "TAG_FAIL").c_str());
-      return (const char*)tag;
+      return tag.c_str();
   }
 
   const char* GetDescription() const override {
-    snprintf(this->description, 512, "%s", GetStringField("description", "GETDESC_FAIL").c_str());
-    return (const char*)description;
+    return description.c_str();
   }
 
   bool CanHandleFile(u8 *buffer, u64 size, const std::string &ext) const override;
   ArchiveBase* TryOpen(u8* buffer, u64 size, std::string file_name) override;
-
-private:
-  std::string GetStringField(const char *key, const char *fallback) const {
-    sq_pushobject(vm, archive_format_table);
-    sq_pushstring(vm, _SC(key), -1);
-    if (SQ_SUCCESS(sq_get(vm, -2))) {
-      const SQChar *val;
-      if (SQ_SUCCESS(sq_getstring(vm, -1, &val))) {
-        sq_pop(vm, 2);
-        return val;
-      }
-    }
-    sq_pop(vm, 1);
-    return fallback;
-  }
 };
@@ -0,0 +1,193 @@
+#include "SquirrelVMPool.h"
+#include "RDSquirrelLib.h"
+#include "RDSquirrelBulk.h"
+#include "ScriptCache.h"
+#include "squirrel.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+static void squirrel_print(HSQUIRRELVM vm, const SQChar *str, ...) {
+  va_list va;
+  va_start(va, str);
+  Logger::log([&]() {
+    printf("[Squirrel] ");
+    vprintf(str, va);
+  });
+  va_end(va);
+}
+
+#ifdef EMSCRIPTEN
+#define SQ_RUNTIME_EXCEPTION_FORMAT "\t at %s (%s:%d)\n"
+#else
+#define SQ_RUNTIME_EXCEPTION_FORMAT "\t at %s (%s:%lld)\n"
+#endif
+
+static SQInteger squirrel_runtime_error(HSQUIRRELVM vm) {
+  if (sq_gettop(vm) > 0) {
+    const SQChar *error_msg;
+    if (SQ_SUCCEEDED(sq_getstring(vm, 2, &error_msg))) {
+      Logger::error("Squirrel runtime exception: \"{}\"", error_msg);
+      SQStackInfos sqstack;
+      for (SQInteger i = 1; SQ_SUCCEEDED(sq_stackinfos(vm, i, &sqstack)); ++i) {
+        printf(sqstack.source ? SQ_RUNTIME_EXCEPTION_FORMAT : "\t at %s\n",
+               sqstack.funcname ? sqstack.funcname : "Anonymous function",
+               sqstack.source, sqstack.line);
+      }
+    }
+  }
+  return 0;
+}
+
+#ifdef EMSCRIPTEN
+#define SQ_COMPILER_EXCEPTION_FORMAT "\t at %s:%d:%d: %s\n\n"
+#else
+#define SQ_COMPILER_EXCEPTION_FORMAT "\t at %s:%lld:%lld: %s\n\n"
+#endif
+
+SquirrelVMPool::~SquirrelVMPool() {
+    Logger::log("Closing Squirrel...");
+    for (auto &state : vms) {
+        for (auto &[name, table] : state->formats) sq_release(state->vm, &table);
+        sq_close(state->vm);
+    }
+}
+
+SquirrelVM *SquirrelVMPool::Create() {
+    HSQUIRRELVM vm = sq_open(1024);
+    if (!vm) {
+        Logger::error("Failed to create Squirrel VM!");
+        return nullptr;
+    }
+
+    sq_setcompilererrorhandler(vm, [](HSQUIRRELVM vm, const SQChar *desc, const SQChar *src, SQInteger line, SQInteger col) {
+        Logger::error("\nSquirrel Compiler Exception!");
+        printf(SQ_COMPILER_EXCEPTION_FORMAT, src, line, col, desc);
+    });
+    sq_newclosure(vm, squirrel_runtime_error, 0);
+    sq_seterrorhandler(vm);
+    sq_setprintfunc(vm, squirrel_print, nullptr);
+    sq_pushroottable(vm);
+
+    RDSquirrelLib::RegisterAllFuncs(vm);
+    RDSquirrelLib::RegisterBulkFuncs(vm);
+
+    sqstd_register_iolib(vm);
+    sqstd_register_mathlib(vm);
+    sqstd_register_stringlib(vm);
+    sqstd_register_bloblib(vm);
+    sqstd_register_systemlib(vm);
+
+    sq_pop(vm, 1);
+
+    auto *state = new SquirrelVM();
+    state->vm = vm;
+    return state;
+}
+
+bool SquirrelVMPool::LoadScript(SquirrelVM &state, const std::string &path, std::string *name) {
+    HSQUIRRELVM vm = state.vm;
+    sq_pushroottable(vm);
+
+    // Every script defines its format as the global `archive_format`, clear the previous script's so a script without
+    // one isn't mistaken for it.
+    sq_pushstring(vm, SC("archive_format"), -1);
+    sq_pushnull(vm);
+    sq_newslot(vm, -3, SQFalse);
+
+    if (!ScriptCache::Load(vm, path)) {
+        Logger::error("Failed to load script: {}", path.c_str());
+        sq_pop(vm, 1);
+        return false;
+    }
+    sq_push(vm, -2);
+    if (SQ_FAILED(sq_call(vm, 1, SQFalse, SQTrue))) {
+        Logger::error("Failed to load script: {}", path.c_str());
+        sqstd_printcallstack(vm);
+        sq_pop(vm, 2);
+        return false;
+    }
+    sq_pop(vm, 1);
+
+    sq_pushstring(vm, SC("archive_format"), -1);
+    if (SQ_FAILED(sq_get(vm, -2))) {
+        sq_pop(vm, 1);
+        return true;
+    }
+    if (sq_gettype(vm, -1) != OT_TABLE) {
+        sq_pop(vm, 2);
+        return true;
+    }
+
+    HSQOBJECT table;
+    sq_getstackobj(vm, -1, &table);
+
+    const SQChar *tag = nullptr;
+    sq_pushstring(vm, SC("tag"), -1);
+    if (SQ_SUCCEEDED(sq_get(vm, -2))) {
+        if (SQ_FAILED(sq_getstring(vm, -1, &tag))) tag = nullptr;
+        if (tag) {
+            auto [it, inserted] = state.formats.try_emplace(tag, table);
+            if (!inserted) {
+                sq_release(vm, &it->second);
+                it->second = table;
+            }
+            sq_addref(vm, &it->second);
+            if (name) *name = tag;
+        }
+        sq_pop(vm, 1);
+    }
+    if (!tag) Logger::error("[Squirrel] 'archive_format' in {} has no tag!", path);
+
+    sq_pop(vm, 2);
+    return true;
+}
+
+SquirrelVMPool::Lease SquirrelVMPool::Acquire() {
+    SquirrelVM *state = nullptr;
+    {
+        std::lock_guard lock(mutex);
+        if (!idle.empty()) {
+            state = idle.back();
+            idle.pop_back();
+        }
+    }
+    if (!state) {
+        state = Create();
+        if (!state) return Lease(this, nullptr);
+        std::lock_guard lock(mutex);
+        vms.emplace_back(state);
+    }
+
+    std::vector<std::string> pending;
+    {
+        std::lock_guard lock(mutex);
+        pending.assign(scripts.begin() + state->loaded_scripts, scripts.end());
+        state->loaded_scripts = scripts.size();
+    }
+
+    // The VM is ours now, so catching up on scripts can run without the lock.
+    for (const std::string &path : pending) LoadScript(*state, path, nullptr);
+    return Lease(this, state);
+}
+
+void SquirrelVMPool::Release(SquirrelVM *state) {
+    std::lock_guard lock(mutex);
+    idle.push_back(state);
+}
+
+bool SquirrelVMPool::AddScript(const std::string &path, std::string &name) {
+    std::lock_guard add_lock(add_mutex);
+
+    Lease lease = Acquire();
+    if (!lease.vm()) return false;
+
+    name.clear();
+    if (!LoadScript(*lease.state, path, &name)) return false;
+
+    std::lock_guard lock(mutex);
+    scripts.push_back(path);
+    // Other scripts can't have been added meanwhile, so this VM has run all of them.
+    lease.state->loaded_scripts = scripts.size();
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "SQUtils.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One VM with every script loaded into it. A VM is only ever used by one thread at a time.
+struct SquirrelVM {
+    HSQUIRRELVM vm = nullptr;
+    // `archive_format` tables by their tag.
+    std::unordered_map<std::string, HSQOBJECT> formats;
+    // How many of the pool's scripts have run in this VM.
+    usize loaded_scripts = 0;
+};
+
+// Squirrel VMs aren't thread safe, so instead of sharing one, every thread running script code leases its own VM from
+// here. All VMs run the same scripts in the same order and formats look their table up by tag in whichever VM they got,
+// which lets scripted formats detect and extract in parallel like native ones.
+class SquirrelVMPool {
+public:
+    class Lease {
+        friend class SquirrelVMPool;
+        SquirrelVMPool *pool;
+        SquirrelVM *state;
+
+    public:
+        Lease(SquirrelVMPool *pool, SquirrelVM *state) : pool(pool), state(state) {}
+        Lease(const Lease&) = delete;
+        Lease &operator=(const Lease&) = delete;
+        ~Lease() {
+            if (state) pool->Release(state);
+        }
+
+        HSQUIRRELVM vm() const {
+            return state ? state->vm : nullptr;
+        }
+
+        // The table of the format tagged `name` in this VM, or nullptr if it didn't load here.
+        const HSQOBJECT *Format(const std::string &name) const {
+            if (!state) return nullptr;
+            auto it = state->formats.find(name);
+            return it != state->formats.end() ? &it->second : nullptr;
+        }
+    };
+
+    SquirrelVMPool() = default;
+    SquirrelVMPool(const SquirrelVMPool&) = delete;
+    SquirrelVMPool &operator=(const SquirrelVMPool&) = delete;
+    ~SquirrelVMPool();
+
+    // An idle VM, or a new one if every VM is busy. VMs are brought up to date with the scripts added since they
+    // were last used before being handed out.
+    Lease Acquire();
+
+    // Runs `path` in a VM and, if that worked, in every other VM as it's next acquired. `name` is set to the tag of the
+    // `archive_format` table the script defined, or left empty if it didn't define one.
+    bool AddScript(const std::string &path, std::string &name);
+
+private:
+    void Release(SquirrelVM *state);
+    static SquirrelVM *Create();
+    static bool LoadScript(SquirrelVM &state, const std::string &path, std::string *name);
+
+    std::mutex mutex;
+    // Serialises AddScript so scripts load in the same order everywhere.
+    std::mutex add_mutex;
+    std::vector<std::string> scripts;
+    std::vector<std::unique_ptr<SquirrelVM>> vms;
+    std::vector<SquirrelVM*> idle;
+};
@@ -21,6 +21,7 @@
 #endif
 
 #include <thread>
+#include <chrono>
 #include <filesystem>
 
 #include "state.h"
@@ -110,6 +111,7 @@ int main(int argc, char** argv) {
     ScriptManager *scriptManager = new ScriptManager();
 
     if (fs::exists("scripts/")) {
+        auto scripts_start = std::chrono::steady_clock::now();
         for (const auto &entry : fs::directory_iterator("scripts/")) {
             const fs::path entry_path = entry.path();
             if (entry_path.extension() == ".nut") {
@@ -121,6 +123,9 @@ int main(int argc, char** argv) {
                 }
             }
         }
+        auto scripts_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - scripts_start);
+        Logger::log("Loaded scripts in {} ms ({} from cache, {} compiled)", (i64)scripts_time.count(),
+                    ScriptCache::hits.load(), ScriptCache::misses.load());
     } else {
         Logger::error("scripts/ directory does not exist!");
     }
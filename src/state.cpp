@@ -45,6 +45,7 @@ PImageView image_preview = {
 bool text_editor__unsaved_changes = false;
 bool fb__loading_arc = false;
 std::string fb__loading_file_name = "";
+bool fb__grid_view = false;
 
 bool default_to_hex_view = false;
 bool text_viewer_override = false;
@@ -17,6 +17,7 @@
 #endif
 #include <gl3.h>
 #include <deque>
+#include <memory>
 #include <string>
 
 #ifdef __linux__
@@ -31,8 +32,14 @@
 #include <TextEditor/TextEditor.h>
 #include <HexEditor/imgui_hex_editor.h>
 
+class AudioOverview;
+class TextView;
+class TiledImage;
+
 struct PWinStateTexture {
   GLuint id;
+  // Set instead of `id` for images too large for a single texture.
+  TiledImage *tiled = nullptr;
   Vec2<int*> size;
   GifAnimation anim;
   int frame;
@@ -48,16 +55,22 @@ struct TimeInfo {
 
 struct PWinStateAudio {
   MIX_Mixer *mixer;
-  MIX_Audio *music;
   MIX_Track *track;
+  // The track reads and decodes its stream as it plays, the stream's own decoder filled in the rest when it was loaded.
+  bool loaded;
   SDL_AudioSpec spec;
+  Sint64 frames;
+  SDL_PropertiesID metadata;
   bool playing;
   u8 *buffer;
+  // Playing straight out of the loaded archive, which has to stay open until it stops.
+  bool streams_archive;
   int volumePercent;
   TimeInfo time;
   SDL_TimerID update_timer;
   bool shouldLoop;
   bool scrubberDragging;
+  std::shared_ptr<AudioOverview> overview;
 };
 
 enum ContentType {
@@ -71,7 +84,7 @@ enum ContentType {
     UNKNOWN
 };
 
-enum ContentEncoding {
+enum ContentEncoding : int {
     UTF8,
     UTF16,
     SHIFT_JIS
@@ -91,6 +104,10 @@ struct PWinStateContents {
       const Elf64_Header *elf64;
     } elf_header;
     ElfFile *elfFile;
+    // Read only view of the text, created when it's first shown.
+    TextView *textView = nullptr;
+    // The text is in the TextEditor and shown there instead.
+    bool editing = false;
 };
 
 struct PImageView {
@@ -135,6 +152,7 @@ extern bool text_editor__unsaved_changes;
 
 extern bool fb__loading_arc;
 extern std::string fb__loading_file_name;
+extern bool fb__grid_view;
 
 extern bool default_to_hex_view;
 extern bool text_viewer_override;
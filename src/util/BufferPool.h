@@ -0,0 +1,99 @@
+#pragma once
+
+#include <bit>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#include <util/int.h>
+
+// Recycles large, short lived buffers such as decoded entries. Requests are rounded up to a power of two size class
+// and freed blocks are kept per class up to a byte budget, so extracting or previewing entry after entry reuses the
+// same few blocks instead of going back to the system allocator each time.
+// Blocks come straight from malloc, so one that is never given back can still be released with plain free().
+class BufferPool {
+public:
+    // Below this malloc is already cheap and pooling would only waste memory.
+    static constexpr usize MinPooledSize = 64 << 10;
+    static constexpr usize MaxPooledSize = 256 << 20;
+    static constexpr usize DefaultBudget = 512 << 20;
+
+    explicit BufferPool(usize budget = DefaultBudget) : budget(budget) {}
+    BufferPool(const BufferPool&) = delete;
+    BufferPool &operator=(const BufferPool&) = delete;
+
+    ~BufferPool() {
+        for (auto &blocks : classes) {
+            for (void *block : blocks) free(block);
+        }
+    }
+
+    // The pool shared by the host and plugins.
+    static BufferPool &Shared() {
+        static BufferPool pool;
+        return pool;
+    }
+
+    void *Allocate(usize size) {
+        if (size < MinPooledSize || size > MaxPooledSize) return malloc(size);
+
+        usize index = ClassIndex(size);
+        {
+            std::lock_guard lock(mutex);
+            auto &blocks = classes[index];
+            if (!blocks.empty()) {
+                void *block = blocks.back();
+                blocks.pop_back();
+                cached -= ClassSize(index);
+                return block;
+            }
+        }
+        return malloc(ClassSize(index));
+    }
+
+    // `size` must be the size the block was allocated with.
+    void Deallocate(void *ptr, usize size) {
+        if (!ptr) return;
+        if (size < MinPooledSize || size > MaxPooledSize) {
+            free(ptr);
+            return;
+        }
+
+        usize index = ClassIndex(size);
+        {
+            std::lock_guard lock(mutex);
+            if (cached + ClassSize(index) <= budget) {
+                classes[index].push_back(ptr);
+                cached += ClassSize(index);
+                return;
+            }
+        }
+        free(ptr);
+    }
+
+    // Gives every cached block back to the system.
+    void Trim() {
+        std::lock_guard lock(mutex);
+        for (auto &blocks : classes) {
+            for (void *block : blocks) free(block);
+            blocks.clear();
+        }
+        cached = 0;
+    }
+
+private:
+    static constexpr usize MinClassBits = std::bit_width(MinPooledSize - 1);
+    static constexpr usize ClassCount = std::bit_width(MaxPooledSize - 1) - MinClassBits + 1;
+
+    static usize ClassIndex(usize size) {
+        return std::bit_width(size - 1) - MinClassBits;
+    }
+    static usize ClassSize(usize index) {
+        return (usize)1 << (index + MinClassBits);
+    }
+
+    std::mutex mutex;
+    std::vector<void*> classes[ClassCount];
+    usize cached = 0;
+    usize budget;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <zlib.h>
+
+#include <util/int.h>
+
+// A reusable inflate stream. inflateInit allocates the state and the 32K window, so rather than paying for that per
+// entry each thread keeps one context around and only resets it between streams.
+class InflateContext {
+    z_stream stream = {};
+    bool ready = false;
+
+public:
+    InflateContext() = default;
+    InflateContext(const InflateContext&) = delete;
+    InflateContext &operator=(const InflateContext&) = delete;
+
+    ~InflateContext() {
+        if (ready) inflateEnd(&stream);
+    }
+
+    // The calling thread's context, torn down when the thread exits.
+    static InflateContext &ForThread() {
+        thread_local InflateContext context;
+        return context;
+    }
+
+    // Inflates `src` into `dst` and returns the number of bytes written. Stops early on corrupt input or once `dst`
+    // is full, so callers should compare the result with the size they expected.
+    // `window_bits` follows zlib: MAX_WBITS for zlib streams, -MAX_WBITS for raw deflate.
+    usize Inflate(const u8 *src, usize src_size, u8 *dst, usize dst_size, int window_bits = MAX_WBITS) {
+        int result = ready ? inflateReset2(&stream, window_bits) : inflateInit2(&stream, window_bits);
+        if (result != Z_OK) return 0;
+        ready = true;
+
+        stream.next_in = const_cast<Bytef*>(src);
+        stream.next_out = dst;
+        usize in_left = src_size;
+        usize out_left = dst_size;
+
+        // avail_in/avail_out are 32 bit, feed anything larger in pieces.
+        do {
+            uInt in_chunk = (uInt)std::min<usize>(in_left, UINT_MAX);
+            uInt out_chunk = (uInt)std::min<usize>(out_left, UINT_MAX);
+            stream.avail_in = in_chunk;
+            stream.avail_out = out_chunk;
+
+            result = inflate(&stream, Z_NO_FLUSH);
+
+            in_left -= in_chunk - stream.avail_in;
+            out_left -= out_chunk - stream.avail_out;
+        } while (result == Z_OK && out_left > 0 && in_left > 0);
+
+        return dst_size - out_left;
+    }
+};
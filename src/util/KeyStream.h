@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include <util/int.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RD_KEYSTREAM_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RD_KEYSTREAM_NEON
+#endif
+
+// Repeating-key XOR. The key is unrolled into a tile whose length is the LCM of the key size and the vector width,
+// so the hot loop never has to wrap the key index and every step is a whole vector.
+class XorKeyStream {
+    static constexpr usize VectorWidth = 16;
+    // Past this the tile stops being cache friendly, long keys just get walked one key length at a time.
+    static constexpr usize MaxPeriod = 4096;
+
+    std::vector<u8> tile;
+    usize key_size = 0;
+    usize period = 0;
+
+    static void XorBlock(u8 *dst, const u8 *src, const u8 *key, usize size) {
+        usize i = 0;
+#if defined(RD_KEYSTREAM_SSE2)
+        for (; i + VectorWidth <= size; i += VectorWidth) {
+            __m128i data = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i k = _mm_loadu_si128((const __m128i*)(key + i));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(data, k));
+        }
+#elif defined(RD_KEYSTREAM_NEON)
+        for (; i + VectorWidth <= size; i += VectorWidth) {
+            vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), vld1q_u8(key + i)));
+        }
+#else
+        for (; i + sizeof(u64) <= size; i += sizeof(u64)) {
+            u64 data, k;
+            memcpy(&data, src + i, sizeof(u64));
+            memcpy(&k, key + i, sizeof(u64));
+            data ^= k;
+            memcpy(dst + i, &data, sizeof(u64));
+        }
+#endif
+        for (; i < size; ++i) {
+            dst[i] = src[i] ^ key[i];
+        }
+    }
+
+public:
+    XorKeyStream() = default;
+    XorKeyStream(const u8 *key, usize size) {
+        SetKey(key, size);
+    }
+
+    void SetKey(const u8 *key, usize size) {
+        tile.clear();
+        key_size = size;
+        period = 0;
+        if (!key || size == 0) return;
+
+        period = std::lcm(size, VectorWidth);
+        if (period > MaxPeriod) period = size;
+
+        // One extra key length so a window of `period` bytes exists for every starting phase.
+        tile.resize(period + size);
+        for (usize i = 0; i < tile.size(); i += size) {
+            memcpy(tile.data() + i, key, std::min(size, tile.size() - i));
+        }
+    }
+
+    bool Empty() const {
+        return period == 0;
+    }
+
+    // XORs `size` bytes of `src` into `dst` as if they started `offset` bytes into the key stream.
+    // `dst` and `src` may be the same buffer.
+    void Apply(u8 *dst, const u8 *src, usize size, u64 offset = 0) const {
+        if (Empty()) {
+            if (dst != src) memmove(dst, src, size);
+            return;
+        }
+
+        // period is a multiple of the key size, so the phase is the same at the start of every block.
+        const u8 *window = tile.data() + (offset % key_size);
+        while (size >= period) {
+            XorBlock(dst, src, window, period);
+            dst += period;
+            src += period;
+            size -= period;
+        }
+        XorBlock(dst, src, window, size);
+    }
+
+    void Apply(u8 *data, usize size, u64 offset = 0) const {
+        Apply(data, data, size, offset);
+    }
+};
@@ -0,0 +1,42 @@
+#include "test.h"
+#include <ResourceFormats/DDS/BCDecode.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Block compressed texture decoding throughput, counted in decoded RGBA8 bytes. The default size is a 4096x4096
+// texture, large enough for DecodeRGBA8 to use every core.
+int main(int argc, char **argv) {
+    u32 side = (u32)std::sqrt((double)(Test::BenchSize(argc, argv, 64) / 4)) & ~3u;
+    std::vector<u8> dst((usize)side * side * 4);
+    std::mt19937 rng(4);
+
+    const struct {
+        DXGI_FORMAT format;
+        const char *name;
+    } formats[] = {
+        {DXGI_FORMAT_BC1_UNORM, "BC1"},
+        {DXGI_FORMAT_BC3_UNORM, "BC3"},
+        {DXGI_FORMAT_BC5_UNORM, "BC5"},
+        {DXGI_FORMAT_BC6H_UF16, "BC6H"},
+        {DXGI_FORMAT_BC7_UNORM, "BC7"},
+    };
+
+    printf("%ux%u\n", side, side);
+    for (const auto &[format, name] : formats) {
+        usize size = DDSDecode::SourceSize(format, side, side);
+        std::vector<u8> src(size);
+        for (auto &v : src) v = (u8)rng();
+
+        bool ok = true;
+        double seconds = Test::Seconds([&]() {
+            ok = DDSDecode::DecodeRGBA8(format, src.data(), size, side, side, dst.data());
+        });
+        if (!ok) {
+            printf("%s failed to decode\n", name);
+            return 1;
+        }
+        Test::Report(name, dst.size(), seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "test.h"
+#include <ArchiveFormats/HSP/dpm.h>
+#include <random>
+#include <vector>
+
+// HSP entry decryption throughput: the byte at a time recurrence, the vector scan and the threaded block scan.
+int main(int argc, char **argv) {
+    usize size = Test::BenchSize(argc, argv, 256);
+    std::vector<u8> in(size), out(size), expected(size);
+    std::mt19937 rng(3);
+    for (auto &c : in) c = (u8)rng();
+
+    double scalar = Test::Seconds([&]() {
+        u8 val = 0;
+        for (usize i = 0; i < size; ++i) {
+            val += 0x12 ^ (u8)(in[i] - 0x34);
+            expected[i] = val;
+        }
+    });
+    Test::Report("scalar recurrence", size, scalar);
+
+    double scan = Test::Seconds([&]() {
+        DPM::Scan(in.data(), out.data(), size, 0x12, 0x34, 0);
+    });
+    Test::Report("DPM::Scan", size, scan);
+    if (out != expected) {
+        puts("DPM::Scan output differs");
+        return 1;
+    }
+
+    double parallel = Test::Seconds([&]() {
+        DPM::ScanParallel(in.data(), out.data(), size, 0x12, 0x34);
+    });
+    Test::Report("DPM::ScanParallel", size, parallel);
+    if (out != expected) {
+        puts("DPM::ScanParallel output differs");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Just enough for the tests in here: CHECK records a failure and keeps going, main returns Test::Result().
+namespace Test {
+    inline int failures = 0;
+
+    inline int Result() {
+        if (failures) {
+            printf("%d check(s) failed\n", failures);
+            return 1;
+        }
+        puts("ok");
+        return 0;
+    }
+
+    template<typename F>
+    double Seconds(F &&f) {
+        auto start = std::chrono::steady_clock::now();
+        std::forward<F>(f)();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Benchmarks take the amount of data to run over in MiB as their only argument, ctest passes a small one.
+    inline size_t BenchSize(int argc, char **argv, size_t default_mib) {
+        size_t mib = argc > 1 ? strtoull(argv[1], nullptr, 10) : default_mib;
+        return (mib ? mib : 1) << 20;
+    }
+
+    inline void Report(const char *name, size_t bytes, double seconds) {
+        printf("%-32s %8.1f ms %8.2f GB/s\n", name, seconds * 1e3, bytes / seconds / 1e9);
+    }
+}
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        Test::failures++; \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
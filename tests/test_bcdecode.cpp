@@ -0,0 +1,363 @@
+#include "test.h"
+#include <ResourceFormats/DDS/BCDecode.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Block compression vectors for DDSDecode. BC1-BC5 blocks are built by hand and checked against values worked out from
+// the format description, BC7 and BC6H blocks are packed field by field here and checked against a straightforward
+// reading of the spec. The checksums at the end pin every format, partition and BC6H mode down to the byte.
+
+static std::mt19937 rng(1);
+
+// LSB first bit packer, the order every BC format stores its fields in.
+struct BlockWriter {
+    u8 block[16] = {};
+    u32 pos = 0;
+
+    void Put(u32 value, u32 bits) {
+        for (u32 i = 0; i < bits; ++i, ++pos) {
+            if ((value >> i) & 1) block[pos / 8] |= (u8)(1 << (pos % 8));
+        }
+    }
+};
+
+static std::vector<u8> Decode4x4(DXGI_FORMAT format, const u8 *block, usize size) {
+    std::vector<u8> out(64);
+    CHECK(DDSDecode::DecodeRGBA8(format, block, size, 4, 4, out.data()));
+    return out;
+}
+
+static void TestBC1() {
+    // Pure red and pure blue, index i on pixel i & 3.
+    u8 block[8] = {0x00, 0xF8, 0x1F, 0x00};
+    u32 indices = 0;
+    for (u32 i = 0; i < 16; ++i) indices |= (i & 3) << (2 * i);
+    memcpy(block + 4, &indices, 4);
+
+    auto out = Decode4x4(DXGI_FORMAT_BC1_UNORM, block, 8);
+    const u8 four[4][4] = {{255, 0, 0, 255}, {0, 0, 255, 255}, {170, 0, 85, 255}, {85, 0, 170, 255}};
+    for (u32 i = 0; i < 16; ++i) CHECK(memcmp(&out[i * 4], four[i & 3], 4) == 0);
+
+    // Ascending endpoints switch to three colors and transparent black.
+    std::swap(block[0], block[2]);
+    std::swap(block[1], block[3]);
+    out = Decode4x4(DXGI_FORMAT_BC1_UNORM, block, 8);
+    const u8 three[4][4] = {{0, 0, 255, 255}, {255, 0, 0, 255}, {127, 0, 127, 255}, {0, 0, 0, 0}};
+    for (u32 i = 0; i < 16; ++i) CHECK(memcmp(&out[i * 4], three[i & 3], 4) == 0);
+}
+
+// BC4 style channel block with endpoints e0, e1 and index i & 7 on pixel i.
+static void ChannelBlock(u8 *block, u8 e0, u8 e1) {
+    block[0] = e0;
+    block[1] = e1;
+    u64 indices = 0;
+    for (u32 i = 0; i < 16; ++i) indices |= (u64)(i & 7) << (3 * i);
+    for (u32 i = 0; i < 6; ++i) block[2 + i] = (u8)(indices >> (8 * i));
+}
+
+static void TestBC2To5() {
+    const int eight[8] = {200, 100, (6 * 200 + 100) / 7, (5 * 200 + 200) / 7, (4 * 200 + 300) / 7, (3 * 200 + 400) / 7,
+        (2 * 200 + 500) / 7, (200 + 600) / 7};
+    const int six[8] = {50, 150, (4 * 50 + 150) / 5, (3 * 50 + 300) / 5, (2 * 50 + 450) / 5, (50 + 600) / 5, 0, 255};
+
+    u8 bc4[8];
+    ChannelBlock(bc4, 200, 100);
+    auto out = Decode4x4(DXGI_FORMAT_BC4_UNORM, bc4, 8);
+    for (u32 i = 0; i < 16; ++i) {
+        CHECK(out[i * 4] == eight[i & 7] && out[i * 4 + 1] == out[i * 4] && out[i * 4 + 2] == out[i * 4]);
+        CHECK(out[i * 4 + 3] == 255);
+    }
+    ChannelBlock(bc4, 50, 150);
+    out = Decode4x4(DXGI_FORMAT_BC4_UNORM, bc4, 8);
+    for (u32 i = 0; i < 16; ++i) CHECK(out[i * 4] == six[i & 7]);
+
+    // -128 is read as -127, both ends of the signed range land on 0 and 255.
+    ChannelBlock(bc4, 0x80, 127);
+    out = Decode4x4(DXGI_FORMAT_BC4_SNORM, bc4, 8);
+    CHECK(out[0] == 0 && out[4] == 255);
+
+    // BC2: explicit 4 bit alpha in front of a four color block.
+    u8 bc2[16] = {};
+    for (u32 i = 0; i < 8; ++i) bc2[i] = (u8)(0x21 * (i + 1));
+    out = Decode4x4(DXGI_FORMAT_BC2_UNORM, bc2, 16);
+    for (u32 i = 0; i < 16; ++i) CHECK(out[i * 4 + 3] == ((i / 2 + 1) * (i & 1 ? 2 : 1) & 0xF) * 17);
+    CHECK(out[0] == 0 && out[1] == 0 && out[2] == 0);
+
+    // BC3: BC4 alpha, then colors that stay in four color mode even with ascending endpoints.
+    u8 bc3[16] = {};
+    ChannelBlock(bc3, 50, 150);
+    bc3[8] = 0x1F; // c0 = pure blue, c1 = pure red
+    bc3[11] = 0xF8;
+    out = Decode4x4(DXGI_FORMAT_BC3_UNORM, bc3, 16);
+    for (u32 i = 0; i < 16; ++i) CHECK(out[i * 4 + 3] == six[i & 7]);
+    CHECK(out[0] == 0 && out[2] == 255);
+
+    // BC5: two BC4 blocks into red and green.
+    u8 bc5[16];
+    ChannelBlock(bc5, 200, 100);
+    ChannelBlock(bc5 + 8, 50, 150);
+    out = Decode4x4(DXGI_FORMAT_BC5_UNORM, bc5, 16);
+    for (u32 i = 0; i < 16; ++i) {
+        CHECK(out[i * 4] == eight[i & 7] && out[i * 4 + 1] == six[i & 7]);
+        CHECK(out[i * 4 + 2] == 0 && out[i * 4 + 3] == 255);
+    }
+}
+
+// Mode table from the BC7 spec.
+struct BC7Mode {
+    u32 subsets, partition_bits, rotation_bits, index_selection_bits, color_bits, alpha_bits, endpoint_pbits,
+        shared_pbits, index_bits, index_bits2;
+};
+
+static const BC7Mode BC7Modes[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+};
+
+static int Weight(u32 bits, u32 index) {
+    static const int weights2[4] = {0, 21, 43, 64};
+    static const int weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+    static const int weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    return bits == 2 ? weights2[index] : bits == 3 ? weights3[index] : weights4[index];
+}
+
+static int Interpolate(int a, int b, int weight) {
+    return (a * (64 - weight) + b * weight + 32) >> 6;
+}
+
+static u8 Expand(u32 value, u32 bits) {
+    value <<= 8 - bits;
+    return (u8)(value | (value >> bits));
+}
+
+// Random BC7 blocks of every mode, rotation and index selection. Only partition 0 is used so the reference needs no
+// tables; the checksums below cover the rest.
+static void TestBC7() {
+    const u8 subsets2[16] = {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1};
+    const u8 subsets3[16] = {0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2};
+
+    for (int iteration = 0; iteration < 20000; ++iteration) {
+        const u32 mode = rng() % 8;
+        const BC7Mode &m = BC7Modes[mode];
+        BlockWriter writer;
+        writer.Put(1u << mode, mode + 1);
+        const u32 rotation = rng() & ((1u << m.rotation_bits) - 1);
+        const u32 selection = rng() & ((1u << m.index_selection_bits) - 1);
+        writer.Put(0, m.partition_bits);
+        writer.Put(rotation, m.rotation_bits);
+        writer.Put(selection, m.index_selection_bits);
+
+        const u32 endpoint_count = m.subsets * 2;
+        u32 raw[6][4] = {};
+        for (u32 c = 0; c < 3; ++c) {
+            for (u32 e = 0; e < endpoint_count; ++e) writer.Put(raw[e][c] = rng() & ((1u << m.color_bits) - 1), m.color_bits);
+        }
+        for (u32 e = 0; e < endpoint_count; ++e) writer.Put(raw[e][3] = rng() & ((1u << m.alpha_bits) - 1), m.alpha_bits);
+
+        u32 pbits[6] = {};
+        if (m.endpoint_pbits) {
+            for (u32 e = 0; e < endpoint_count; ++e) writer.Put(pbits[e] = rng() & 1, 1);
+        }
+        if (m.shared_pbits) {
+            for (u32 s = 0; s < m.subsets; ++s) {
+                pbits[s * 2] = pbits[s * 2 + 1] = rng() & 1;
+                writer.Put(pbits[s * 2], 1);
+            }
+        }
+
+        const u32 pbit = m.endpoint_pbits | m.shared_pbits;
+        int endpoints[6][4];
+        for (u32 e = 0; e < endpoint_count; ++e) {
+            for (u32 c = 0; c < 3; ++c) endpoints[e][c] = Expand((raw[e][c] << pbit) | pbits[e], m.color_bits + pbit);
+            endpoints[e][3] = m.alpha_bits ? Expand((raw[e][3] << pbit) | pbits[e], m.alpha_bits + pbit) : 255;
+        }
+
+        const u8 *subsets = m.subsets == 2 ? subsets2 : m.subsets == 3 ? subsets3 : nullptr;
+        u32 indices[16], indices2[16];
+        for (u32 i = 0; i < 16; ++i) {
+            u32 subset = subsets ? subsets[i] : 0;
+            bool anchor = i == 0 || (subset == 1 && i == (m.subsets == 2 ? 15u : 3u)) || (subset == 2 && i == 15);
+            u32 bits = m.index_bits - anchor;
+            writer.Put(indices[i] = rng() & ((1u << bits) - 1), bits);
+        }
+        if (m.index_bits2) {
+            for (u32 i = 0; i < 16; ++i) {
+                u32 bits = m.index_bits2 - (i == 0);
+                writer.Put(indices2[i] = rng() & ((1u << bits) - 1), bits);
+            }
+        }
+        CHECK(writer.pos == 128);
+
+        auto out = Decode4x4(DXGI_FORMAT_BC7_UNORM, writer.block, 16);
+        for (u32 i = 0; i < 16; ++i) {
+            int pixel[4];
+            if (!m.index_bits2) {
+                u32 s = subsets ? subsets[i] : 0;
+                for (u32 c = 0; c < 4; ++c) {
+                    pixel[c] = Interpolate(endpoints[s * 2][c], endpoints[s * 2 + 1][c], Weight(m.index_bits, indices[i]));
+                }
+            } else {
+                u32 color_bits = m.index_bits, alpha_bits = m.index_bits2, color = indices[i], alpha = indices2[i];
+                if (selection) {
+                    std::swap(color_bits, alpha_bits);
+                    std::swap(color, alpha);
+                }
+                for (u32 c = 0; c < 3; ++c) pixel[c] = Interpolate(endpoints[0][c], endpoints[1][c], Weight(color_bits, color));
+                pixel[3] = Interpolate(endpoints[0][3], endpoints[1][3], Weight(alpha_bits, alpha));
+                if (rotation) std::swap(pixel[3], pixel[rotation - 1]);
+            }
+            bool match = true;
+            for (u32 c = 0; c < 4; ++c) match &= out[i * 4 + c] == pixel[c];
+            CHECK(match);
+        }
+    }
+
+    // Mode bits of all zero are reserved and decode to transparent black.
+    u8 reserved[16] = {};
+    auto out = Decode4x4(DXGI_FORMAT_BC7_UNORM, reserved, 16);
+    CHECK(std::all_of(out.begin(), out.end(), [](u8 v) { return v == 0; }));
+}
+
+static int Unquantize(int value, int bits) {
+    if (value == 0) return 0;
+    if (value == (1 << bits) - 1) return 0xFFFF;
+    return ((value << 16) + 0x8000) >> bits;
+}
+
+// Half float in [0, 1] to an sRGB byte, the way the preview shows HDR data.
+static u8 HalfToSRGB(u32 half) {
+    if (half >= 0x3C00) return 255;
+    u32 exponent = half >> 10, mantissa = half & 0x3FF;
+    float value = exponent ? std::ldexp(1.0f + mantissa / 1024.0f, (int)exponent - 15) : std::ldexp(mantissa / 1024.0f, -14);
+    value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return (u8)std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f);
+}
+
+// BC6H mode 10: one region, untransformed 10 bit endpoints, 4 bit indices.
+static void TestBC6H() {
+    for (int iteration = 0; iteration < 5000; ++iteration) {
+        BlockWriter writer;
+        writer.Put(3, 5);
+        u32 endpoints[2][3];
+        for (u32 e = 0; e < 2; ++e) {
+            for (u32 c = 0; c < 3; ++c) writer.Put(endpoints[e][c] = rng() & 1023, 10);
+        }
+        u32 indices[16];
+        for (u32 i = 0; i < 16; ++i) writer.Put(indices[i] = rng() & ((1u << (4 - (i == 0))) - 1), 4 - (i == 0));
+        CHECK(writer.pos == 128);
+
+        auto out = Decode4x4(DXGI_FORMAT_BC6H_UF16, writer.block, 16);
+        for (u32 i = 0; i < 16; ++i) {
+            bool match = out[i * 4 + 3] == 255;
+            for (u32 c = 0; c < 3; ++c) {
+                int value = Interpolate(Unquantize(endpoints[0][c], 10), Unquantize(endpoints[1][c], 10), Weight(4, indices[i]));
+                match &= out[i * 4 + c] == HalfToSRGB((u32)(value * 31) >> 6);
+            }
+            CHECK(match);
+        }
+    }
+}
+
+static u32 Fnv1a(const std::vector<u8> &data) {
+    u32 hash = 0x811C9DC5;
+    for (u8 v : data) hash = (hash ^ v) * 0x01000193;
+    return hash;
+}
+
+// 64x64 images of random blocks. For BC7 and BC6H that reaches every mode and partition; the sums were recorded from
+// the decoder after it matched the checks above.
+static void TestChecksums() {
+    struct Vector {
+        DXGI_FORMAT format;
+        u32 checksum;
+    };
+    const Vector vectors[] = {
+        {DXGI_FORMAT_BC1_UNORM, 0x5D7D7EF7},
+        {DXGI_FORMAT_BC2_UNORM, 0x430C1A6E},
+        {DXGI_FORMAT_BC3_UNORM, 0x59C831D2},
+        {DXGI_FORMAT_BC4_UNORM, 0x2BCC47D4},
+        {DXGI_FORMAT_BC4_SNORM, 0x0D206B45},
+        {DXGI_FORMAT_BC5_UNORM, 0x07F97B01},
+        {DXGI_FORMAT_BC5_SNORM, 0x53B44DFD},
+        {DXGI_FORMAT_BC6H_UF16, 0x396DF817},
+        {DXGI_FORMAT_BC6H_SF16, 0x3051A983},
+        {DXGI_FORMAT_BC7_UNORM, 0xB3A1958C},
+    };
+
+    for (const Vector &vector : vectors) {
+        std::mt19937 blocks(vector.format);
+        usize size = DDSDecode::SourceSize(vector.format, 64, 64);
+        std::vector<u8> src(size), out(64 * 64 * 4);
+        for (auto &v : src) v = (u8)blocks();
+        CHECK(DDSDecode::DecodeRGBA8(vector.format, src.data(), size, 64, 64, out.data()));
+
+        u32 checksum = Fnv1a(out);
+        if (checksum != vector.checksum) {
+            printf("format %d: checksum %08x, expected %08x\n", (int)vector.format, checksum, vector.checksum);
+            Test::failures++;
+        }
+    }
+}
+
+// Images big enough to be split across threads, with partial blocks on the right and bottom edges, against decoding
+// every block on its own.
+static void TestWholeImage() {
+    const u32 width = 1027, height = 1030;
+    for (DXGI_FORMAT format : {DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC7_UNORM}) {
+        usize size = DDSDecode::SourceSize(format, width, height);
+        usize block_size = size / (((width + 3) / 4) * ((height + 3) / 4));
+        std::vector<u8> src(size), image((usize)width * height * 4), blocks(image.size());
+        for (auto &v : src) v = (u8)rng();
+        CHECK(DDSDecode::DecodeRGBA8(format, src.data(), size, width, height, image.data()));
+
+        const u32 blocks_x = (width + 3) / 4;
+        for (u32 by = 0; by < (height + 3) / 4; ++by) {
+            for (u32 bx = 0; bx < blocks_x; ++bx) {
+                u8 pixels[64];
+                DDSDecode::DecodeRGBA8(format, &src[((usize)by * blocks_x + bx) * block_size], block_size, 4, 4, pixels);
+                for (u32 y = 0; y < 4; ++y) {
+                    for (u32 x = 0; x < 4; ++x) {
+                        u32 px = bx * 4 + x, py = by * 4 + y;
+                        if (px < width && py < height) memcpy(&blocks[((usize)py * width + px) * 4], &pixels[(y * 4 + x) * 4], 4);
+                    }
+                }
+            }
+        }
+        CHECK(image == blocks);
+        CHECK(!DDSDecode::DecodeRGBA8(format, src.data(), size - 1, width, height, image.data()));
+    }
+}
+
+static void TestUncompressed() {
+    u8 bgra[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    u8 out[8];
+    CHECK(DDSDecode::DecodeRGBA8(DXGI_FORMAT_B8G8R8A8_UNORM, bgra, 8, 2, 1, out));
+    CHECK(out[0] == 3 && out[1] == 2 && out[2] == 1 && out[3] == 4 && out[4] == 7 && out[7] == 8);
+
+    u16 halves[4] = {0x3C00, 0x3800, 0, 0xBC00};
+    CHECK(DDSDecode::DecodeRGBA8(DXGI_FORMAT_R16G16B16A16_FLOAT, (u8*)halves, 8, 1, 1, out));
+    CHECK(out[0] == 255 && out[1] == 128 && out[2] == 0 && out[3] == 0);
+
+    CHECK(!DDSDecode::IsSupported(DXGI_FORMAT_UNKNOWN));
+    CHECK(!DDSDecode::DecodeRGBA8(DXGI_FORMAT_BC1_UNORM, bgra, 8, 0, 4, out));
+}
+
+int main() {
+    TestBC1();
+    TestBC2To5();
+    TestBC7();
+    TestBC6H();
+    TestChecksums();
+    TestWholeImage();
+    TestUncompressed();
+    return Test::Result();
+}
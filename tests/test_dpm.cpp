@@ -0,0 +1,61 @@
+#include "test.h"
+#include <ArchiveFormats/HSP/dpm.h>
+#include <random>
+#include <vector>
+
+// The HSP decryption recurrence as the games do it, one byte at a time.
+static u8 Reference(const u8 *in, u8 *out, usize size, u8 s1, u8 s2, u8 val) {
+    for (usize i = 0; i < size; ++i) {
+        val += s1 ^ (u8)(in[i] - s2);
+        out[i] = val;
+    }
+    return val;
+}
+
+static std::vector<u8> RandomBytes(std::mt19937 &rng, usize size) {
+    std::vector<u8> data(size);
+    for (auto &c : data) c = (u8)rng();
+    return data;
+}
+
+int main() {
+    std::mt19937 rng(2);
+
+    // Vector scan and block sums, every length around the 16 byte steps and random seeds and carries.
+    for (int iter = 0; iter < 5000; ++iter) {
+        usize size = iter < 100 ? iter : rng() % 5000;
+        u8 s1 = (u8)rng(), s2 = (u8)rng(), val = (u8)rng();
+        std::vector<u8> in = RandomBytes(rng, size);
+        std::vector<u8> out(size), expected(size);
+
+        u8 last = DPM::Scan(in.data(), out.data(), size, s1, s2, val);
+        u8 expected_last = Reference(in.data(), expected.data(), size, s1, s2, val);
+        CHECK(out == expected);
+        CHECK(last == expected_last);
+        CHECK(DPM::BlockSum(in.data(), size, s1, s2) == (u8)(expected_last - val));
+    }
+
+    // Unaligned starts, the archive buffer gives no alignment guarantees.
+    {
+        std::vector<u8> in = RandomBytes(rng, 4099);
+        std::vector<u8> out(in.size()), expected(in.size());
+        for (usize shift = 1; shift < 16; ++shift) {
+            usize size = in.size() - shift;
+            DPM::Scan(in.data() + shift, out.data() + shift, size, 0x12, 0x34, 0);
+            Reference(in.data() + shift, expected.data() + shift, size, 0x12, 0x34, 0);
+            CHECK(memcmp(out.data() + shift, expected.data() + shift, size) == 0);
+        }
+    }
+
+    // Block scan with a forced number of blocks that doesn't divide the size, and with one block.
+    for (usize threads : {1, 2, 3, 7}) {
+        usize size = threads * DPM::MinBlockSize + 12345;
+        std::vector<u8> in = RandomBytes(rng, size);
+        std::vector<u8> out(size), expected(size);
+        DPM::ScanParallel(in.data(), out.data(), size, 0xAB, 0xCD, threads);
+        Reference(in.data(), expected.data(), size, 0xAB, 0xCD, 0);
+        CHECK(out == expected);
+    }
+
+    return Test::Result();
+}
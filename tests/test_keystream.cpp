@@ -0,0 +1,48 @@
+#include "test.h"
+#include <util/KeyStream.h>
+#include <random>
+
+// The tiled key stream against the plain `key[(offset + i) % key_size]` loop it replaces.
+static void Reference(u8 *dst, const u8 *src, usize size, const std::vector<u8> &key, u64 offset) {
+    for (usize i = 0; i < size; ++i) {
+        dst[i] = src[i] ^ key[(offset + i) % key.size()];
+    }
+}
+
+int main() {
+    std::mt19937 rng(1);
+
+    for (int iter = 0; iter < 4000; ++iter) {
+        // Mostly short keys, every so often one past the tile's MaxPeriod.
+        usize key_size = 1 + rng() % 300;
+        if (iter % 7 == 0) key_size = 5000 + rng() % 100;
+        std::vector<u8> key(key_size);
+        for (auto &k : key) k = (u8)rng();
+
+        usize size = rng() % 3000;
+        u64 offset = rng() % 100000;
+        std::vector<u8> src(size), out(size), expected(size);
+        for (auto &c : src) c = (u8)rng();
+
+        XorKeyStream stream(key.data(), key.size());
+        stream.Apply(out.data(), src.data(), size, offset);
+        Reference(expected.data(), src.data(), size, key, offset);
+        CHECK(out == expected);
+
+        // In place, which is how PFS uses it.
+        stream.Apply(src.data(), size, offset);
+        CHECK(src == expected);
+    }
+
+    // No key is a plain copy.
+    {
+        XorKeyStream stream;
+        CHECK(stream.Empty());
+        u8 src[5] = {1, 2, 3, 4, 5};
+        u8 dst[5] = {};
+        stream.Apply(dst, src, sizeof(src));
+        CHECK(memcmp(dst, src, sizeof(src)) == 0);
+    }
+
+    return Test::Result();
+}
@@ -0,0 +1,364 @@
+#include "test.h"
+#include <ArchiveFormats/Touhou/pbg.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// PBG LZSS, as thlib and thtk decode it: a flag bit, then either an 8 bit literal or a 13 bit position in a 0x2000
+// byte dictionary plus a 4 bit length (+3). Position 0 ends the stream. The dictionary starts zeroed and is written
+// from position 1 on. The fixtures below are spelled out token by token with the output that follows from that.
+
+struct BitWriter {
+    std::vector<u8> bytes;
+    u32 bit = 0;
+
+    void Put(u32 value, u32 count) {
+        while (count--) {
+            if (bit == 0) bytes.push_back(0);
+            if ((value >> count) & 1) bytes.back() |= 0x80 >> bit;
+            bit = (bit + 1) & 7;
+        }
+    }
+    void Literal(u8 c) {
+        Put(1, 1);
+        Put(c, 8);
+    }
+    void Literals(const std::string &s) {
+        for (char c : s) Literal((u8)c);
+    }
+    void Match(u32 position, u32 length) {
+        Put(0, 1);
+        Put(position, 13);
+        Put(length - 3, 4);
+    }
+    // Real streams stop right after the zero position, without length bits.
+    void End() {
+        Put(0, 1);
+        Put(0, 13);
+    }
+    // PBG3's variable width integers: 2 bits of byte count - 1, then the bytes.
+    void UInt(u32 value) {
+        u32 byte_count = value > 0xFFFFFF ? 4 : value > 0xFFFF ? 3 : value > 0xFF ? 2 : 1;
+        Put(byte_count - 1, 2);
+        Put(value, byte_count * 8);
+    }
+    void String(const std::string &s) {
+        for (char c : s) Put((u8)c, 8);
+        Put(0, 8);
+    }
+};
+
+// Decoder written after thlib's, with the dictionary kept separately from the output.
+static std::vector<u8> ReferenceUnLZSS(const std::vector<u8> &packed, usize out_size) {
+    std::vector<u8> out;
+    std::vector<u8> dict(0x2000, 0);
+    u32 head = 1;
+    usize bit = 0;
+    auto read = [&](u32 count) {
+        u32 value = 0;
+        while (count--) {
+            u32 b = bit / 8 < packed.size() ? (packed[bit / 8] >> (7 - bit % 8)) & 1 : 0;
+            value = (value << 1) | b;
+            bit++;
+        }
+        return value;
+    };
+    auto emit = [&](u8 c) {
+        out.push_back(c);
+        dict[head] = c;
+        head = (head + 1) & 0x1FFF;
+    };
+
+    while (out.size() < out_size && bit <= packed.size() * 8) {
+        if (read(1)) {
+            emit((u8)read(8));
+            continue;
+        }
+        u32 position = read(13);
+        if (position == 0) break;
+        u32 length = read(4) + 3;
+        for (u32 i = 0; i < length && out.size() < out_size; ++i) {
+            emit(dict[(position + i) & 0x1FFF]);
+        }
+    }
+    return out;
+}
+
+static std::vector<u8> UnLZSS(const std::vector<u8> &packed, usize out_size) {
+    std::vector<u8> out(out_size);
+    out.resize(PBG::UnLZSS(packed.data(), packed.size(), out.data(), out_size));
+    return out;
+}
+
+static std::vector<u8> Bytes(const std::string &s) {
+    return std::vector<u8>(s.begin(), s.end());
+}
+
+static void CheckFixtures() {
+    // Overlapping match: positions 1-3 hold ABC, copying 6 from 1 repeats it twice.
+    {
+        BitWriter w;
+        w.Literals("ABC");
+        w.Match(1, 6);
+        w.Literal('D');
+        w.End();
+        CHECK(UnLZSS(w.bytes, 64) == Bytes("ABCABCABCD"));
+    }
+    // Longest match, 15 + 3 bytes, from a two byte pattern.
+    {
+        BitWriter w;
+        w.Literals("ab");
+        w.Match(1, 18);
+        w.End();
+        CHECK(UnLZSS(w.bytes, 64) == Bytes("abababababababababab"));
+    }
+    // Matches into the part of the dictionary nothing has been written to yet give zeros.
+    {
+        BitWriter w;
+        w.Literal('x');
+        w.Match(0x1000, 3);
+        w.Literal('y');
+        w.End();
+        CHECK(UnLZSS(w.bytes, 64) == Bytes(std::string("x\0\0\0y", 5)));
+    }
+    // A match at the write position reads the byte about to be replaced, still zero this early.
+    {
+        BitWriter w;
+        w.Literal('q');
+        w.Match(2, 3);
+        w.End();
+        CHECK(UnLZSS(w.bytes, 64) == Bytes(std::string("q\0\0\0", 4)));
+    }
+    // After 0x2000 bytes the dictionary has wrapped: position 5 holds output byte 4 again.
+    {
+        BitWriter w;
+        std::vector<u8> expected;
+        for (u32 i = 0; i < 0x2000; ++i) {
+            w.Literal((u8)(i * 7));
+            expected.push_back((u8)(i * 7));
+        }
+        w.Match(5, 4);
+        w.End();
+        for (u32 i = 4; i < 8; ++i) expected.push_back((u8)(i * 7));
+        CHECK(UnLZSS(w.bytes, 0x3000) == expected);
+
+        // Right after the wrap position 0x1FFF is two bytes back, the match repeats the last two bytes.
+        w.bytes.clear();
+        w.bit = 0;
+        for (u32 i = 0; i < 0x2000; ++i) w.Literal((u8)(i * 7));
+        w.Match(0x1FFF, 3);
+        expected.resize(0x2000);
+        expected.push_back((u8)(0x1FFE * 7));
+        expected.push_back((u8)(0x1FFF * 7));
+        expected.push_back((u8)(0x1FFE * 7));
+        CHECK(UnLZSS(w.bytes, 0x2003) == expected);
+    }
+    // The output size bounds the match, not the stream.
+    {
+        BitWriter w;
+        w.Literals("xyz");
+        w.Match(1, 18);
+        CHECK(UnLZSS(w.bytes, 8) == Bytes("xyzxyzxy"));
+    }
+    // A stream cut short stops without writing past what it has.
+    {
+        BitWriter w;
+        w.Literals("hello");
+        w.bytes.resize(3);
+        std::vector<u8> out = UnLZSS(w.bytes, 64);
+        CHECK(out.size() <= 3);
+        CHECK(out.size() >= 2 && out[0] == 'h' && out[1] == 'e');
+    }
+}
+
+// Random token streams, valid and not, against the dictionary decoder.
+static void CheckAgainstReference() {
+    std::mt19937 rng(4);
+    for (int iter = 0; iter < 3000; ++iter) {
+        BitWriter w;
+        usize tokens = rng() % 2000;
+        for (usize i = 0; i < tokens; ++i) {
+            if (rng() % 3) {
+                w.Match(1 + rng() % 0x1FFF, 3 + rng() % 16);
+            } else {
+                w.Literal((u8)rng());
+            }
+        }
+        if (iter % 3 == 0) w.End();
+        if (iter % 5 == 0 && !w.bytes.empty()) w.bytes.resize(rng() % w.bytes.size());
+
+        usize out_size = rng() % 20000;
+        CHECK(UnLZSS(w.bytes, out_size) == ReferenceUnLZSS(w.bytes, out_size));
+    }
+}
+
+struct FixtureEntry {
+    std::string name;
+    std::vector<u8> packed;
+    std::vector<u8> contents;
+};
+
+static std::vector<FixtureEntry> ArchiveEntries() {
+    std::vector<FixtureEntry> entries;
+    BitWriter a;
+    a.Literals("ABC");
+    a.Match(1, 6);
+    a.Literal('D');
+    a.End();
+    entries.push_back({"a.txt", a.bytes, Bytes("ABCABCABCD")});
+
+    BitWriter b;
+    b.Literals("stage1");
+    b.Match(1, 4);
+    b.End();
+    entries.push_back({"stage1.ecl", b.bytes, Bytes("stage1stag")});
+    return entries;
+}
+
+static void CheckArchive(std::vector<u8> &archive, const std::vector<FixtureEntry> &expected) {
+    PBGFormat format;
+    CHECK(format.CanHandleFile(archive.data(), archive.size(), "dat"));
+    ArchiveBase *arc = format.TryOpen(archive.data(), archive.size(), "fixture.dat");
+    CHECK(arc != nullptr);
+    if (!arc) return;
+
+    auto entries = arc->GetEntries();
+    CHECK(entries.size() == expected.size());
+    for (auto &entry : expected) {
+        auto it = entries.find(entry.name);
+        CHECK(it != entries.end());
+        if (it == entries.end()) continue;
+        CHECK(it->second->size == entry.contents.size());
+        u8 *data = arc->OpenStream(it->second, archive.data());
+        CHECK(data && memcmp(data, entry.contents.data(), entry.contents.size()) == 0);
+        free(data);
+    }
+    delete arc;
+}
+
+// PBG3: bit packed header and index, entries back to back from 0x10.
+static void CheckPBG3() {
+    auto entries = ArchiveEntries();
+    std::vector<u8> archive(0x10, 0);
+    std::vector<u32> offsets;
+    for (auto &entry : entries) {
+        offsets.push_back((u32)archive.size());
+        archive.insert(archive.end(), entry.packed.begin(), entry.packed.end());
+    }
+    u32 index_offset = (u32)archive.size();
+
+    BitWriter header;
+    header.UInt((u32)entries.size());
+    header.UInt(index_offset);
+    memcpy(archive.data(), "PBG3", 4);
+    memcpy(archive.data() + 4, header.bytes.data(), header.bytes.size());
+
+    BitWriter index;
+    for (usize i = 0; i < entries.size(); ++i) {
+        index.UInt(0);
+        index.UInt(0);
+        index.UInt(0x1234);
+        index.UInt(offsets[i]);
+        index.UInt((u32)entries[i].contents.size());
+        index.String(entries[i].name);
+    }
+    archive.insert(archive.end(), index.bytes.begin(), index.bytes.end());
+
+    CheckArchive(archive, entries);
+}
+
+// PBG4: plain header, the index (name, offset, size, unused) is LZSS packed after the entries.
+static void CheckPBG4() {
+    auto entries = ArchiveEntries();
+    std::vector<u8> archive(0x10, 0);
+    std::vector<u8> index;
+    auto put32 = [](std::vector<u8> &out, u32 value) {
+        for (int i = 0; i < 4; ++i) out.push_back((u8)(value >> (i * 8)));
+    };
+    for (auto &entry : entries) {
+        index.insert(index.end(), entry.name.begin(), entry.name.end());
+        index.push_back(0);
+        put32(index, (u32)archive.size());
+        put32(index, (u32)entry.contents.size());
+        put32(index, 0);
+        archive.insert(archive.end(), entry.packed.begin(), entry.packed.end());
+    }
+    u32 index_offset = (u32)archive.size();
+
+    BitWriter packed_index;
+    for (u8 c : index) packed_index.Literal(c);
+    packed_index.End();
+    archive.insert(archive.end(), packed_index.bytes.begin(), packed_index.bytes.end());
+
+    memcpy(archive.data(), "PBG4", 4);
+    u32 header[3] = {(u32)entries.size(), index_offset, (u32)index.size()};
+    memcpy(archive.data() + 4, header, sizeof(header));
+
+    CheckArchive(archive, entries);
+}
+
+static std::vector<u8> ReadFile(const fs::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<u8>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Game archives can't be shipped, so RD_PBG_FIXTURES points at a directory with `<name>.dat` archives next to
+// `<name>/` folders of their files as extracted by thlib (or thdat). Every entry has to come out identical.
+static void CheckGameArchives() {
+    const char *dir = getenv("RD_PBG_FIXTURES");
+    if (!dir || !*dir) {
+        puts("RD_PBG_FIXTURES not set, skipping the game archive comparison");
+        return;
+    }
+
+    usize checked = 0;
+    for (auto &file : fs::directory_iterator(dir)) {
+        if (file.path().extension() != ".dat" && file.path().extension() != ".DAT") continue;
+        fs::path extracted = file.path();
+        extracted.replace_extension();
+        if (!fs::is_directory(extracted)) continue;
+
+        std::vector<u8> archive = ReadFile(file.path());
+        PBGFormat format;
+        ArchiveBase *arc = format.TryOpen(archive.data(), archive.size(), file.path().filename().string());
+        CHECK(arc != nullptr);
+        if (!arc) continue;
+
+        auto entries = arc->GetEntries();
+        usize files = 0;
+        for (auto &known : fs::recursive_directory_iterator(extracted)) {
+            if (!known.is_regular_file()) continue;
+            files++;
+            std::string name = fs::relative(known.path(), extracted).generic_string();
+            auto it = entries.find(name);
+            CHECK(it != entries.end());
+            if (it == entries.end()) continue;
+
+            std::vector<u8> expected = ReadFile(known.path());
+            CHECK(it->second->size == expected.size());
+            u8 *data = arc->OpenStream(it->second, archive.data());
+            bool same = data && it->second->size == expected.size() &&
+                        memcmp(data, expected.data(), expected.size()) == 0;
+            if (!same) printf("%s: %s differs\n", file.path().filename().string().c_str(), name.c_str());
+            CHECK(same);
+            free(data);
+        }
+        CHECK(files == entries.size());
+        checked += files;
+        delete arc;
+    }
+    printf("compared %zu entries from %s\n", checked, dir);
+}
+
+int main() {
+    CheckFixtures();
+    CheckAgainstReference();
+    CheckPBG3();
+    CheckPBG4();
+    CheckGameArchives();
+    return Test::Result();
+}
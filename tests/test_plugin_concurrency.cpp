@@ -0,0 +1,159 @@
+#include "test.h"
+#include <ExtractorManager.h>
+#include <SDK/ArchiveFormatWrapper.h>
+#include <SDK/sdk.h>
+#include <util/BufferPool.h>
+#include <atomic>
+#include <dlfcn.h>
+#include <thread>
+#include <vector>
+
+// Loads plugins/concurrency_test the way Plugins::LoadPlugins does and extracts from it on several threads at once,
+// the way VirtualArc::ExtractAll does for archives whose plugin declares RD_CAP_REENTRANT_OPEN_STREAM. Built with
+// -fsanitize=thread when RD_TESTS_TSAN is on, which is where this test earns its keep.
+
+static constexpr usize EntryCount = 64;
+static constexpr usize ThreadCount = 4;
+static constexpr int Rounds = 3;
+
+static sdk_ctx ctx = {};
+
+static u8 Expected(usize index, usize offset) {
+    return (u8)(index * 31 + offset);
+}
+
+// RDCT archive, see the plugin for the layout. Sizes go from a few bytes to past BufferPool::MinPooledSize, so both
+// plain malloc and pooled buffers get passed between threads.
+static std::vector<u8> BuildArchive() {
+    std::vector<u8> archive(8 + EntryCount * 24);
+    memcpy(archive.data(), "RDCT", 4);
+    u32 count = EntryCount;
+    memcpy(archive.data() + 4, &count, 4);
+
+    for (usize i = 0; i < EntryCount; ++i) {
+        u32 size = (u32)(i * i * 41 + 7);
+        u32 offset = (u32)archive.size();
+        u8 *record = archive.data() + 8 + i * 24;
+        snprintf((char*)record, 16, "entry_%02zu.bin", i);
+        memcpy(record + 16, &offset, 4);
+        memcpy(record + 20, &size, 4);
+        for (u32 k = 0; k < size; ++k) {
+            archive.push_back(Expected(i, k) ^ (u8)i);
+        }
+    }
+    return archive;
+}
+
+static void Extract(ArchiveBase *arc, std::vector<u8> &archive) {
+    auto entries = arc->GetEntries();
+    std::vector<Entry*> queue;
+    for (auto &[_, entry] : entries) queue.push_back(entry);
+
+    std::atomic<usize> next = 0;
+    std::atomic<usize> bad = 0;
+    auto worker = [&]() {
+        ArchiveBase::stream_workers = ThreadCount;
+        BufferPool &pool = BufferPool::Shared();
+        for (usize i = next++; i < queue.size(); i = next++) {
+            Entry *entry = queue[i];
+            u8 *data = (u8*)pool.Allocate(entry->size);
+            bool pooled = data && arc->ReadRange(entry, archive.data(), 0, data, entry->size) == entry->size;
+            if (!pooled) {
+                pool.Deallocate(data, entry->size);
+                data = arc->OpenStream(entry, archive.data());
+            }
+            if (!data) {
+                bad++;
+                continue;
+            }
+            for (usize k = 0; k < entry->size; ++k) {
+                if (data[k] != Expected(entry->index, k)) {
+                    bad++;
+                    break;
+                }
+            }
+            if (pooled) pool.Deallocate(data, entry->size);
+            else free(data);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (usize i = 0; i < ThreadCount; ++i) {
+        workers.emplace_back(worker);
+    }
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    CHECK(bad == 0);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        puts("usage: test_plugin_concurrency <path to concurrency_test_plugin>");
+        return 1;
+    }
+
+    void *handle = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        printf("failed to load %s: %s\n", argv[1], dlerror());
+        return 1;
+    }
+    auto init = (RD_PluginInit_t)dlsym(handle, "RD_PluginInit");
+    auto shutdown = (RD_PluginShutdown_t)dlsym(handle, "RD_PluginShutdown");
+    auto get_format = (RD_GetArchiveFormat_t)dlsym(handle, "RD_GetArchiveFormat");
+    auto abi_version = (const u32*)dlsym(handle, "RD_PluginABIVersion");
+    auto capabilities = (const u32*)dlsym(handle, "RD_PluginCapabilities");
+    auto max_concurrent = (u32 (*)())dlsym(handle, "RD_TestMaxConcurrentStreams");
+    CHECK(init && shutdown && get_format && abi_version && capabilities && max_concurrent);
+    if (Test::failures) return Test::Result();
+
+    sdk_init(&ctx);
+    static HostAPI host_api = {};
+    host_api.get_sdk_context = []() -> sdk_ctx* { return &ctx; };
+    host_api.log_fmtv = rd_log_fmtv;
+    host_api.allocate = [](usize size) -> void* {
+        return BufferPool::Shared().Allocate(size);
+    };
+    host_api.deallocate = [](void *ptr, usize size) {
+        BufferPool::Shared().Deallocate(ptr, size);
+    };
+    CHECK(init(&host_api));
+    CHECK(*capabilities & RD_CAP_REENTRANT_OPEN_STREAM);
+
+    std::vector<u8> archive = BuildArchive();
+
+    // The plugin's own ABI goes through TryOpenSource and OpenStreamInto. As a v2 plugin it's opened with TryOpen and
+    // every entry comes back from OpenStream in memory from the host allocator.
+    for (u32 abi : {*abi_version, 2u}) {
+        ExtractorManager manager;
+        manager.RegisterFormat(std::unique_ptr<ArchiveFormat>(AddArchiveFormat(&ctx, get_format(&ctx), abi, *capabilities)));
+        // The manager owns the wrapper, sdk_deinit mustn't delete it as well.
+        ctx.archiveFormat = nullptr;
+
+        FormatList candidates = manager.GetExtractorCandidates(archive.data(), archive.size(), "rdct");
+        CHECK(candidates.size() == 1);
+        if (candidates.size() != 1) continue;
+
+        ArchiveBase *arc = candidates[0]->TryOpen(archive.data(), archive.size(), "test.rdct");
+        CHECK(arc != nullptr);
+        if (!arc) continue;
+        CHECK(arc->ConcurrentStreams());
+        CHECK(arc->GetEntries().size() == EntryCount);
+
+        for (int round = 0; round < Rounds; ++round) {
+            Extract(arc, archive);
+        }
+        arc->ArchiveDestroy();
+        delete arc;
+    }
+
+    // Otherwise the test would pass without having run anything concurrently.
+    u32 overlap = max_concurrent();
+    printf("at most %u streams ran at once\n", overlap);
+    CHECK(overlap >= 2);
+
+    shutdown();
+    sdk_deinit(&ctx);
+    dlclose(handle);
+    return Test::Result();
+}
@@ -0,0 +1,114 @@
+#include "test.h"
+#include <Scripting/SquirrelArc.h>
+#include <squirrel.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// Pooled VMs are handed from call to call, anything a call leaves on a VM's stack piles up there. Runs scripted formats
+// through every exit of CanHandleFile, TryOpen and OpenStream and checks the VM's stack ends up where it started.
+
+namespace fs = std::filesystem;
+
+static constexpr int Rounds = 100;
+
+static const char *Scripts[][2] = {
+    {"stack_ok", R"(
+archive_format <- {
+    tag = "StackOk",
+    description = "Two entries",
+    CanHandleFile = function(buffer, size, ext) { return ext == "stk"; },
+    TryOpen = function(buffer, size, file_name) {
+        return { entries = [ { name = "a.bin", size = 4, offset = 0 }, { name = "b.bin", size = 2, offset = 4 } ] };
+    },
+    OpenStream = function(entry, buffer) {
+        local out = [];
+        for (local i = 0; i < entry.size; i++) out.append(entry.offset + i);
+        return out;
+    }
+}
+)"},
+    {"stack_null", R"(
+archive_format <- {
+    tag = "StackNull",
+    description = "TryOpen returns no table",
+    CanHandleFile = function(buffer, size, ext) { return null; },
+    TryOpen = function(buffer, size, file_name) { return null; }
+}
+)"},
+    {"stack_no_entries", R"(
+archive_format <- {
+    tag = "StackNoEntries",
+    description = "TryOpen returns a table without entries",
+    TryOpen = function(buffer, size, file_name) { return {}; }
+}
+)"},
+    {"stack_throw", R"(
+archive_format <- {
+    tag = "StackThrow",
+    description = "Every call throws",
+    CanHandleFile = function(buffer, size, ext) { throw "CanHandleFile"; },
+    TryOpen = function(buffer, size, file_name) { throw "TryOpen"; }
+}
+)"},
+};
+
+// Only one thread leases VMs here, so this is always the same VM.
+static SQInteger Top(SquirrelVMPool &pool) {
+    SquirrelVMPool::Lease lease = pool.Acquire();
+    return sq_gettop(lease.vm());
+}
+
+int main() {
+    fs::path dir = fs::temp_directory_path() / "rd_test_squirrel_stack";
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir);
+
+    SquirrelVMPool pool;
+    for (auto &[name, source] : Scripts) {
+        fs::path path = dir / (std::string(name) + ".nut");
+        std::ofstream(path) << source;
+        std::string tag;
+        CHECK(pool.AddScript(path.string(), tag) && !tag.empty());
+    }
+    if (Test::failures) return Test::Result();
+
+    SquirrelArchiveFormat ok(&pool, "StackOk", "");
+    SquirrelArchiveFormat null_table(&pool, "StackNull", "");
+    SquirrelArchiveFormat no_entries(&pool, "StackNoEntries", "");
+    SquirrelArchiveFormat throws(&pool, "StackThrow", "");
+
+    u8 buffer[6] = {};
+    const SQInteger top = Top(pool);
+    for (int round = 0; round < Rounds; ++round) {
+        CHECK(ok.CanHandleFile(buffer, sizeof(buffer), "stk"));
+        CHECK(!null_table.CanHandleFile(buffer, sizeof(buffer), "stk"));
+        CHECK(!throws.CanHandleFile(buffer, sizeof(buffer), "stk"));
+        // No CanHandleFile in the script at all.
+        CHECK(!no_entries.CanHandleFile(buffer, sizeof(buffer), "stk"));
+
+        CHECK(null_table.TryOpen(buffer, sizeof(buffer), "x.stk") == nullptr);
+        CHECK(no_entries.TryOpen(buffer, sizeof(buffer), "x.stk") == nullptr);
+        CHECK(throws.TryOpen(buffer, sizeof(buffer), "x.stk") == nullptr);
+
+        ArchiveBase *arc = ok.TryOpen(buffer, sizeof(buffer), "x.stk");
+        CHECK(arc != nullptr);
+        if (!arc) break;
+        for (auto &[name, entry] : arc->GetEntries()) {
+            u8 *data = arc->OpenStream(entry, buffer);
+            CHECK(data != nullptr);
+            for (usize i = 0; data && i < entry->size; ++i) {
+                CHECK(data[i] == entry->offset + i);
+            }
+            free(data);
+        }
+        delete arc;
+    }
+    SQInteger after = Top(pool);
+    if (after != top) printf("stack top went from %lld to %lld\n", (long long)top, (long long)after);
+    CHECK(after == top);
+
+    fs::remove_all(dir, ec);
+    return Test::Result();
+}